@@ -20,16 +20,25 @@
 #define MAIDSAFE_VAULT_ACCUMULATOR_H_
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <deque>
+#include <functional>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "maidsafe/common/crypto.h"
 #include "maidsafe/data_types/data_name_variant.h"
 #include "maidsafe/nfs/utils.h"
 #include "maidsafe/nfs/message_types.h"
 #include "maidsafe/nfs/types.h"
 #include "maidsafe/nfs/vault/messages.h"
 #include "maidsafe/vault/handled_request.pb.h"
+#include "maidsafe/vault/parameters.h"
 #include "maidsafe/vault/types.h"
 #include "maidsafe/vault/utils.h"
 
@@ -49,19 +58,91 @@ class MessageIdRequestVisitor : public boost::static_visitor<nfs::MessageId> {
   }
 };
 
-class ContentEraseVisitor : public boost::static_visitor<> {
+// Replaces a chunk payload by its SHA512 digest.  Returns false for contents without a payload.
+template<typename Contents>
+bool DigestContent(Contents& /*contents*/) {
+  return false;
+}
+
+inline bool DigestContent(nfs_vault::DataNameAndContent& name_and_content) {
+  name_and_content.content =
+      NonEmptyString(crypto::Hash<crypto::SHA512>(name_and_content.content).string());
+  return true;
+}
+
+inline bool DigestContent(nfs_vault::DataAndPmidHint& data_and_pmid_hint) {
+  return DigestContent(data_and_pmid_hint.data);
+}
+
+// Gives the message its own copy of its contents with any payload digested, leaving contents
+// shared with other copies of the message untouched.
+class ContentDigestVisitor : public boost::static_visitor<> {
  public:
-  template<typename ContentType>
-  void operator()(ContentType& /*content*/) {}
+  template<typename T>
+  void operator()(T& message) const {
+    typedef typename std::remove_const<
+        typename std::remove_reference<decltype(*message.contents)>::type>::type Contents;
+    Contents contents(*message.contents);
+    if (DigestContent(contents))
+      message.contents = decltype(message.contents)(new Contents(std::move(contents)));
+  }
 };
 
-template<>
-void ContentEraseVisitor::operator()(nfs_vault::DataNameAndContent& name_and_content) {
-  name_and_content.content = NonEmptyString(std::string("NA"));
+// Approximate heap bytes held by a message's payload, if it has one.
+template<typename Contents>
+size_t PayloadSize(const Contents& /*contents*/) {
+  return 0;
+}
+
+inline size_t PayloadSize(const nfs_vault::DataNameAndContent& name_and_content) {
+  return name_and_content.content.string().size();
+}
+
+inline size_t PayloadSize(const nfs_vault::DataAndPmidHint& data_and_pmid_hint) {
+  return PayloadSize(data_and_pmid_hint.data);
 }
 
+class PayloadSizeVisitor : public boost::static_visitor<size_t> {
+ public:
+  template<typename T>
+  size_t operator()(const T& message) const {
+    return PayloadSize(*message.contents);
+  }
+};
+
 } // noname namespace
 
+// Bounds on an Accumulator's contents.  Each persona has one Accumulator for its whole message
+// variant, so the limits are shared by all of that persona's message types rather than set per
+// type.  Pending request copies are evicted oldest first once any of the pending limits is
+// exceeded; handled requests are forgotten oldest first.
+struct AccumulatorPolicy {
+  AccumulatorPolicy()
+      : max_pending_count(detail::Parameters::accumulator_max_pending_count),
+        max_pending_bytes(detail::Parameters::accumulator_max_pending_bytes),
+        max_pending_age(detail::Parameters::accumulator_max_pending_age),
+        max_handled_count(detail::Parameters::accumulator_max_handled_count) {}
+  size_t max_pending_count, max_pending_bytes;
+  std::chrono::steady_clock::duration max_pending_age;
+  size_t max_handled_count;
+};
+
+struct AccumulatorPolicies {
+  AccumulatorPolicy maid_manager, version_manager, data_manager, pmid_manager, pmid_node;
+};
+
+struct AccumulatorStats {
+  AccumulatorStats() : handled_hits(0), expired(0), evicted(0), handled_evicted(0) {}
+  // Requests rejected because they had already been handled.
+  uint64_t handled_hits;
+  // Pending copies dropped for exceeding 'max_pending_age'.
+  uint64_t expired;
+  // Pending copies dropped for exceeding 'max_pending_count' or 'max_pending_bytes'.
+  uint64_t evicted;
+  // Handled requests forgotten for exceeding 'max_handled_count'.
+  uint64_t handled_evicted;
+};
+
 template<typename T>
 class Accumulator {
  public:
@@ -89,7 +170,7 @@ class Accumulator {
     routing::GroupSource source;
   };
 
-  Accumulator();
+  explicit Accumulator(const AccumulatorPolicy& policy = AccumulatorPolicy());
 
   AddResult AddPendingRequest(const T& request,
                               const routing::GroupSource& source,
@@ -99,29 +180,93 @@ class Accumulator {
                               AddCheckerFunctor checker);
 
   bool CheckHandled(const T& request);
-//  void SetHandled(const T& request, const routing::GroupSource& source);
+  // Marks the request as handled and drops all of its pending copies.
+  void SetHandled(const T& request);
+  // Returns the pending copies of 'request'.  Chunk payloads are stored only as SHA512 digests,
+  // so the copies can be compared for a quorum but don't carry the payload itself.
   std::vector<T> Get(const T& request);
+  AccumulatorStats stats() const { return stats_; }
+  size_t pending_count() const { return pending_count_; }
+  size_t pending_bytes() const { return pending_bytes_; }
 
  private:
+  // Identifies all copies of a request: the variant alternative and its message id.
+  struct RequestKey {
+    RequestKey(int which_in, const nfs::MessageId& message_id_in)
+        : which(which_in), message_id(message_id_in) {}
+    bool operator==(const RequestKey& other) const {
+      return which == other.which && message_id == other.message_id;
+    }
+    int which;
+    nfs::MessageId message_id;
+  };
+
+  struct RequestKeyHash {
+    size_t operator()(const RequestKey& key) const {
+      return std::hash<int64_t>()((static_cast<int64_t>(key.which) << 32) ^
+                                  static_cast<int64_t>(key.message_id.data));
+    }
+  };
+
+  struct PendingCopy {
+    PendingCopy(uint64_t sequence_number_in, size_t bytes_in, const PendingRequest& pending_in)
+        : sequence_number(sequence_number_in), bytes(bytes_in), pending(pending_in) {}
+    uint64_t sequence_number;
+    size_t bytes;
+    PendingRequest pending;
+  };
+
+  struct OrderEntry {
+    OrderEntry(uint64_t sequence_number_in, const RequestKey& key_in,
+               std::chrono::steady_clock::time_point arrival_time_in)
+        : sequence_number(sequence_number_in), key(key_in), arrival_time(arrival_time_in) {}
+    uint64_t sequence_number;
+    RequestKey key;
+    std::chrono::steady_clock::time_point arrival_time;
+  };
+
+  // Pending copies of one request, oldest first.
+  typedef std::vector<PendingCopy> PendingGroup;
+  typedef std::unordered_map<RequestKey, PendingGroup, RequestKeyHash> PendingMap;
+
   Accumulator(const Accumulator&);
   Accumulator& operator=(const Accumulator&);
   Accumulator(Accumulator&&);
   Accumulator& operator=(Accumulator&&);
 
+  static RequestKey MakeKey(const T& request);
   bool RequestExists(const T& request, const routing::GroupSource& source);
-
-  std::deque<PendingRequest> pending_requests_;
-  std::deque<T> handled_requests_;
-  const size_t kMaxPendingRequestsCount_, kMaxHandledRequestsCount_;
+  bool IsLive(const OrderEntry& order_entry) const;
+  void PurgeStaleOrderEntries();
+  void EnforcePendingLimits();
+  // Drops the oldest pending copy.  Returns false if there are none.
+  bool EvictOldestPendingRequest(uint64_t& counter);
+
+  const AccumulatorPolicy kPolicy_;
+  // 'pending_order_' holds an entry for every pending copy in arrival order.  Entries for copies
+  // dropped by SetHandled are stale; they are skipped on eviction and purged once they clearly
+  // outnumber the live entries.
+  PendingMap pending_requests_;
+  std::deque<OrderEntry> pending_order_;
+  size_t pending_count_, pending_bytes_;
+  uint64_t next_sequence_number_;
+  std::unordered_set<RequestKey, RequestKeyHash> handled_requests_;
+  std::deque<RequestKey> handled_order_;
+  AccumulatorStats stats_;
 };
 
 
 template<typename T>
-Accumulator<T>::Accumulator()
-    : pending_requests_(),
+Accumulator<T>::Accumulator(const AccumulatorPolicy& policy)
+    : kPolicy_(policy),
+      pending_requests_(),
+      pending_order_(),
+      pending_count_(0),
+      pending_bytes_(0),
+      next_sequence_number_(0),
       handled_requests_(),
-      kMaxPendingRequestsCount_(300),
-      kMaxHandledRequestsCount_(1000) {}
+      handled_order_(),
+      stats_() {}
 
 template<typename T>
 typename Accumulator<T>::AddResult Accumulator<T>::AddPendingRequest(
@@ -132,9 +277,18 @@ typename Accumulator<T>::AddResult Accumulator<T>::AddPendingRequest(
     return Accumulator<T>::AddResult::kHandled;
 
   if (!RequestExists(request, source)) {
-    pending_requests_.push_back(PendingRequest(request, source));
-    if (pending_requests_.size() > kMaxPendingRequestsCount_)
-      handled_requests_.pop_front();
+    auto key(MakeKey(request));
+    T digested_request(request);
+    boost::apply_visitor(ContentDigestVisitor(), digested_request);
+    size_t bytes(sizeof(PendingCopy) + sizeof(OrderEntry) +
+                 boost::apply_visitor(PayloadSizeVisitor(), digested_request));
+    pending_requests_[key].push_back(
+        PendingCopy(next_sequence_number_, bytes, PendingRequest(digested_request, source)));
+    pending_order_.push_back(
+        OrderEntry(next_sequence_number_++, key, std::chrono::steady_clock::now()));
+    ++pending_count_;
+    pending_bytes_ += bytes;
+    EnforcePendingLimits();
   }
   return checker(Get(request));
 }
@@ -147,65 +301,116 @@ typename Accumulator<T>::AddResult Accumulator<T>::AddPendingRequest(
 
 template<typename T>
 bool Accumulator<T>::CheckHandled(const T& request) {
-  auto request_message_id(boost::apply_visitor(MessageIdRequestVisitor(), request));
-  nfs::MessageId message_id;
-  for (auto handled_request : handled_requests_) {
-    if (handled_request.which() == request.which()) {
-      message_id = boost::apply_visitor(MessageIdRequestVisitor(), handled_request);
-      if (message_id == request_message_id)
-        return true;
-    }
-  }
-  return false;
+  if (handled_requests_.count(MakeKey(request)) == 0)
+    return false;
+  ++stats_.handled_hits;
+  return true;
 }
 
-//template<typename T>
-//void Accumulator<T>::SetHandled(const T& request, const routing::GroupSource& source) {
-//    assert(!CheckHandled(request) && "Request has already been set as handled");
-//    nfs::MessageId message_id;
-//    auto request_message_id(boost::apply_visitor(MessageIdRequestVisitor(), request));
-//    boost::apply_visitor(ContentEraseVisitor(), request);
-//    for (auto itr(std::begin(pending_requests_)); itr != std::end(pending_requests_);) {
-//        if (itr->request.which() == request.which()) {
-//            message_id = boost::apply_visitor(MessageIdRequestVisitor(), itr->request);
-//            if ((message_id == request_message_id) && (source.group_id == itr->source.group_id))
-//                pending_requests_.erase(itr);
-//            else
-//                ++itr;
-//        } else {
-//            ++itr;
-//        }
-//    }
-//    boost::apply_visitor(ContentEraseVisitor(), request);
-//    handled_requests_.push_back(request);
-//    if (handled_requests_.size() > kMaxHandledRequestsCount_)
-//        handled_requests_.pop_front();
-//}
+template<typename T>
+void Accumulator<T>::SetHandled(const T& request) {
+  auto key(MakeKey(request));
+  auto found(pending_requests_.find(key));
+  if (found != std::end(pending_requests_)) {
+    for (const auto& pending_copy : found->second)
+      pending_bytes_ -= pending_copy.bytes;
+    pending_count_ -= found->second.size();
+    pending_requests_.erase(found);
+    PurgeStaleOrderEntries();
+  }
+  if (!handled_requests_.insert(key).second)
+    return;
+  handled_order_.push_back(key);
+  if (handled_order_.size() > kPolicy_.max_handled_count) {
+    handled_requests_.erase(handled_order_.front());
+    handled_order_.pop_front();
+    ++stats_.handled_evicted;
+  }
+}
 
 template<typename T>
 std::vector<T> Accumulator<T>::Get(const T& request) {
   std::vector<T> requests;
-  nfs::MessageId message_id;
-  auto request_message_id(boost::apply_visitor(MessageIdRequestVisitor(), request));
-  for (auto pending_request : pending_requests_) {
-    if (pending_request.request.which() == request.which()) {
-      message_id = boost::apply_visitor(MessageIdRequestVisitor(), pending_request.request);
-      if ((message_id == request_message_id))
-        requests.push_back(pending_request.request);
-    }
+  auto found(pending_requests_.find(MakeKey(request)));
+  if (found != std::end(pending_requests_)) {
+    for (const auto& pending_copy : found->second)
+      requests.push_back(pending_copy.pending.request);
   }
   return requests;
 }
 
+template<typename T>
+typename Accumulator<T>::RequestKey Accumulator<T>::MakeKey(const T& request) {
+  return RequestKey(request.which(), boost::apply_visitor(MessageIdRequestVisitor(), request));
+}
+
 template<typename T>
 bool Accumulator<T>::RequestExists(const T& request, const routing::GroupSource& source) {
-  auto request_message_id(boost::apply_visitor(MessageIdRequestVisitor(), request));
-  for (auto pending_request : pending_requests_)
-    if (pending_request.request.which() == request.which() &&
-        source == pending_request.source &&
-        request_message_id == boost::apply_visitor(MessageIdRequestVisitor(),
-                                                   pending_request.request))
-      return true;
+  auto found(pending_requests_.find(MakeKey(request)));
+  if (found == std::end(pending_requests_))
+    return false;
+  return std::any_of(std::begin(found->second), std::end(found->second),
+                     [&source](const PendingCopy& pending_copy) {
+                       return pending_copy.pending.source == source;
+                     });
+}
+
+// Copies are only removed from the front of their group or with the whole group, so an order
+// entry is live if its group still exists and holds copies at least as old.
+template<typename T>
+bool Accumulator<T>::IsLive(const OrderEntry& order_entry) const {
+  auto found(pending_requests_.find(order_entry.key));
+  return found != std::end(pending_requests_) &&
+         found->second.front().sequence_number <= order_entry.sequence_number;
+}
+
+template<typename T>
+void Accumulator<T>::PurgeStaleOrderEntries() {
+  if (pending_order_.size() <= 2 * pending_count_ + kPolicy_.max_pending_count)
+    return;
+  pending_order_.erase(std::remove_if(std::begin(pending_order_), std::end(pending_order_),
+                                      [this](const OrderEntry& order_entry) {
+                                        return !IsLive(order_entry);
+                                      }),
+                       std::end(pending_order_));
+}
+
+template<typename T>
+void Accumulator<T>::EnforcePendingLimits() {
+  // Arrival order is age order, so expired copies are all at the front.
+  auto expiry_time(std::chrono::steady_clock::now() - kPolicy_.max_pending_age);
+  while (!pending_order_.empty()) {
+    if (!IsLive(pending_order_.front())) {
+      pending_order_.pop_front();
+    } else if (pending_order_.front().arrival_time < expiry_time) {
+      EvictOldestPendingRequest(stats_.expired);
+    } else {
+      break;
+    }
+  }
+  while (pending_count_ > kPolicy_.max_pending_count ||
+         pending_bytes_ > kPolicy_.max_pending_bytes) {
+    if (!EvictOldestPendingRequest(stats_.evicted))
+      break;
+  }
+}
+
+template<typename T>
+bool Accumulator<T>::EvictOldestPendingRequest(uint64_t& counter) {
+  while (!pending_order_.empty()) {
+    bool live(IsLive(pending_order_.front()));
+    auto found(pending_requests_.find(pending_order_.front().key));
+    pending_order_.pop_front();
+    if (!live)
+      continue;
+    pending_bytes_ -= found->second.front().bytes;
+    found->second.erase(std::begin(found->second));
+    if (found->second.empty())
+      pending_requests_.erase(found);
+    --pending_count_;
+    ++counter;
+    return true;
+  }
   return false;
 }
 
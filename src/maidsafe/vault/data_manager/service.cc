@@ -21,6 +21,7 @@
 #include <string>
 #include <vector>
 
+#include "maidsafe/common/log.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/nfs/utils.h"
 #include "maidsafe/vault/sync.pb.h"
@@ -46,11 +47,12 @@ inline bool ForThisPersona(const Message& message) {
 
 DataManagerService::DataManagerService(const passport::Pmid& pmid,
                                        routing::Routing& routing,
-                                       nfs_client::DataGetter& data_getter)
+                                       nfs_client::DataGetter& data_getter,
+                                       const AccumulatorPolicy& accumulator_policy)
     : routing_(routing),
       data_getter_(data_getter),
       accumulator_mutex_(),
-      accumulator_(),
+      accumulator_(accumulator_policy),
       dispatcher_(routing_, pmid),
       db_(),
       sync_puts_(),
@@ -58,7 +60,13 @@ DataManagerService::DataManagerService(const passport::Pmid& pmid,
       sync_add_pmids_(),
       sync_remove_pmids_(),
       sync_node_downs_(),
-      sync_node_ups_() {
+      sync_node_ups_(),
+      sync_coalescer_([this](const NodeId& group_id, const std::string& serialised_batch) {
+                        dispatcher_.SendSync(Identity(group_id.string()), serialised_batch);
+                      }),
+      sync_scheduler_([this] { DoSync(); },
+                      [this] { return sync_coalescer_.queued_actions(); },
+                      [this] { sync_coalescer_.FlushDue(); }) {
 }
 
 // GetRequestFromMaidNodeToDataManager
@@ -105,71 +113,69 @@ void DataManagerService::HandleMessage(
 }
 
 // =============== Sync ============================================================================
-//template<>
-//void DataManagerService::HandleMessage(
-//   const nfs::SynchroniseFromDataManagerToDataManager& /*message*/,
-//   const typename nfs::SynchroniseFromDataManagerToDataManager::Sender& /*sender*/,
-//   const typename nfs::SynchroniseFromDataManagerToDataManager::Receiver& /*receiver*/) {
-//  protobuf::Sync proto_sync;
-//  if (!proto_sync.ParseFromString(message.contents->content.string()))
-//    ThrowError(CommonErrors::parsing_error);
-
-//  switch (static_cast<nfs::MessageAction>(proto_sync.action_type())) {
-//    case ActionDataManagerPut::kActionId: {
-//      DataManager::UnresolvedPut unresolved_action(
-//          proto_sync.serialised_unresolved_action(), sender.sender_id, routing_.kNodeId());
-//      auto resolved_action(sync_puts_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action) {
-//        db_.Commit(resolved_action->key, resolved_action->action);
-//      }
-//      break;
-//    }
-//    case ActionDataManagerDelete::kActionId: {
-//      DataManager::UnresolvedDelete unresolved_action(
-//          proto_sync.serialised_unresolved_action(), sender.sender_id, routing_.kNodeId());
-//      auto resolved_action(sync_deletes_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        db_.Commit(resolved_action->key, resolved_action->action);
-//      break;
-//    }
-//    case ActionDataManagerAddPmid::kActionId: {
-//      DataManager::UnresolvedAddPmid unresolved_action(
-//          proto_sync.serialised_unresolved_action(), sender.sender_id, routing_.kNodeId());
-//      auto resolved_action(sync_add_pmids_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        db_.Commit(resolved_action->key, resolved_action->action);
-//      break;
-//    }
-//    case ActionDataManagerRemovePmid::kActionId: {
-//      DataManager::UnresolvedRemovePmid unresolved_action(
-//          proto_sync.serialised_unresolved_action(), sender.sender_id, routing_.kNodeId());
-//      auto resolved_action(sync_remove_pmids_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        db_.Commit(resolved_action->key, resolved_action->action);
-//      break;
-//    }
-//    case ActionDataManagerNodeUp::kActionId: {
-//      DataManager::UnresolvedNodeUp unresolved_action(
-//          proto_sync.serialised_unresolved_action(), sender.sender_id, routing_.kNodeId());
-//      auto resolved_action(sync_node_ups_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        db_.Commit(resolved_action->key, resolved_action->action);
-//      break;
-//    }
-//    case ActionDataManagerNodeDown::kActionId: {
-//      DataManager::UnresolvedNodeDown unresolved_action(
-//          proto_sync.serialised_unresolved_action(), sender.sender_id, routing_.kNodeId());
-//      auto resolved_action(sync_node_downs_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        db_.Commit(resolved_action->key, resolved_action->action);
-//      break;
-//    }
-//    default: {
-//      assert(false);
-//      LOG(kError) << "Unhandled action type";
-//    }
-//  }
-//}
+template<>
+void DataManagerService::HandleMessage(
+   const SynchroniseFromDataManagerToDataManager& message,
+   const typename SynchroniseFromDataManagerToDataManager::Sender& sender,
+   const typename SynchroniseFromDataManagerToDataManager::Receiver& /*receiver*/) {
+  HandleSync(message.contents->data, sender.sender_id);
+}
+
+void DataManagerService::DoSync() {
+  auto group_id([](const DataManager::Key& key) { return NodeId(key.name.string()); });
+  sync_coalescer_.AddUnresolvedActions(sync_puts_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_deletes_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_add_pmids_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_remove_pmids_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_node_downs_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_node_ups_, group_id);
+  sync_coalescer_.FlushAll();
+  sync_puts_.IncrementSyncAttempts();
+  sync_deletes_.IncrementSyncAttempts();
+  sync_add_pmids_.IncrementSyncAttempts();
+  sync_remove_pmids_.IncrementSyncAttempts();
+  sync_node_downs_.IncrementSyncAttempts();
+  sync_node_ups_.IncrementSyncAttempts();
+}
+
+void DataManagerService::HandleSync(const std::string& serialised_batch,
+                                    const NodeId& sender_id) {
+  for (const auto& proto_sync : SyncCoalescer::Unpack(serialised_batch)) {
+    try {
+      auto action_type(static_cast<nfs::MessageAction>(proto_sync.action_type()));
+      if (action_type == ActionDataManagerPut::kActionId) {
+        ApplySync(sync_puts_, proto_sync, sender_id);
+      } else if (action_type == ActionDataManagerDelete::kActionId) {
+        ApplySync(sync_deletes_, proto_sync, sender_id);
+      } else if (action_type == ActionDataManagerAddPmid::kActionId) {
+        ApplySync(sync_add_pmids_, proto_sync, sender_id);
+      } else if (action_type == ActionDataManagerRemovePmid::kActionId) {
+        ApplySync(sync_remove_pmids_, proto_sync, sender_id);
+      } else if (action_type == ActionDataManagerNodeUp::kActionId) {
+        ApplySync(sync_node_ups_, proto_sync, sender_id);
+      } else if (action_type == ActionDataManagerNodeDown::kActionId) {
+        ApplySync(sync_node_downs_, proto_sync, sender_id);
+      } else {
+        LOG(kError) << "Unhandled action type " << proto_sync.action_type();
+      }
+    }
+    catch(const std::exception& e) {
+      LOG(kError) << "Failed to apply synced action of type " << proto_sync.action_type()
+                  << ": " << e.what();
+    }
+  }
+}
+
+template<typename UnresolvedAction>
+void DataManagerService::ApplySync(Sync<UnresolvedAction>& sync,
+                                   const protobuf::Sync& proto_sync,
+                                   const NodeId& sender_id) {
+  UnresolvedAction unresolved_action(proto_sync.serialised_unresolved_action(), sender_id,
+                                     routing_.kNodeId());
+  auto resolved_action(sync.AddUnresolvedAction(unresolved_action));
+  if (resolved_action)
+    db_.Commit(resolved_action->key, resolved_action->action);
+}
 
 // =============== Churn ===========================================================================
 //void DataManagerService::HandleChurnEvent(std::shared_ptr<routing::MatrixChange> matrix_change) {
@@ -40,8 +40,12 @@
 #include "maidsafe/vault/data_manager/data_manager.h"
 #include "maidsafe/vault/data_manager/data_manager.pb.h"
 #include "maidsafe/vault/group_db.h"
+#include "maidsafe/vault/message_types.h"
 #include "maidsafe/vault/types.h"
 #include "maidsafe/vault/sync.h"
+#include "maidsafe/vault/sync.pb.h"
+#include "maidsafe/vault/sync_coalescer.h"
+#include "maidsafe/vault/sync_scheduler.h"
 #include "maidsafe/vault/data_manager/dispatcher.h"
 
 
@@ -52,11 +56,12 @@ namespace vault {
 class DataManagerService {
  public:
   typedef nfs::DataManagerServiceMessages PublicMessages;
-  typedef nfs::DataManagerServiceMessages VaultMessages; // FIXME (Check with Fraser)
+  typedef DataManagerServiceMessages VaultMessages;
 
   DataManagerService(const passport::Pmid& pmid,
                      routing::Routing& routing,
-                     nfs_client::DataGetter& data_getter);
+                     nfs_client::DataGetter& data_getter,
+                     const AccumulatorPolicy& accumulator_policy = AccumulatorPolicy());
   template<typename T>
   void HandleMessage(const T&, const typename T::Sender& , const typename T::Receiver&);
   void HandleChurnEvent(std::shared_ptr<routing::MatrixChange> /*matrix_change*/) {}
@@ -78,7 +83,14 @@ class DataManagerService {
                          const PmidName& attempted_pmid_node,
                          const nfs::MessageId& message_id,
                          const maidsafe_error& error);
+  // One round of 'sync_scheduler_': sends this node's unresolved actions to its peers, coalesced
+  // per group, then advances their sync attempts.
   void DoSync();
+  // Handles the content of a Synchronise message from a peer: a batch of unresolved actions.
+  void HandleSync(const std::string& serialised_batch, const NodeId& sender_id);
+  template<typename UnresolvedAction>
+  void ApplySync(Sync<UnresolvedAction>& sync, const protobuf::Sync& proto_sync,
+                 const NodeId& sender_id);
   template<typename Data>
   bool EntryExist(const typename Data::Name& /*name*/);
 
@@ -135,6 +147,8 @@ class DataManagerService {
   Sync<DataManager::UnresolvedRemovePmid> sync_remove_pmids_;
   Sync<DataManager::UnresolvedNodeDown> sync_node_downs_;
   Sync<DataManager::UnresolvedNodeUp> sync_node_ups_;
+  SyncCoalescer sync_coalescer_;
+  SyncScheduler sync_scheduler_;
 };
 
 // =========================== Handle Message Specialisations ======================================
@@ -194,11 +208,11 @@ void DataManagerService::HandleMessage(
 //   const typename nfs::GetResponseFromPmidNodeToDataManager::Sender& sender,
 //   const typename nfs::GetResponseFromPmidNodeToDataManager::Receiver& receiver);
 
-//template<>
-//void DataManagerService::HandleMessage(
-//   const nfs::SynchroniseFromDataManagerToDataManager& message,
-//   const typename nfs::SynchroniseFromDataManagerToDataManager::Sender& sender,
-//   const typename nfs::SynchroniseFromDataManagerToDataManager::Receiver& receiver);
+template<>
+void DataManagerService::HandleMessage(
+   const SynchroniseFromDataManagerToDataManager& message,
+   const typename SynchroniseFromDataManagerToDataManager::Sender& sender,
+   const typename SynchroniseFromDataManagerToDataManager::Receiver& receiver);
 
 
 // ================================== Put implementation ==========================================
@@ -224,7 +238,7 @@ void DataManagerService::HandlePut(const Data& data,
         ActionDataManagerPut(data.name(), data.data().string().size()),
         routing_.kNodeId(),
         message_id));
-    DoSync();
+    sync_scheduler_.Notify();
   }
   dispatcher_.SendPutResponse<Data>(maid_name, data.name(), cost, message_id);
 }
@@ -253,7 +267,7 @@ void DataManagerService::HandlePutResponse(const typename Data::name& data_name,
       ActionDataManagerPut(pmid_node),
       routing_.kNodeId(),
       message_id));
-  DoSync();
+  sync_scheduler_.Notify();
 }
 
 
@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_VAULT_DB_H_
 #define MAIDSAFE_VAULT_DB_H_
 
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -29,9 +30,15 @@
 #include "boost/optional/optional.hpp"
 
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 
+#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/routing/matrix_change.h"
 
+#include "maidsafe/vault/key_utils.h"
+#include "maidsafe/vault/parameters.h"
+#include "maidsafe/vault/striped_mutex.h"
+
 namespace maidsafe {
 
 namespace vault {
@@ -41,13 +48,35 @@ class Db {
  public:
   typedef std::pair<Key, Value> KvPair;
   typedef std::map<NodeId, std::vector<KvPair>> TransferInfo;
+  typedef std::function<void(boost::optional<Value>& value)> Functor;
+  typedef std::function<void(const NodeId& new_holder,
+                             const std::vector<KvPair>& contents)> TransferFunctor;
 
-  Db();
+  explicit Db(size_t lock_stripe_count = detail::Parameters::db_lock_stripe_count);
   ~Db();
 
+  // Doesn't lock; leveldb reads are consistent against concurrent writes.
   boost::optional<Value> Get(const Key& key);
-  void Commit(const Key& key, std::function<void(boost::optional<Value>& value)> functor);
-  TransferInfo GetTransferInfo(std::shared_ptr<routing::MatrixChange> matrix_change);
+  void Commit(const Key& key, Functor functor);
+  // Applies each functor in turn and writes all resulting puts and deletes as a single
+  // leveldb::WriteBatch.  Where a key appears more than once, each functor sees the value left by
+  // the previous one.  Throws without modifying the db if any functor throws.
+  void Commit(const std::vector<std::pair<Key, Functor>>& key_functor_pairs);
+  TransferInfo GetTransferInfo(std::shared_ptr<routing::MatrixChange> matrix_change,
+                               const std::vector<detail::NameRange>& name_ranges =
+                                   std::vector<detail::NameRange>());
+  // Iterates a snapshot of the db, passing entries due to each new holder to 'transfer_functor' in
+  // chunks of roughly 'detail::Parameters::max_transfer_chunk_bytes', and deletes entries which
+  // are no longer in range in bounded batches.  No lock is held while iterating, so other
+  // operations continue during churn.  An entry is only deleted once any chunk containing it has
+  // been passed to 'transfer_functor', and only if it is unchanged since the snapshot was taken;
+  // an entry modified meanwhile is kept for a later churn event.  If 'name_ranges' is non-empty,
+  // only entries whose names lie in those ranges are considered (see
+  // detail::GetNameRangesWithinRadius); otherwise the whole db is scanned.
+  void StreamTransferInfo(std::shared_ptr<routing::MatrixChange> matrix_change,
+                          TransferFunctor transfer_functor,
+                          const std::vector<detail::NameRange>& name_ranges =
+                              std::vector<detail::NameRange>());
   void HandleTransfer(const std::vector<KvPair>& contents);
 
  private:
@@ -55,19 +84,24 @@ class Db {
   Db& operator=(const Db&);
   Db(Db&&);
   Db& operator=(Db&&);
-  void Delete(const Key& key);
-  void Put(const KvPair& key_value_pair);
+  void Write(leveldb::WriteBatch& batch);
+  // Each pair is a key and the value it had in the snapshot being streamed.
+  void Prune(const std::vector<std::pair<std::string, std::string>>& snapshot_entries);
   boost::optional<Value> GetValue(const Key& key);
+  // Refers to the encoded keys in place, so they can be locked without copying each to the heap.
+  static std::vector<leveldb::Slice> KeySlices(
+      const std::vector<typename Key::FixedWidthBuffer>& key_buffers);
 
+  static const size_t kMaxPruneBatchSize_ = 1000;
   const boost::filesystem::path kDbPath_;
-  mutable std::mutex mutex_;
+  StripedMutex mutexes_;
   std::unique_ptr<leveldb::DB> leveldb_;
 };
 
 template<typename Key, typename Value>
-Db<Key, Value>::Db()
+Db<Key, Value>::Db(size_t lock_stripe_count)
     : kDbPath_(boost::filesystem::unique_path()),
-      mutex_(),
+      mutexes_(lock_stripe_count),
       leveldb_() {
   leveldb::DB* db;
   leveldb::Options options;
@@ -87,68 +121,142 @@ Db<Key, Value>::~Db() {
 
 template<typename Key, typename Value>
 boost::optional<Value> Db<Key, Value>::Get(const Key& key) {
-  std::lock_guard<std::mutex> lock(mutex_);
   return GetValue(key);
 }
 
 template<typename Key, typename Value>
-void Db<Key, Value>::Commit(const Key& key,
-                            std::function<void(boost::optional<Value>& value)> functor) {
+void Db<Key, Value>::Commit(const Key& key, Functor functor) {
   assert(functor);
-  std::lock_guard<std::mutex> lock(mutex_);
-  boost::optional<Value> value(GetValue(key));
-  bool value_found_in_db(value);
-  functor(value);
-  if(value)
-    Put(std::make_pair(key, value));
-  else if (value_found_in_db)
-    Delete(key);
+  Commit(std::vector<std::pair<Key, Functor>>(1, std::make_pair(key, functor)));
+}
+
+template<typename Key, typename Value>
+void Db<Key, Value>::Commit(const std::vector<std::pair<Key, Functor>>& key_functor_pairs) {
+  // Maps each key to its current value and whether that value was originally in the db.
+  std::map<Key, std::pair<boost::optional<Value>, bool>> values;
+  std::vector<typename Key::FixedWidthBuffer> key_buffers;
+  key_buffers.reserve(key_functor_pairs.size());
+  for (const auto& key_functor : key_functor_pairs)
+    key_buffers.push_back(key_functor.first.ToFixedWidthBuffer());
+  auto locks(mutexes_.Lock(KeySlices(key_buffers)));
+  for (const auto& key_functor : key_functor_pairs) {
+    assert(key_functor.second);
+    auto itr(values.find(key_functor.first));
+    if (itr == std::end(values)) {
+      boost::optional<Value> value(GetValue(key_functor.first));
+      bool value_found_in_db(value);
+      itr = values.insert(std::make_pair(key_functor.first,
+                                         std::make_pair(value, value_found_in_db))).first;
+    }
+    key_functor.second(itr->second.first);
+  }
+
+  leveldb::WriteBatch batch;
+  for (const auto& value : values) {
+    if (value.second.first)
+      batch.Put(value.first.ToFixedWidthBuffer().slice(),
+                value.second.first->Serialise()->string());
+    else if (value.second.second)
+      batch.Delete(value.first.ToFixedWidthBuffer().slice());
+  }
+  Write(batch);
 }
 
-// option 1 : Fire functor here with check_holder_result.new_holder & the corresponding value
-// option 2 : create a map<NodeId, std::vector<std::pair<Key, value>>> and return after pruning
 template<typename Key, typename Value>
 typename Db<Key, Value>::TransferInfo Db<Key, Value>::GetTransferInfo(
-    std::shared_ptr<routing::MatrixChange> matrix_change) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  std::vector<std::string> prune_vector;
+    std::shared_ptr<routing::MatrixChange> matrix_change,
+    const std::vector<detail::NameRange>& name_ranges) {
   TransferInfo transfer_info;
-  {
-    std::unique_ptr<leveldb::Iterator> db_iter(leveldb_->NewIterator(leveldb::ReadOptions()));
-    for (db_iter->SeekToFirst(); db_iter->Valid(); db_iter->Next()) {
-      Key key(Key::FixedWidthString(db_iter->key()));
-      auto check_holder_result = matrix_change->CheckHolders(NodeId(key->string()));
-      if (check_holder_result.proximity_status != routing::GroupRangeStatus::kInRange) {
-        if (check_holder_result.new_holders.size() != 0) {
-          assert(check_holder_result.new_holders.size() == 1);
-          auto found_itr = transfer_info.find(check_holder_result.new_holders.at(0));
-          if (found_itr != transfer_info.end()) {
-            found_itr->second.push_back(std::make_pair(key, Value(db_iter->value)));
-          } else {  // create
-            std::vector<KvPair> kv_pair;
-            kv_pair.push_back(std::make_pair(key, Value(db_iter->value)));
-            transfer_info.insert(std::make_pair(check_holder_result.new_holders.at(0), kv_pair));
-          }
-        }
-      } else {
-        prune_vector.push_back(db_iter->key().data());
+  StreamTransferInfo(
+      matrix_change,
+      [&transfer_info](const NodeId& new_holder, const std::vector<KvPair>& contents) {
+        auto& holder_contents(transfer_info[new_holder]);
+        holder_contents.insert(std::end(holder_contents), std::begin(contents),
+                               std::end(contents));
+      },
+      name_ranges);
+  return transfer_info;
+}
+
+template<typename Key, typename Value>
+void Db<Key, Value>::StreamTransferInfo(
+    std::shared_ptr<routing::MatrixChange> matrix_change,
+    TransferFunctor transfer_functor,
+    const std::vector<detail::NameRange>& name_ranges) {
+  assert(transfer_functor);
+  // Pending chunk per new holder, along with its approximate size in bytes.
+  std::map<NodeId, std::pair<std::vector<KvPair>, size_t>> chunks;
+  std::vector<std::pair<std::string, std::string>> prune_vector;
+  auto flush_chunks([&] {
+    for (const auto& chunk : chunks)
+      transfer_functor(chunk.first, chunk.second.first);
+    chunks.clear();
+  });
+
+  const leveldb::Snapshot* snapshot(leveldb_->GetSnapshot());
+  on_scope_exit release_snapshot([&] { leveldb_->ReleaseSnapshot(snapshot); });
+  leveldb::ReadOptions read_options;
+  read_options.snapshot = snapshot;
+  read_options.fill_cache = false;
+  std::unique_ptr<leveldb::Iterator> db_iter(leveldb_->NewIterator(read_options));
+  auto handle_entry([&] {
+    Key key(typename Key::FixedWidthView(db_iter->key()));
+    auto check_holders_result(matrix_change->CheckHolders(NodeId(key.name.string())));
+    for (const auto& new_holder : check_holders_result.new_holders) {
+      auto& chunk(chunks[new_holder]);
+      chunk.first.push_back(std::make_pair(key, Value(db_iter->value().ToString())));
+      chunk.second += db_iter->key().size() + db_iter->value().size();
+      if (chunk.second >= detail::Parameters::max_transfer_chunk_bytes) {
+        transfer_functor(new_holder, chunk.first);
+        chunks.erase(new_holder);
+      }
+    }
+    if (check_holders_result.proximity_status != routing::GroupRangeStatus::kInRange) {
+      prune_vector.push_back(std::make_pair(db_iter->key().ToString(),
+                                            db_iter->value().ToString()));
+      if (prune_vector.size() == kMaxPruneBatchSize_) {
+        flush_chunks();
+        Prune(prune_vector);
+        prune_vector.clear();
       }
     }
+  });
+
+  if (name_ranges.empty()) {
+    for (db_iter->SeekToFirst(); db_iter->Valid(); db_iter->Next())
+      handle_entry();
+  }
+  // Keys start with the name, so each range is a contiguous run of keys.
+  for (const auto& name_range : name_ranges) {
+    const std::string kUpper(name_range.second.string());
+    for (db_iter->Seek(name_range.first.string());
+         db_iter->Valid() &&
+             leveldb::Slice(db_iter->key().data(), NodeId::kSize).compare(kUpper) <= 0;
+         db_iter->Next()) {
+      handle_entry();
+    }
   }
+  if (!db_iter->status().ok())
+    ThrowError(VaultErrors::failed_to_handle_request);
 
-  for (const auto& key_string : prune_vector)
-    leveldb_->Delete(leveldb::WriteOptions(), key_string);  // Ignore Delete failure here ?
-  return transfer_info;
+  flush_chunks();
+  Prune(prune_vector);
 }
 
 // Ignores values which are already in db
 template<typename Key, typename Value>
 void Db<Key, Value>::HandleTransfer(const std::vector<std::pair<Key, Value>>& contents) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  for (const auto& kv_pair : contents) {
-    if (!GetValue(kv_pair.first))
-      Put(kv_pair);
+  std::vector<typename Key::FixedWidthBuffer> key_buffers;
+  key_buffers.reserve(contents.size());
+  for (const auto& kv_pair : contents)
+    key_buffers.push_back(kv_pair.first.ToFixedWidthBuffer());
+  auto locks(mutexes_.Lock(KeySlices(key_buffers)));
+  leveldb::WriteBatch batch;
+  for (size_t i(0); i != contents.size(); ++i) {
+    if (!GetValue(contents[i].first))
+      batch.Put(key_buffers[i].slice(), contents[i].second.Serialise()->string());
   }
+  Write(batch);
 }
 
 // private members
@@ -158,7 +266,7 @@ boost::optional<Value> Db<Key, Value>::GetValue(const Key& key) {
   leveldb::ReadOptions read_options;
   read_options.verify_checksums = true;
   std::string value_string;
-  leveldb::Status status(leveldb_->Get(read_options, key.ToFixedWidthString().string(),
+  leveldb::Status status(leveldb_->Get(read_options, key.ToFixedWidthBuffer().slice(),
                                        &value_string));
   boost::optional<Value> value;
   if (status.ok()) {
@@ -171,20 +279,48 @@ boost::optional<Value> Db<Key, Value>::GetValue(const Key& key) {
 }
 
 template<typename Key, typename Value>
-void Db<Key, Value>::Put(const KvPair& key_value_pair) {
-  leveldb::Status status(leveldb_->Put(leveldb::WriteOptions(),
-                                       key_value_pair.first.ToFixedWidthString().string(),
-                                       key_value_pair.second.Serialise()->string()));
+void Db<Key, Value>::Prune(
+    const std::vector<std::pair<std::string, std::string>>& snapshot_entries) {
+  if (snapshot_entries.empty())
+    return;
+  std::vector<leveldb::Slice> key_slices;
+  key_slices.reserve(snapshot_entries.size());
+  for (const auto& snapshot_entry : snapshot_entries)
+    key_slices.push_back(snapshot_entry.first);
+  auto locks(mutexes_.Lock(key_slices));
+  // A Commit may have changed or deleted an entry since the snapshot was taken, in which case the
+  // transferred value is stale and the entry is left alone.
+  leveldb::ReadOptions read_options;
+  read_options.verify_checksums = true;
+  leveldb::WriteBatch batch;
+  std::string value_string;
+  for (const auto& snapshot_entry : snapshot_entries) {
+    leveldb::Status status(leveldb_->Get(read_options, snapshot_entry.first, &value_string));
+    if (status.ok()) {
+      if (value_string == snapshot_entry.second)
+        batch.Delete(snapshot_entry.first);
+    } else if (!status.IsNotFound()) {
+      ThrowError(VaultErrors::failed_to_handle_request);
+    }
+  }
+  Write(batch);
+}
+
+template<typename Key, typename Value>
+void Db<Key, Value>::Write(leveldb::WriteBatch& batch) {
+  leveldb::Status status(leveldb_->Write(leveldb::WriteOptions(), &batch));
   if (!status.ok())
     ThrowError(VaultErrors::failed_to_handle_request);
 }
 
 template<typename Key, typename Value>
-void Db<Key, Value>::Delete(const Key& key) {
-  leveldb::Status status(leveldb_->Delete(leveldb::WriteOptions(),
-                                          key.ToFixedWidthString().string()));
-  if (status.ok())
-    ThrowError(VaultErrors::failed_to_handle_request);
+std::vector<leveldb::Slice> Db<Key, Value>::KeySlices(
+    const std::vector<typename Key::FixedWidthBuffer>& key_buffers) {
+  std::vector<leveldb::Slice> key_slices;
+  key_slices.reserve(key_buffers.size());
+  for (const auto& key_buffer : key_buffers)
+    key_slices.push_back(key_buffer.slice());
+  return key_slices;
 }
 
 }  // namespace vault
@@ -18,6 +18,8 @@
 
 #include "maidsafe/vault/demultiplexer.h"
 
+#include <cstdint>
+
 #include "maidsafe/common/log.h"
 #include "maidsafe/passport/types.h"
 #include "maidsafe/data_types/data_type_values.h"
@@ -34,16 +36,183 @@ namespace maidsafe {
 
 namespace vault {
 
+namespace detail {
+
+namespace {
+
+// Field numbers in nfs's serialised MessageWrapper protobuf.  BEH_PeekNfsSerialisedWrapper checks
+// them against wrappers serialised by nfs.
+const uint32_t kActionFieldNumber(1);
+const uint32_t kDestinationPersonaFieldNumber(3);
+
+bool ReadVarint(const std::string& buffer, size_t& offset, uint64_t& value) {
+  value = 0;
+  for (int shift(0); shift < 64 && offset < buffer.size(); shift += 7) {
+    auto byte(static_cast<unsigned char>(buffer[offset++]));
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+bool Skip(const std::string& buffer, size_t& offset, uint64_t count) {
+  if (count > buffer.size() - offset)
+    return false;
+  offset += static_cast<size_t>(count);
+  return true;
+}
+
+uint64_t Affinity(const NodeId& node_id) {
+  // NodeIds are uniformly distributed, so any eight bytes make a good hash.
+  auto id(node_id.string());
+  uint64_t affinity(0);
+  for (size_t i(0); i != sizeof(affinity); ++i)
+    affinity = (affinity << 8) | static_cast<unsigned char>(id[i]);
+  return affinity;
+}
+
+// Walks the top-level fields of 'buffer', passing the value of each varint field numbered
+// 'field_number' to 'functor'.  As with a full parse, the last occurrence of the field wins.
+template<typename Functor>
+bool PeekVarintField(const std::string& buffer, uint32_t field_number, Functor functor) {
+  bool found(false);
+  size_t offset(0);
+  uint64_t key(0), value(0);
+  while (offset < buffer.size()) {
+    if (!ReadVarint(buffer, offset, key))
+      return false;
+    switch (key & 0x7) {
+      case 0:  // varint
+        if (!ReadVarint(buffer, offset, value))
+          return false;
+        if ((key >> 3) == field_number) {
+          functor(value);
+          found = true;
+        }
+        break;
+      case 1:  // 64-bit
+        if (!Skip(buffer, offset, 8))
+          return false;
+        break;
+      case 2:  // length-delimited, e.g. the payload
+        if (!ReadVarint(buffer, offset, value) || !Skip(buffer, offset, value))
+          return false;
+        break;
+      case 5:  // 32-bit
+        if (!Skip(buffer, offset, 4))
+          return false;
+        break;
+      default:
+        return false;
+    }
+  }
+  return found;
+}
+
+}  // unnamed namespace
+
+uint64_t MessageAffinity(const routing::SingleToSingleMessage& routing_message) {
+  return Affinity(routing_message.sender.data);
+}
+
+uint64_t MessageAffinity(const routing::SingleToGroupMessage& routing_message) {
+  return Affinity(routing_message.receiver.data);
+}
+
+uint64_t MessageAffinity(const routing::GroupToSingleMessage& routing_message) {
+  return Affinity(routing_message.sender.group_id.data);
+}
+
+uint64_t MessageAffinity(const routing::GroupToGroupMessage& routing_message) {
+  return Affinity(routing_message.receiver.data);
+}
+
+bool PeekDestinationPersona(const std::string& serialised_message_wrapper, nfs::Persona& persona) {
+  return PeekVarintField(serialised_message_wrapper, kDestinationPersonaFieldNumber,
+                         [&persona](uint64_t value) {
+                           persona = static_cast<nfs::Persona>(static_cast<int32_t>(value));
+                         });
+}
+
+bool PeekAction(const std::string& serialised_message_wrapper, nfs::MessageAction& action) {
+  return PeekVarintField(serialised_message_wrapper, kActionFieldNumber,
+                         [&action](uint64_t value) {
+                           action = static_cast<nfs::MessageAction>(static_cast<int32_t>(value));
+                         });
+}
+
+Lane MessageLane(nfs::MessageAction action) {
+  switch (action) {
+    case nfs::MessageAction::kSynchronise:
+    case nfs::MessageAction::kAccountTransfer:
+      return Lane::kSync;
+    case nfs::MessageAction::kGet:
+    case nfs::MessageAction::kGetRequest:
+    case nfs::MessageAction::kGetBranch:
+    case nfs::MessageAction::kGetBranchRequest:
+    case nfs::MessageAction::kGetPmidAccount:
+    case nfs::MessageAction::kGetPmidTotals:
+      return Lane::kGet;
+    default:
+      return Lane::kPut;
+  }
+}
+
+}  // namespace detail
+
 Demultiplexer::Demultiplexer(nfs::Service<MaidManagerService>& maid_manager_service,
                              nfs::Service<VersionManagerService>& version_manager_service,
                              nfs::Service<DataManagerService>& data_manager_service,
                              nfs::Service<PmidManagerService>& pmid_manager_service,
-                             nfs::Service<PmidNodeService>& pmid_node_service)
+                             nfs::Service<PmidNodeService>& pmid_node_service,
+                             const PersonaExecutorPolicies& executor_policies)
     : maid_manager_service_(maid_manager_service),
       version_manager_service_(version_manager_service),
       data_manager_service_(data_manager_service),
       pmid_manager_service_(pmid_manager_service),
-      pmid_node_service_(pmid_node_service) {}
+      pmid_node_service_(pmid_node_service),
+      pool_(),
+      maid_manager_executor_("MaidManager", pool_, executor_policies.maid_manager,
+                             kExecutorCount_),
+      version_manager_executor_("VersionManager", pool_, executor_policies.version_manager,
+                                kExecutorCount_),
+      data_manager_executor_("DataManager", pool_, executor_policies.data_manager,
+                             kExecutorCount_),
+      pmid_manager_executor_("PmidManager", pool_, executor_policies.pmid_manager,
+                             kExecutorCount_),
+      pmid_node_executor_("PmidNode", pool_, executor_policies.pmid_node, kExecutorCount_) {}
+
+bool Demultiplexer::Post(nfs::Persona persona, Lane lane, PersonaExecutor::Task task) {
+  auto executor(Executor(persona));
+  if (!executor) {
+    LOG(kError) << "Unhandled Persona";
+    return false;
+  }
+  return executor->Post(lane, task);
+}
+
+PersonaExecutor::Stats Demultiplexer::ExecutorStats(nfs::Persona persona) {
+  auto executor(Executor(persona));
+  return executor ? executor->stats() : PersonaExecutor::Stats();
+}
+
+PersonaExecutor* Demultiplexer::Executor(nfs::Persona persona) {
+  switch (persona) {
+    case nfs::Persona::kMaidManager:
+      return &maid_manager_executor_;
+    case nfs::Persona::kVersionManager:
+      return &version_manager_executor_;
+    case nfs::Persona::kDataManager:
+      return &data_manager_executor_;
+    case nfs::Persona::kPmidManager:
+      return &pmid_manager_executor_;
+    case nfs::Persona::kPmidNode:
+      return &pmid_node_executor_;
+    default:
+      return nullptr;
+  }
+}
 
 }  // namespace vault
 
@@ -19,8 +19,9 @@
 #ifndef MAIDSAFE_VAULT_DEMULTIPLEXER_H_
 #define MAIDSAFE_VAULT_DEMULTIPLEXER_H_
 
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <type_traits>
 
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/types.h"
@@ -31,83 +32,168 @@
 #include "maidsafe/vault/data_manager/service.h"
 #include "maidsafe/vault/maid_manager/service.h"
 #include "maidsafe/vault/pmid_manager/service.h"
+#include "maidsafe/vault/persona_executor.h"
 #include "maidsafe/vault/pmid_node/service.h"
 #include "maidsafe/vault/version_manager/service.h"
+#include "maidsafe/vault/work_stealing_pool.h"
 
 namespace maidsafe {
 
 namespace vault {
 
+namespace detail {
+
+// Reads the destination persona from 'serialised_message_wrapper' by walking the top-level protobuf
+// fields, without parsing or copying the payload.  Returns false if the wrapper is malformed or
+// doesn't contain the field.
+bool PeekDestinationPersona(const std::string& serialised_message_wrapper, nfs::Persona& persona);
+// As above, for the message's action.
+bool PeekAction(const std::string& serialised_message_wrapper, nfs::MessageAction& action);
+
+// The executor lane which a message with 'action' is handled in.
+Lane MessageLane(nfs::MessageAction action);
+
+// The affinity under which a message's handling is scheduled.  Messages addressed to a group are
+// keyed by the group, i.e. the account or data name they act on; others by their sender's group
+// or node.  Messages with the same affinity are handled in the order they arrive.
+uint64_t MessageAffinity(const routing::SingleToSingleMessage& routing_message);
+uint64_t MessageAffinity(const routing::SingleToGroupMessage& routing_message);
+uint64_t MessageAffinity(const routing::GroupToSingleMessage& routing_message);
+uint64_t MessageAffinity(const routing::GroupToGroupMessage& routing_message);
+
+}  // namespace detail
+
+// Hands each message to the executor of its destination persona.  All executors share one
+// work-stealing pool.
 class Demultiplexer {
  public:
   Demultiplexer(nfs::Service<MaidManagerService>& maid_manager_service,
                 nfs::Service<VersionManagerService>& version_manager_service,
                 nfs::Service<DataManagerService>& data_manager_service,
                 nfs::Service<PmidManagerService>& pmid_manager_service,
-                nfs::Service<PmidNodeService>& pmid_node_service);
+                nfs::Service<PmidNodeService>& pmid_node_service,
+                const PersonaExecutorPolicies& executor_policies = PersonaExecutorPolicies());
+  // Doesn't block on the persona's handling of the message.
   template<typename T>
-  void HandleMessage(const T& routing_message);
+  void HandleMessage(std::shared_ptr<const T> routing_message);
+  // Runs 'task' in 'lane' of 'persona''s executor.  Returns false if the task was shed.
+  bool Post(nfs::Persona persona, Lane lane, PersonaExecutor::Task task);
+  PersonaExecutor::Stats ExecutorStats(nfs::Persona persona);
+  // Called on routing's thread.  Returns true if a GET request passing through this node was
+  // answered from the PmidNode's cache, in which case routing doesn't forward it.
   template<typename T>
-  bool GetFromCache(T& /*serialised_message*/) { return true; }
+  bool GetFromCache(const T& routing_message);
+  // Caches the data carried by a GET response passing through this node.  The store happens on
+  // the PmidNode's executor.
   template<typename T>
-  void StoreInCache(const T& serialised_message);
+  void StoreInCache(const T& routing_message);
 
  private:
+  // Returns nullptr for personas which this vault doesn't run.
+  PersonaExecutor* Executor(nfs::Persona persona);
+  // Only messages for a known persona reach here, and are only then fully parsed.
+  template<typename T>
+  void Dispatch(nfs::Persona persona, const T& routing_message);
+  template<typename ServiceType, typename T>
+  void Dispatch(nfs::Service<ServiceType>& service, const T& routing_message);
+
 //  template<typename MessageType>
 //  NonEmptyString HandleGetFromCache(const nfs::Message& message);
 //  void HandleStoreInCache(const nfs::Message& message);
 
+  // The number of persona executors sharing 'pool_'.
+  static const size_t kExecutorCount_ = 5;
   nfs::Service<MaidManagerService>& maid_manager_service_;
   nfs::Service<VersionManagerService>& version_manager_service_;
   nfs::Service<DataManagerService>& data_manager_service_;
   nfs::Service<PmidManagerService>& pmid_manager_service_;
   nfs::Service<PmidNodeService>& pmid_node_service_;
+  WorkStealingPool pool_;
+  PersonaExecutor maid_manager_executor_;
+  PersonaExecutor version_manager_executor_;
+  PersonaExecutor data_manager_executor_;
+  PersonaExecutor pmid_manager_executor_;
+  PersonaExecutor pmid_node_executor_;
 };
 
 template<typename T>
-void Demultiplexer::HandleMessage(const T& routing_message) {
-  auto wrapper_tuple(nfs::ParseMessageWrapper(routing_message.contents));
-  const auto& destination_persona(std::get<2>(wrapper_tuple));
-  static_assert(std::is_same<decltype(destination_persona),
-                             const nfs::detail::DestinationTaggedValue&>::value,
-                "The value retrieved from the tuple isn't the destination type, but should be.");
-  switch (destination_persona.data) {
+void Demultiplexer::HandleMessage(std::shared_ptr<const T> routing_message) {
+  nfs::Persona destination_persona;
+  nfs::MessageAction action;
+  if (!detail::PeekDestinationPersona(routing_message->contents, destination_persona) ||
+      !detail::PeekAction(routing_message->contents, action)) {
+    LOG(kError) << "Malformed message wrapper";
+    return;
+  }
+  auto executor(Executor(destination_persona));
+  if (!executor) {
+    LOG(kError) << "Unhandled Persona";
+    return;
+  }
+  executor->Post(detail::MessageLane(action), detail::MessageAffinity(*routing_message),
+                 [this, destination_persona, routing_message] {
+                   Dispatch(destination_persona, *routing_message);
+                 });
+}
+
+template<typename T>
+void Demultiplexer::Dispatch(nfs::Persona persona, const T& routing_message) {
+  switch (persona) {
     case nfs::Persona::kMaidManager:
-      return maid_manager_service_.HandleMessage(wrapper_tuple, routing_message.sender,
-                                                 routing_message.receiver);
+      return Dispatch(maid_manager_service_, routing_message);
     case nfs::Persona::kVersionManager:
-      return version_manager_service_.HandleMessage(wrapper_tuple, routing_message.sender,
-                                                    routing_message.receiver);
+      return Dispatch(version_manager_service_, routing_message);
     case nfs::Persona::kDataManager:
-      return data_manager_service_.HandleMessage(wrapper_tuple, routing_message.sender,
-                                                 routing_message.receiver);
+      return Dispatch(data_manager_service_, routing_message);
     case nfs::Persona::kPmidManager:
-      return pmid_manager_service_.HandleMessage(wrapper_tuple, routing_message.sender,
-                                                 routing_message.receiver);
+      return Dispatch(pmid_manager_service_, routing_message);
     case nfs::Persona::kPmidNode:
-      return pmid_node_service_.HandleMessage(wrapper_tuple, routing_message.sender,
-                                              routing_message.receiver);
+      return Dispatch(pmid_node_service_, routing_message);
     default:
       LOG(kError) << "Unhandled Persona";
   }
 }
 
-// NEEDS REFACTORING
-//template<typename T>
-//bool Demultiplexer::GetFromCache(const T& serialised_message) {
-//  auto wrapper_tuple(nfs::ParseMessageWrapper(serialised_message.contents));
-//  return pmid_node_service_.GetFromCache(wrapper_tuple,
-//                                         serialised_message.sender,
-//                                         serialised_message.receiver);
-//}
-
-//template<typename T>
-//void Demultiplexer::StoreInCache(const T& serialised_message) {
-//  auto wrapper_tuple(nfs::ParseMessageWrapper(serialised_message.contents));
-//  pmid_node_service_.StoreInCache(wrapper_tuple,
-//                                  serialised_message.sender,
-//                                  serialised_message.receiver);
-//}
+template<typename ServiceType, typename T>
+void Demultiplexer::Dispatch(nfs::Service<ServiceType>& service, const T& routing_message) {
+  service.HandleMessage(nfs::ParseMessageWrapper(routing_message.contents),
+                        routing_message.sender, routing_message.receiver);
+}
+
+template<typename T>
+bool Demultiplexer::GetFromCache(const T& routing_message) {
+  // Most messages aren't GET requests, and are rejected here without a full parse.
+  nfs::MessageAction action;
+  if (!detail::PeekAction(routing_message.contents, action) ||
+      action != nfs::MessageAction::kGetRequest) {
+    return false;
+  }
+  try {
+    return pmid_node_service_.GetFromCache(nfs::ParseMessageWrapper(routing_message.contents),
+                                           routing_message.sender, routing_message.receiver);
+  }
+  catch(const std::exception& e) {
+    LOG(kWarning) << "Failed to check cache: " << e.what();
+    return false;
+  }
+}
+
+template<typename T>
+void Demultiplexer::StoreInCache(const T& routing_message) {
+  nfs::MessageAction action;
+  if (!detail::PeekAction(routing_message.contents, action) ||
+      action != nfs::MessageAction::kGetResponse) {
+    return;
+  }
+  // Only GET responses are copied for the deferred store.
+  auto shared_message(std::make_shared<const T>(routing_message));
+  pmid_node_executor_.Post(Lane::kGet, detail::MessageAffinity(routing_message),
+                           [this, shared_message] {
+                             pmid_node_service_.StoreInCache(
+                                 nfs::ParseMessageWrapper(shared_message->contents),
+                                 shared_message->sender, shared_message->receiver);
+                           });
+}
 
 }  // namespace vault
 
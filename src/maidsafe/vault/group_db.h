@@ -20,13 +20,17 @@
 #define MAIDSAFE_VAULT_GROUP_DB_H_
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -34,16 +38,43 @@
 #include "boost/filesystem/path.hpp"
 #include "boost/optional/optional.hpp"
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 
 #include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
 #include "maidsafe/common/types.h"
 //#include "maidsafe/vault/group_key.h"
+#include "maidsafe/vault/key_utils.h"
+#include "maidsafe/vault/parameters.h"
+#include "maidsafe/vault/striped_mutex.h"
 #include "maidsafe/vault/utils.h"
 
 namespace maidsafe {
 
 namespace vault {
 
+// Limits of a GroupDb's write-back cache.  Up to 'metadata_cache_size' groups' metadata is kept
+// decoded in memory.  Committed updates are held there (values in a pending overlay) and written to
+// leveldb in a single batch once 'max_unflushed_commits' are pending, or 'flush_interval' after the
+// previous write (zero disables the timed write).  As each write covers every commit made before
+// it, a crash loses only the most recent commits and leaves the db as it was after an earlier one.
+// With 'sync_flushes', each write also waits for leveldb's log to reach the disk.
+struct GroupDbPolicy {
+  GroupDbPolicy()
+      : metadata_cache_size(detail::Parameters::group_db_metadata_cache_size),
+        max_unflushed_commits(detail::Parameters::group_db_max_unflushed_commits),
+        flush_interval(detail::Parameters::group_db_flush_interval),
+        sync_flushes(detail::Parameters::group_db_sync_flushes) {}
+  size_t metadata_cache_size, max_unflushed_commits;
+  std::chrono::steady_clock::duration flush_interval;
+  bool sync_flushes;
+};
+
+struct GroupDbStats {
+  GroupDbStats() : metadata_hits(0), metadata_misses(0), evicted(0), flushes(0) {}
+  uint64_t metadata_hits, metadata_misses, evicted, flushes;
+};
+
 template<typename Persona>
 class GroupDb {
  public:
@@ -61,7 +92,14 @@ class GroupDb {
     std::vector<KvPair> kv_pair;
   };
 
-  GroupDb();
+  // Uses a temporary db, destroyed along with this GroupDb.
+  explicit GroupDb(size_t lock_stripe_count = detail::Parameters::db_lock_stripe_count,
+                   const GroupDbPolicy& policy = GroupDbPolicy());
+  // Opens the db at 'db_path', creating it if missing, and reloads its groups.  The db is kept, and
+  // pending updates are flushed to it on destruction.
+  explicit GroupDb(const boost::filesystem::path& db_path,
+                   size_t lock_stripe_count = detail::Parameters::db_lock_stripe_count,
+                   const GroupDbPolicy& policy = GroupDbPolicy());
   ~GroupDb();
 
   void AddGroup(const GroupName& group_name, const Metadata& metadata);
@@ -72,73 +110,295 @@ class GroupDb {
   // For atomically updating metadata and value
   void Commit(const Key& key,
               std::function<void(Metadata& metadata, boost::optional<Value>& value)> functor);
-  TransferInfo GetTransferInfo(std::shared_ptr<routing::MatrixChange> matrix_change);
+  // If 'name_ranges' is non-empty, only groups whose names lie in those ranges are considered (see
+  // detail::GetNameRangesWithinRadius); otherwise all groups are checked.
+  TransferInfo GetTransferInfo(std::shared_ptr<routing::MatrixChange> matrix_change,
+                               const std::vector<detail::NameRange>& name_ranges =
+                                   std::vector<detail::NameRange>());
   void HandleTransfer(const std::vector<Contents>& contents);
 
+  // These don't take a group lock; leveldb reads are consistent against concurrent writes.  Both
+  // see committed updates whether or not they've been flushed.
   boost::optional<Metadata> GetMetadata(const GroupName& group_name);
   boost::optional<Value> GetValue(const Key& key);
 
+  // Writes all committed updates to leveldb.  Throws if leveldb fails.
+  void Flush();
+  GroupDbStats stats();
+
  private:
   typedef uint32_t GroupId;
+  static const int kPrefixWidth_ = 2;
+  static const GroupId kDirectoryGroupId_ = (1 << (8 * kPrefixWidth_)) - 1;
+
+  struct CachedMetadata {
+    CachedMetadata(Metadata metadata_in, std::list<GroupId>::iterator lru_position_in)
+        : metadata(std::move(metadata_in)), dirty(false), lru_position(lru_position_in) {}
+    Metadata metadata;
+    bool dirty;
+    std::list<GroupId>::iterator lru_position;
+  };
+
   GroupDb(const GroupDb&);
   GroupDb& operator=(const GroupDb&);
   GroupDb(GroupDb&&);
   GroupDb& operator=(GroupDb&&);
 
-  Metadata Get(const GroupName& group_name);
+  // Each group's entries are keyed under its GroupId as a kPrefixWidth_ byte prefix.  The highest
+  // GroupId is reserved as the prefix of the group directory, which maps each group's name to its
+  // GroupId, and is loaded into 'group_map_' and 'group_names_' on construction.
+  static std::string DirectoryKey(const GroupName& group_name);
+  void LoadGroupDirectory();
+  // Both must be called with 'group_map_mutex_' held.
+  GroupId AllocateGroupId();
+  void ReleaseGroupId(GroupId group_id);
+  // Deleted groups' key ranges are compacted by 'background_thread_', so that deleting a group
+  // neither blocks on nor triggers a compaction of the whole db.  The thread also runs the timed
+  // flushes.
+  void ScheduleCompaction(GroupId group_id);
+  void RunBackgroundTasks();
+
+  // A group's metadata is keyed by its bare GroupId prefix, and each of its values by the prefix
+  // followed by the Key's fixed-width name and type.
+  static std::string MetadataKey(GroupId group_id);
+  typedef detail::FixedWidthBuffer<kPrefixWidth_ + Key::kFixedWidthSize> ValueKeyBuffer;
+  static ValueKeyBuffer ValueKey(GroupId group_id, const Key& key);
+  // Throws VaultErrors::no_such_account if the group doesn't exist.
+  GroupId FindGroupId(const GroupName& group_name);
+  // Returns false if 'db_key' isn't in the db; throws on other leveldb errors.
+  bool Read(const leveldb::Slice& db_key, std::string& result);
+
+  // Only caches metadata read from leveldb if 'cache_on_miss', which requires the group's lock.
+  Metadata Get(GroupId group_id, bool cache_on_miss);
   Value Get(const Key& key);
-  void PutMetadata(const GroupName& group_name, const Metadata& metadata);
   void DeleteGroupEntries(const GroupName& group_name);
-  void PutValue(const KvPair& key_value);
-  void DeleteValue(const Key& key);
 
-  static const int kPrefixWidth_ = 2;
+  // The remaining functions must be called with 'cache_mutex_' held.
+  // Caches 'metadata' as the group's latest, marking it for writing if 'dirty'.
+  void PutMetadata(GroupId group_id, Metadata metadata, bool dirty);
+  void EvictMetadata();
+  void EraseCachedGroup(GroupId group_id);
+  // Stages an update of a value (or directory entry); a null 'value' stages its deletion.
+  void PutPending(const std::string& db_key, const boost::optional<std::string>& value);
+  // Counts a completed commit, flushing if it's reached the policy's limit.
+  void CountCommit();
+  // Writes 'batch' followed by all dirty metadata and staged updates to leveldb as one batch.
+  // Returns false, leaving the updates to be retried, if leveldb fails.
+  bool FlushLocked(leveldb::WriteBatch& batch);
+  bool FlushLocked();
+
   const boost::filesystem::path kDbPath_;
-  std::mutex mutex_;
+  const bool kTemporaryDb_;
+  const GroupDbPolicy kPolicy_;
+  // Serialises all operations on a given group.  Where both are required, a group's stripe is
+  // always locked before 'group_map_mutex_'.
+  StripedMutex group_mutexes_;
+  std::mutex group_map_mutex_;
   std::unique_ptr<leveldb::DB> leveldb_;
   std::map<GroupName, GroupId> group_map_;
+  // Indexed by GroupId, pointing at the keys of 'group_map_'; null where the GroupId is free.
+  std::vector<const GroupName*> group_names_;
+  std::vector<GroupId> free_group_ids_;
+  // Guards the write-back cache.  May be locked while holding a group's stripe, but never while
+  // holding 'group_map_mutex_'.
+  std::mutex cache_mutex_;
+  std::map<GroupId, CachedMetadata> metadata_cache_;
+  // Most recently used first.
+  std::list<GroupId> metadata_lru_;
+  std::vector<GroupId> dirty_group_ids_;
+  // Ordered so that a deleted group's staged updates can be dropped as a range.
+  std::map<std::string, boost::optional<std::string>> pending_writes_;
+  size_t unflushed_commits_;
+  GroupDbStats stats_;
+  std::mutex background_mutex_;
+  std::condition_variable background_condition_;
+  std::set<GroupId> pending_compactions_;
+  bool background_stopped_;
+  std::thread background_thread_;
 };
 
 template<typename Persona>
-GroupDb<Persona>::GroupDb()
+GroupDb<Persona>::GroupDb(size_t lock_stripe_count, const GroupDbPolicy& policy)
     : kDbPath_(boost::filesystem::unique_path()),
-      mutex_(),
+      kTemporaryDb_(true),
+      kPolicy_(policy),
+      group_mutexes_(lock_stripe_count),
+      group_map_mutex_(),
       leveldb_(InitialiseLevelDb(kDbPath_)),
-      group_map_() {}
+      group_map_(),
+      group_names_(),
+      free_group_ids_(),
+      cache_mutex_(),
+      metadata_cache_(),
+      metadata_lru_(),
+      dirty_group_ids_(),
+      pending_writes_(),
+      unflushed_commits_(0),
+      stats_(),
+      background_mutex_(),
+      background_condition_(),
+      pending_compactions_(),
+      background_stopped_(false),
+      background_thread_([this] { RunBackgroundTasks(); }) {}
+
+template<typename Persona>
+GroupDb<Persona>::GroupDb(const boost::filesystem::path& db_path, size_t lock_stripe_count,
+                          const GroupDbPolicy& policy)
+    : kDbPath_(db_path),
+      kTemporaryDb_(false),
+      kPolicy_(policy),
+      group_mutexes_(lock_stripe_count),
+      group_map_mutex_(),
+      leveldb_(OpenLevelDb(kDbPath_)),
+      group_map_(),
+      group_names_(),
+      free_group_ids_(),
+      cache_mutex_(),
+      metadata_cache_(),
+      metadata_lru_(),
+      dirty_group_ids_(),
+      pending_writes_(),
+      unflushed_commits_(0),
+      stats_(),
+      background_mutex_(),
+      background_condition_(),
+      pending_compactions_(),
+      background_stopped_(false),
+      background_thread_() {
+  LoadGroupDirectory();
+  background_thread_ = std::thread([this] { RunBackgroundTasks(); });
+}
 
 template<typename Persona>
 GroupDb<Persona>::~GroupDb() {
-  leveldb::DestroyDB(kDbPath_.string(), leveldb::Options());
+  {
+    std::lock_guard<std::mutex> lock(background_mutex_);
+    background_stopped_ = true;
+  }
+  background_condition_.notify_one();
+  background_thread_.join();
+  if (!kTemporaryDb_) {
+    try {
+      Flush();
+    }
+    catch(const std::exception& e) {
+      LOG(kError) << "Failed to flush group db on shutdown: " << e.what();
+    }
+  }
+  if (kTemporaryDb_) {
+    leveldb_.reset();
+    leveldb::DestroyDB(kDbPath_.string(), leveldb::Options());
+  }
 }
 
 template<typename Persona>
-void GroupDb<Persona>::AddGroup(const GroupName& group_name, const Metadata& metadata) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  static const uint64_t kGroupsLimit(static_cast<GroupId>(std::pow(256, kPrefixWidth_)));
-  if (group_map_.size() == kGroupsLimit - 1)
+std::string GroupDb<Persona>::DirectoryKey(const GroupName& group_name) {
+  return detail::ToFixedWidthString<kPrefixWidth_>(kDirectoryGroupId_) + group_name->string();
+}
+
+template<typename Persona>
+void GroupDb<Persona>::LoadGroupDirectory() {
+  const std::string kDirectoryPrefix(detail::ToFixedWidthString<kPrefixWidth_>(kDirectoryGroupId_));
+  std::unique_ptr<leveldb::Iterator> iter(leveldb_->NewIterator(leveldb::ReadOptions()));
+  for (iter->Seek(kDirectoryPrefix); iter->Valid() && iter->key().starts_with(kDirectoryPrefix);
+       iter->Next()) {
+    GroupName group_name(Identity(iter->key().ToString().substr(kPrefixWidth_)));
+    GroupId group_id(detail::FromFixedWidthString<kPrefixWidth_>(iter->value().ToString()));
+    if (group_id >= group_names_.size())
+      group_names_.resize(group_id + 1, nullptr);
+    group_names_[group_id] = &group_map_.insert(std::make_pair(group_name, group_id)).first->first;
+  }
+  if (!iter->status().ok())
     ThrowError(VaultErrors::failed_to_handle_request);
-  GroupId group_id(RandomInt32() % kGroupsLimit);
-  while (std::any_of(std::begin(group_map_),
-                     std::end(group_map_),
-                     [&group_id](const std::pair<GroupName, GroupId>& element) {
-                         return group_id == element.second;
-                     })) {
-    group_id = RandomInt32() % kGroupsLimit;
+  for (GroupId group_id(0); group_id != group_names_.size(); ++group_id) {
+    if (!group_names_[group_id])
+      free_group_ids_.push_back(group_id);
   }
-  // TODO Consider using batch operation here
-  if (!(group_map_.insert(std::make_pair(group_name, group_id))).second)
-    ThrowError(VaultErrors::failed_to_handle_request); //TODO change to account already exist!
-  try {
-    PutMetadata(group_name, metadata);
-  } catch (const std::exception&) {
-    group_map_.erase(group_name);
+}
+
+template<typename Persona>
+typename GroupDb<Persona>::GroupId GroupDb<Persona>::AllocateGroupId() {
+  if (!free_group_ids_.empty()) {
+    GroupId group_id(free_group_ids_.back());
+    free_group_ids_.pop_back();
+    return group_id;
+  }
+  if (group_names_.size() == kDirectoryGroupId_)
     ThrowError(VaultErrors::failed_to_handle_request);
+  group_names_.push_back(nullptr);
+  return static_cast<GroupId>(group_names_.size() - 1);
+}
+
+template<typename Persona>
+void GroupDb<Persona>::ReleaseGroupId(GroupId group_id) {
+  group_names_[group_id] = nullptr;
+  free_group_ids_.push_back(group_id);
+}
+
+template<typename Persona>
+void GroupDb<Persona>::ScheduleCompaction(GroupId group_id) {
+  {
+    std::lock_guard<std::mutex> lock(background_mutex_);
+    pending_compactions_.insert(group_id);
   }
+  background_condition_.notify_one();
+}
+
+template<typename Persona>
+void GroupDb<Persona>::RunBackgroundTasks() {
+  const bool kTimedFlush(kPolicy_.flush_interval != std::chrono::steady_clock::duration::zero());
+  auto next_flush(std::chrono::steady_clock::now() + kPolicy_.flush_interval);
+  auto woken([this] { return background_stopped_ || !pending_compactions_.empty(); });
+  std::unique_lock<std::mutex> lock(background_mutex_);
+  for (;;) {
+    if (kTimedFlush)
+      background_condition_.wait_until(lock, next_flush, woken);
+    else
+      background_condition_.wait(lock, woken);
+    // Pending compactions are dropped on shutdown; leveldb compacts the ranges eventually anyway.
+    if (background_stopped_)
+      return;
+    std::set<GroupId> group_ids;
+    group_ids.swap(pending_compactions_);
+    lock.unlock();
+    if (kTimedFlush && std::chrono::steady_clock::now() >= next_flush) {
+      {
+        std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+        FlushLocked();
+      }
+      next_flush = std::chrono::steady_clock::now() + kPolicy_.flush_interval;
+    }
+    for (const auto& group_id : group_ids) {
+      // The range covers exactly the keys prefixed by 'group_id', whose successor can't exceed the
+      // directory's reserved GroupId.
+      const std::string kBegin(detail::ToFixedWidthString<kPrefixWidth_>(group_id));
+      const std::string kEnd(detail::ToFixedWidthString<kPrefixWidth_>(group_id + 1));
+      const leveldb::Slice kBeginSlice(kBegin), kEndSlice(kEnd);
+      leveldb_->CompactRange(&kBeginSlice, &kEndSlice);
+    }
+    lock.lock();
+  }
+}
+
+template<typename Persona>
+void GroupDb<Persona>::AddGroup(const GroupName& group_name, const Metadata& metadata) {
+  std::lock_guard<std::mutex> group_lock(group_mutexes_.Stripe(group_name->string()));
+  std::unique_lock<std::mutex> map_lock(group_map_mutex_);
+  if (group_map_.count(group_name) != 0)
+    ThrowError(VaultErrors::failed_to_handle_request); //TODO change to account already exist!
+  GroupId group_id(AllocateGroupId());  // throws if all GroupIds are in use
+  group_names_[group_id] = &group_map_.insert(std::make_pair(group_name, group_id)).first->first;
+  map_lock.unlock();
+  std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+  PutPending(DirectoryKey(group_name),
+             boost::optional<std::string>(detail::ToFixedWidthString<kPrefixWidth_>(group_id)));
+  PutMetadata(group_id, metadata, true);
+  CountCommit();
 }
 
 template<typename Persona>
 void GroupDb<Persona>::DeleteGroup(const GroupName& group_name) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<std::mutex> group_lock(group_mutexes_.Stripe(group_name->string()));
   DeleteGroupEntries(group_name);
 }
 
@@ -146,10 +406,13 @@ template<typename Persona>
 void GroupDb<Persona>::Commit(const GroupName& group_name,
                               std::function<void(Metadata& metadata)> functor) {
   assert(functor);
-  std::lock_guard<std::mutex> lock(mutex_);
-  Metadata metadata(Get(group_name));  // throws
+  std::lock_guard<std::mutex> group_lock(group_mutexes_.Stripe(group_name->string()));
+  GroupId group_id(FindGroupId(group_name));  // throws
+  Metadata metadata(Get(group_id, true));  // throws
   functor(metadata);
-  PutMetadata(group_name, metadata);
+  std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+  PutMetadata(group_id, std::move(metadata), true);
+  CountCommit();
 }
 
 template<typename Persona>
@@ -157,37 +420,56 @@ void GroupDb<Persona>::Commit(
     const Key& key,
     std::function<void(Metadata& metadata, boost::optional<Value>& value)> functor) {
   assert(functor);
-  Metadata metadata(Get(key.group_name));  // throws
+  std::lock_guard<std::mutex> group_lock(group_mutexes_.Stripe(key.group_name->string()));
+  GroupId group_id(FindGroupId(key.group_name));  // throws
+  Metadata metadata(Get(group_id, true));  // throws
   boost::optional<Value> value(GetValue(key));
   functor(metadata, value);
-  // TODO Consider using batch operation here
-  if(value)
-    PutValue(std::make_pair(key, *value));
-  else
-    DeleteValue(key);
-  PutMetadata(key.group_name, metadata);
+  boost::optional<std::string> serialised_value;
+  if (value)
+    serialised_value = value->Serialise();
+  std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+  PutPending(ValueKey(group_id, key).string(), serialised_value);
+  PutMetadata(group_id, std::move(metadata), true);
+  CountCommit();
 }
 
 template<typename Persona>
 typename GroupDb<Persona>::TransferInfo GroupDb<Persona>::GetTransferInfo(
-    std::shared_ptr<routing::MatrixChange> matrix_change) {
-  std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<routing::MatrixChange> matrix_change,
+    const std::vector<detail::NameRange>& name_ranges) {
+  auto group_locks(group_mutexes_.LockAll());
+  std::map<GroupName, GroupId> group_map;
+  {
+    std::lock_guard<std::mutex> map_lock(group_map_mutex_);
+    group_map = group_map_;
+  }
   std::vector<GroupName> prune_vector;
   TransferInfo transfer_info;
-  for (const auto& group : group_map_) {
-    auto check_holder_result = matrix_change->CheckHolders(NodeId(group.first->string()));
-    if (check_holder_result.proximity_status != routing::GroupRangeStatus::kInRange) {
-      if (check_holder_result.new_holders.size() != 0) {
-        assert(check_holder_result.new_holders.size() == 1);
-        auto found_itr = transfer_info.find(check_holder_result.new_holders.at(0));
-        if (found_itr != transfer_info.end()) {
-          // Add to map
-        } else {  // create contents
-          // Add to map
-        }
+  auto handle_group([&](const GroupName& group_name) {
+    auto check_holder_result = matrix_change->CheckHolders(NodeId(group_name->string()));
+    if (check_holder_result.new_holders.size() != 0) {
+      assert(check_holder_result.new_holders.size() == 1);
+      auto found_itr = transfer_info.find(check_holder_result.new_holders.at(0));
+      if (found_itr != transfer_info.end()) {
+        // Add to map
+      } else {  // create contents
+        // Add to map
       }
-    } else {  // Prune group
-      prune_vector.push_back(group);
+    }
+    if (check_holder_result.proximity_status != routing::GroupRangeStatus::kInRange)
+      prune_vector.push_back(group_name);
+  });
+
+  if (name_ranges.empty()) {
+    for (const auto& group : group_map)
+      handle_group(group.first);
+  }
+  for (const auto& name_range : name_ranges) {
+    const GroupName kUpper(Identity(name_range.second.string()));
+    for (auto itr(group_map.lower_bound(GroupName(Identity(name_range.first.string()))));
+         itr != std::end(group_map) && !(kUpper < itr->first); ++itr) {
+      handle_group(itr->first);
     }
   }
 
@@ -199,16 +481,75 @@ typename GroupDb<Persona>::TransferInfo GroupDb<Persona>::GetTransferInfo(
 // Ignores values which are already in db
 template<typename Persona>
 void GroupDb<Persona>::HandleTransfer(const std::vector<Contents>& contents) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<leveldb::Slice> group_name_slices;
+  group_name_slices.reserve(contents.size());
+  for (const auto& group_contents : contents)
+    group_name_slices.push_back(group_contents.group_name->string());
+  auto group_locks(group_mutexes_.Lock(group_name_slices));
   for (const auto& kv_pair : contents) {
   }
 }
 
+template<typename Persona>
+std::string GroupDb<Persona>::MetadataKey(GroupId group_id) {
+  return detail::ToFixedWidthString<kPrefixWidth_>(group_id);
+}
+
+template<typename Persona>
+typename GroupDb<Persona>::ValueKeyBuffer GroupDb<Persona>::ValueKey(GroupId group_id,
+                                                                    const Key& key) {
+  ValueKeyBuffer buffer;
+  detail::EncodeFixedWidth<kPrefixWidth_>(group_id, buffer.data());
+  key.EncodeFixedWidth(buffer.data() + kPrefixWidth_);
+  return buffer;
+}
+
+template<typename Persona>
+typename GroupDb<Persona>::GroupId GroupDb<Persona>::FindGroupId(const GroupName& group_name) {
+  std::lock_guard<std::mutex> map_lock(group_map_mutex_);
+  auto itr(group_map_.find(group_name));
+  if (itr == group_map_.end())
+    ThrowError(VaultErrors::no_such_account);
+  return itr->second;
+}
+
+template<typename Persona>
+bool GroupDb<Persona>::Read(const leveldb::Slice& db_key, std::string& result) {
+  leveldb::ReadOptions read_options;
+  read_options.verify_checksums = true;
+  leveldb::Status status(leveldb_->Get(read_options, db_key, &result));
+  if (status.ok())
+    return true;
+  if (status.IsNotFound())
+    return false;
+  LOG(kError) << "Failed to read from group db: " << status.ToString();
+  ThrowError(VaultErrors::failed_to_handle_request);
+  return false;
+}
+
 // throws
 template<typename Persona>
-typename GroupDb<Persona>::Metadata GroupDb<Persona>::Get(const GroupName& /*group_name*/) {
-  ThrowError(VaultErrors::no_such_account);
-  return Metadata();
+typename GroupDb<Persona>::Metadata GroupDb<Persona>::Get(GroupId group_id, bool cache_on_miss) {
+  {
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    auto itr(metadata_cache_.find(group_id));
+    if (itr != metadata_cache_.end()) {
+      ++stats_.metadata_hits;
+      metadata_lru_.splice(metadata_lru_.begin(), metadata_lru_, itr->second.lru_position);
+      return itr->second.metadata;
+    }
+    ++stats_.metadata_misses;
+  }
+  // Dirty metadata is never evicted before it's been written, so leveldb holds the latest.
+  std::string metadata_string;
+  if (!Read(MetadataKey(group_id), metadata_string))
+    ThrowError(VaultErrors::no_such_account);
+  Metadata metadata(metadata_string);
+  if (cache_on_miss) {
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    PutMetadata(group_id, metadata, false);
+  }
+  return metadata;
 }
 
 template<typename Persona>
@@ -216,7 +557,7 @@ boost::optional<typename GroupDb<Persona>::Metadata> GroupDb<Persona>::GetMetada
     const GroupName& group_name) {
   boost::optional<Metadata> metadata;
   try {
-    metadata = Get(group_name);
+    metadata = Get(FindGroupId(group_name), false);
   }
   catch(const vault_error&) {}
   return metadata;
@@ -224,9 +565,24 @@ boost::optional<typename GroupDb<Persona>::Metadata> GroupDb<Persona>::GetMetada
 
 // throws
 template<typename Persona>
-typename GroupDb<Persona>::Value GroupDb<Persona>::Get(const Key& /*key*/) {
-  ThrowError(CommonErrors::no_such_element);
-  return Value();
+typename GroupDb<Persona>::Value GroupDb<Persona>::Get(const Key& key) {
+  const ValueKeyBuffer kDbKey(ValueKey(FindGroupId(key.group_name), key));
+  {
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    // Only build a string to look up the staged updates when there are any.
+    auto itr(pending_writes_.empty() ? pending_writes_.end() :
+                                       pending_writes_.find(kDbKey.string()));
+    if (itr != pending_writes_.end()) {
+      if (!itr->second)
+        ThrowError(CommonErrors::no_such_element);
+      return Value(*itr->second);
+    }
+  }
+  // Staged updates are only dropped once they've been written, so leveldb holds the latest.
+  std::string value_string;
+  if (!Read(kDbKey.slice(), value_string))
+    ThrowError(CommonErrors::no_such_element);
+  return Value(value_string);
 }
 
 template<typename Persona>
@@ -240,47 +596,160 @@ boost::optional<typename GroupDb<Persona>::Value> GroupDb<Persona>::GetValue(con
 }
 
 template<typename Persona>
-void GroupDb<Persona>::PutMetadata(const GroupName& /*group_name*/, const Metadata& /*metadata*/) {
+void GroupDb<Persona>::Flush() {
+  std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+  if (!FlushLocked())
+    ThrowError(VaultErrors::failed_to_handle_request);
+}
+
+template<typename Persona>
+GroupDbStats GroupDb<Persona>::stats() {
+  std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+  return stats_;
 }
 
 template<typename Persona>
 void GroupDb<Persona>::DeleteGroupEntries(const GroupName& group_name) {
-  std::vector<std::string> group_db_keys;
-  std::unique_ptr<leveldb::Iterator> iter(leveldb_->NewIterator(leveldb::ReadOptions()));
-  auto it(group_map_.find(group_name));
-  if (it == group_map_.end())
-    return;
-  auto group_id = it->second;
-  auto group_id_str = detail::ToFixedWidthString<kPrefixWidth_>(group_id);
-  if (++it != group_map_.end()) {// FIXME this may not work as group_ids are random
-    for (iter->Seek(detail::ToFixedWidthString<kPrefixWidth_>(group_id));
-         iter->Valid() && iter->key().ToString() < group_id_str;
-         iter->Next())
-      group_db_keys.push_back(iter->key().ToString());
-  } else {
-    for (iter->Seek(detail::ToFixedWidthString<kPrefixWidth_>(group_id)); iter->Valid();
+  GroupId group_id(0);
+  {
+    std::lock_guard<std::mutex> map_lock(group_map_mutex_);
+    auto itr(group_map_.find(group_name));
+    if (itr == group_map_.end())
+      return;
+    group_id = itr->second;
+  }
+  // The caller holds the group's lock, so no entries can be added to the group while it is being
+  // deleted.  As the GroupId may be reused, every key carrying its prefix must go.  The group's
+  // cached and staged updates are dropped first, so no later flush can write any of its keys.  The
+  // group's range is then scanned from a snapshot without holding 'cache_mutex_', and the deletion
+  // is written along with all other groups' updates, so that it isn't reordered with earlier
+  // commits.
+  const std::string kGroupPrefix(detail::ToFixedWidthString<kPrefixWidth_>(group_id));
+  const std::string kNextGroupPrefix(detail::ToFixedWidthString<kPrefixWidth_>(group_id + 1));
+  {
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    EraseCachedGroup(group_id);
+    pending_writes_.erase(pending_writes_.lower_bound(kGroupPrefix),
+                          pending_writes_.lower_bound(kNextGroupPrefix));
+    pending_writes_.erase(DirectoryKey(group_name));
+  }
+  leveldb::WriteBatch batch;
+  {
+    leveldb::ReadOptions read_options;
+    read_options.snapshot = leveldb_->GetSnapshot();
+    std::unique_ptr<leveldb::Iterator> iter(leveldb_->NewIterator(read_options));
+    for (iter->Seek(kGroupPrefix); iter->Valid() && iter->key().starts_with(kGroupPrefix);
          iter->Next()) {
-      group_db_keys.push_back(iter->key().ToString());
+      batch.Delete(iter->key());
     }
+    bool scanned(iter->status().ok());
+    iter.reset();
+    leveldb_->ReleaseSnapshot(read_options.snapshot);
+    if (!scanned)
+      ThrowError(VaultErrors::failed_to_handle_request);
+  }
+  batch.Delete(DirectoryKey(group_name));
+  {
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    if (!FlushLocked(batch))
+      ThrowError(VaultErrors::failed_to_handle_request);
   }
+  {
+    std::lock_guard<std::mutex> map_lock(group_map_mutex_);
+    ReleaseGroupId(group_id);
+    group_map_.erase(group_name);
+  }
+  ScheduleCompaction(group_id);
+}
 
-  iter.reset();
+template<typename Persona>
+void GroupDb<Persona>::PutMetadata(GroupId group_id, Metadata metadata, bool dirty) {
+  auto itr(metadata_cache_.find(group_id));
+  if (itr == metadata_cache_.end()) {
+    metadata_lru_.push_front(group_id);
+    itr = metadata_cache_.insert(
+        std::make_pair(group_id, CachedMetadata(std::move(metadata), metadata_lru_.begin()))).first;
+  } else {
+    itr->second.metadata = std::move(metadata);
+    metadata_lru_.splice(metadata_lru_.begin(), metadata_lru_, itr->second.lru_position);
+  }
+  if (dirty && !itr->second.dirty) {
+    itr->second.dirty = true;
+    dirty_group_ids_.push_back(group_id);
+  }
+  EvictMetadata();
+}
 
-  for (auto i: group_db_keys) {
-    leveldb::Status status(leveldb_->Delete(leveldb::WriteOptions(), i));
-    if (!status.ok())
-      ThrowError(VaultErrors::failed_to_handle_request);
+template<typename Persona>
+void GroupDb<Persona>::EvictMetadata() {
+  while (metadata_cache_.size() > kPolicy_.metadata_cache_size) {
+    if (metadata_cache_.at(metadata_lru_.back()).dirty && !FlushLocked())
+      return;  // The cache stays over its limit until a flush succeeds.
+    metadata_cache_.erase(metadata_lru_.back());
+    metadata_lru_.pop_back();
+    ++stats_.evicted;
   }
-  group_map_.erase(group_name);
-  leveldb_->CompactRange(nullptr, nullptr);
 }
 
 template<typename Persona>
-void GroupDb<Persona>::PutValue(const KvPair& /*key_value*/) {
+void GroupDb<Persona>::EraseCachedGroup(GroupId group_id) {
+  auto itr(metadata_cache_.find(group_id));
+  if (itr == metadata_cache_.end())
+    return;
+  if (itr->second.dirty) {
+    dirty_group_ids_.erase(std::find(std::begin(dirty_group_ids_), std::end(dirty_group_ids_),
+                                     group_id));
+  }
+  metadata_lru_.erase(itr->second.lru_position);
+  metadata_cache_.erase(itr);
+}
+
+template<typename Persona>
+void GroupDb<Persona>::PutPending(const std::string& db_key,
+                                  const boost::optional<std::string>& value) {
+  pending_writes_[db_key] = value;
+}
+
+template<typename Persona>
+void GroupDb<Persona>::CountCommit() {
+  if (++unflushed_commits_ >= kPolicy_.max_unflushed_commits)
+    FlushLocked();
 }
 
 template<typename Persona>
-void GroupDb<Persona>::DeleteValue(const Key& /*key*/) {
+bool GroupDb<Persona>::FlushLocked(leveldb::WriteBatch& batch) {
+  for (const auto& group_id : dirty_group_ids_)
+    batch.Put(MetadataKey(group_id), metadata_cache_.at(group_id).metadata.Serialise());
+  for (const auto& pending_write : pending_writes_) {
+    if (pending_write.second)
+      batch.Put(pending_write.first, *pending_write.second);
+    else
+      batch.Delete(pending_write.first);
+  }
+  leveldb::WriteOptions write_options;
+  write_options.sync = kPolicy_.sync_flushes;
+  leveldb::Status status(leveldb_->Write(write_options, &batch));
+  if (!status.ok()) {
+    LOG(kError) << "Failed to flush group db: " << status.ToString();
+    return false;
+  }
+  for (const auto& group_id : dirty_group_ids_)
+    metadata_cache_.at(group_id).dirty = false;
+  dirty_group_ids_.clear();
+  pending_writes_.clear();
+  unflushed_commits_ = 0;
+  ++stats_.flushes;
+  return true;
+}
+
+template<typename Persona>
+bool GroupDb<Persona>::FlushLocked() {
+  if (dirty_group_ids_.empty() && pending_writes_.empty()) {
+    unflushed_commits_ = 0;
+    return true;
+  }
+  leveldb::WriteBatch batch;
+  return FlushLocked(batch);
 }
 
 }  // namespace vault
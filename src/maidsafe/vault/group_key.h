@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_VAULT_GROUP_KEY_H_
 #define MAIDSAFE_VAULT_GROUP_KEY_H_
 
+#include <cstring>
 #include <string>
 #include <tuple>
 
@@ -57,12 +58,18 @@ struct GroupKey {
   friend class GroupDb;
 
  private:
-  typedef maidsafe::detail::BoundedString<
-      NodeId::kSize + detail::PaddedWidth::value,
-      NodeId::kSize + detail::PaddedWidth::value> FixedWidthString;
+  // The encoding covers only 'name' and 'type'; GroupDb prefixes it with the group's id.
+  static const size_t kFixedWidthSize = NodeId::kSize + detail::PaddedWidth::value;
+  typedef maidsafe::detail::BoundedString<kFixedWidthSize, kFixedWidthSize> FixedWidthString;
+  typedef detail::FixedWidthBuffer<kFixedWidthSize> FixedWidthBuffer;
+  typedef detail::FixedWidthView<kFixedWidthSize> FixedWidthView;
 
   GroupKey(const GroupName& group_name_in, const FixedWidthString& fixed_width_string);
+  GroupKey(const GroupName& group_name_in, const FixedWidthView& fixed_width_view);
   FixedWidthString ToFixedWidthString() const;
+  // Neither of these allocates.
+  FixedWidthBuffer ToFixedWidthBuffer() const;
+  void EncodeFixedWidth(char* out) const;
 };
 
 
@@ -97,6 +104,14 @@ GroupKey<GroupName>::GroupKey(const GroupName& group_name_in,
           detail::FromFixedWidthString<detail::PaddedWidth::value>(
               fixed_width_string.string().substr(NodeId::kSize)))) {}
 
+template<typename GroupName>
+GroupKey<GroupName>::GroupKey(const GroupName& group_name_in,
+                              const FixedWidthView& fixed_width_view)
+    : group_name(group_name_in),
+      name(std::string(fixed_width_view.data, NodeId::kSize)),
+      type(static_cast<DataTagValue>(detail::DecodeFixedWidth<detail::PaddedWidth::value>(
+               fixed_width_view.data + NodeId::kSize))) {}
+
 template<typename GroupName>
 GroupKey<GroupName>::GroupKey(const GroupKey& other)
     : group_name(other.group_name),
@@ -127,9 +142,22 @@ std::string GroupKey<GroupName>::Serialise() const {
 template<typename GroupName>
 typename GroupKey<GroupName>::FixedWidthString
     GroupKey<GroupName>::ToFixedWidthString() const {
-  return FixedWidthString(
-      name.string() +
-      detail::ToFixedWidthString<detail::PaddedWidth::value>(static_cast<uint32_t>(type)));
+  return FixedWidthString(ToFixedWidthBuffer().string());
+}
+
+template<typename GroupName>
+typename GroupKey<GroupName>::FixedWidthBuffer GroupKey<GroupName>::ToFixedWidthBuffer() const {
+  FixedWidthBuffer buffer;
+  EncodeFixedWidth(buffer.data());
+  return buffer;
+}
+
+template<typename GroupName>
+void GroupKey<GroupName>::EncodeFixedWidth(char* out) const {
+  assert(name.string().size() == NodeId::kSize);
+  std::memcpy(out, name.string().data(), NodeId::kSize);
+  detail::EncodeFixedWidth<detail::PaddedWidth::value>(static_cast<uint32_t>(type),
+                                                       out + NodeId::kSize);
 }
 
 template<typename GroupName>
@@ -0,0 +1,250 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/hot_chunk_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+
+#include "boost/thread/locks.hpp"
+#include "boost/variant/apply_visitor.hpp"
+#include "boost/variant/static_visitor.hpp"
+
+#include "maidsafe/common/error.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace detail {
+
+namespace {
+
+class RawNameVisitor : public boost::static_visitor<std::string> {
+ public:
+  template<typename DataName>
+  result_type operator()(const DataName& data_name) const {
+    return data_name.value.string();
+  }
+};
+
+const uint64_t kRowSeeds[] = { 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL,
+                               0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL };
+
+}  // unnamed namespace
+
+uint64_t HashDataName(const DataNameVariant& data_name) {
+  std::string raw_name(boost::apply_visitor(RawNameVisitor(), data_name));
+  uint64_t hash(0);
+  if (raw_name.size() >= sizeof(hash))
+    std::memcpy(&hash, raw_name.data(), sizeof(hash));
+  else
+    hash = std::hash<std::string>()(raw_name);
+  return hash ^ (static_cast<uint64_t>(data_name.which()) * kRowSeeds[0]);
+}
+
+FrequencySketch::FrequencySketch(size_t width, uint64_t sample_size)
+    : width_(std::max(width, static_cast<size_t>(1))),
+      sample_size_(std::max(sample_size, static_cast<uint64_t>(1))),
+      counters_(new std::atomic<uint8_t>[kDepth_ * width_]),
+      additions_(0) {
+  for (size_t i(0); i != kDepth_ * width_; ++i)
+    counters_[i].store(0);
+}
+
+size_t FrequencySketch::Index(uint64_t hash, int row) const {
+  uint64_t mixed((hash ^ (hash >> 29)) * kRowSeeds[row]);
+  return row * width_ + static_cast<size_t>((mixed >> 32) % width_);
+}
+
+void FrequencySketch::Increment(uint64_t hash) {
+  for (int row(0); row != kDepth_; ++row) {
+    auto& counter(counters_[Index(hash, row)]);
+    uint8_t count(counter.load(std::memory_order_relaxed));
+    while (count < kMaxCount_ &&
+           !counter.compare_exchange_weak(count, static_cast<uint8_t>(count + 1),
+                                          std::memory_order_relaxed)) {}
+  }
+  if (++additions_ % sample_size_ == 0)
+    Halve();
+}
+
+unsigned FrequencySketch::Estimate(uint64_t hash) const {
+  unsigned estimate(kMaxCount_);
+  for (int row(0); row != kDepth_; ++row) {
+    estimate = std::min(estimate, static_cast<unsigned>(
+                                      counters_[Index(hash, row)].load(std::memory_order_relaxed)));
+  }
+  return estimate;
+}
+
+void FrequencySketch::Halve() {
+  // Racing increments may be lost or survive a halving; the estimates only need to be approximate.
+  for (size_t i(0); i != kDepth_ * width_; ++i)
+    counters_[i].store(counters_[i].load(std::memory_order_relaxed) >> 1,
+                       std::memory_order_relaxed);
+}
+
+}  // namespace detail
+
+HotChunkCache::HotChunkCache(uint64_t capacity_bytes, size_t shard_count)
+    : capacity_bytes_(capacity_bytes),
+      shard_capacity_bytes_(capacity_bytes / std::max(shard_count, static_cast<size_t>(1))),
+      shards_(),
+      sketch_(detail::Parameters::hot_chunk_cache_sketch_width,
+              detail::Parameters::hot_chunk_cache_sketch_width * 10),
+      hits_(0),
+      misses_(0),
+      admitted_(0),
+      rejected_(0),
+      evicted_(0) {
+  for (size_t i(0); i != std::max(shard_count, static_cast<size_t>(1)); ++i)
+    shards_.push_back(std::unique_ptr<Shard>(new Shard));
+}
+
+HotChunkCache::Shard& HotChunkCache::GetShard(uint64_t hash) {
+  return *shards_[static_cast<size_t>(hash % shards_.size())];
+}
+
+HotChunkCache::Value HotChunkCache::Get(const DataNameVariant& data_name) {
+  uint64_t hash(detail::HashDataName(data_name));
+  sketch_.Increment(hash);
+  auto& shard(GetShard(hash));
+  {
+    boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+    auto itr(shard.index.find(data_name));
+    if (itr != std::end(shard.index)) {
+      auto& entry(*shard.ring[itr->second]);
+      entry.referenced.store(true, std::memory_order_relaxed);
+      ++hits_;
+      return entry.content;
+    }
+  }
+  ++misses_;
+  return Value();
+}
+
+bool HotChunkCache::Put(const DataNameVariant& data_name, const NonEmptyString& content) {
+  return Put(data_name, std::make_shared<const NonEmptyString>(content));
+}
+
+bool HotChunkCache::Put(const DataNameVariant& data_name, Value content) {
+  if (!content)
+    ThrowError(CommonErrors::invalid_parameter);
+  uint64_t size(content->string().size());
+  uint64_t hash(detail::HashDataName(data_name));
+  auto& shard(GetShard(hash));
+  boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+  // Checked before any existing entry is erased, so a refused replacement leaves it cached.
+  if (size > shard_capacity_bytes_) {
+    ++rejected_;
+    return false;
+  }
+  // Fresh content for a cached name is always admitted, as every entry can then be evicted.
+  unsigned candidate_frequency(std::numeric_limits<unsigned>::max());
+  auto itr(shard.index.find(data_name));
+  if (itr != std::end(shard.index))
+    EraseSlot(shard, itr->second);
+  else
+    candidate_frequency = sketch_.Estimate(hash);
+
+  std::vector<size_t> victims;
+  if (shard.bytes + size > shard_capacity_bytes_ &&
+      !ChooseVictims(shard, shard.bytes + size - shard_capacity_bytes_, candidate_frequency,
+                     victims)) {
+    ++rejected_;
+    return false;
+  }
+  for (auto victim : victims)
+    EraseSlot(shard, victim);
+  evicted_ += victims.size();
+
+  size_t slot(shard.ring.size());
+  if (shard.free_slots.empty()) {
+    shard.ring.push_back(nullptr);
+  } else {
+    slot = shard.free_slots.back();
+    shard.free_slots.pop_back();
+  }
+  shard.ring[slot].reset(new Entry(data_name, hash, content));
+  shard.index.insert(std::make_pair(data_name, slot));
+  shard.bytes += size;
+  ++admitted_;
+  return true;
+}
+
+bool HotChunkCache::ChooseVictims(Shard& shard, uint64_t required, unsigned candidate_frequency,
+                                  std::vector<size_t>& victims) {
+  // Two sweeps clear every reference bit, so by then every entry has been considered.
+  uint64_t freed(0);
+  for (size_t step(0); freed < required && step != 2 * shard.ring.size(); ++step) {
+    size_t slot(shard.hand);
+    shard.hand = (shard.hand + 1) % shard.ring.size();
+    const auto& entry(shard.ring[slot]);
+    if (!entry || entry->referenced.exchange(false, std::memory_order_relaxed) ||
+        std::find(std::begin(victims), std::end(victims), slot) != std::end(victims)) {
+      continue;
+    }
+    if (sketch_.Estimate(entry->hash) >= candidate_frequency) {
+      victims.clear();
+      return false;
+    }
+    victims.push_back(slot);
+    freed += entry->content->string().size();
+  }
+  return freed >= required;
+}
+
+void HotChunkCache::EraseSlot(Shard& shard, size_t slot) {
+  auto& entry(shard.ring[slot]);
+  shard.bytes -= entry->content->string().size();
+  shard.index.erase(entry->data_name);
+  entry.reset();
+  shard.free_slots.push_back(slot);
+}
+
+void HotChunkCache::Erase(const DataNameVariant& data_name) {
+  auto& shard(GetShard(detail::HashDataName(data_name)));
+  boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+  auto itr(shard.index.find(data_name));
+  if (itr != std::end(shard.index))
+    EraseSlot(shard, itr->second);
+}
+
+HotChunkCache::Stats HotChunkCache::stats() const {
+  Stats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.admitted = admitted_;
+  stats.rejected = rejected_;
+  stats.evicted = evicted_;
+  for (const auto& shard : shards_) {
+    boost::shared_lock<boost::shared_mutex> lock(shard->mutex);
+    stats.bytes += shard->bytes;
+    stats.count += shard->index.size();
+  }
+  return stats;
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -0,0 +1,148 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_HOT_CHUNK_CACHE_H_
+#define MAIDSAFE_VAULT_HOT_CHUNK_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "boost/thread/shared_mutex.hpp"
+
+#include "maidsafe/common/types.h"
+#include "maidsafe/data_types/data_name_variant.h"
+
+#include "maidsafe/vault/parameters.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace detail {
+
+// Names are hashes, so the leading bytes of the raw name (mixed with the type) are used directly.
+uint64_t HashDataName(const DataNameVariant& data_name);
+
+struct DataNameHash {
+  size_t operator()(const DataNameVariant& data_name) const {
+    return static_cast<size_t>(HashDataName(data_name));
+  }
+};
+
+// Count-min sketch of recent access frequencies with counters saturating at 15.  All counters are
+// halved every 'sample_size' increments so that entries which were once popular age out.
+class FrequencySketch {
+ public:
+  FrequencySketch(size_t width, uint64_t sample_size);
+  void Increment(uint64_t hash);
+  unsigned Estimate(uint64_t hash) const;
+
+ private:
+  FrequencySketch(const FrequencySketch&);
+  FrequencySketch& operator=(const FrequencySketch&);
+  FrequencySketch(FrequencySketch&&);
+  FrequencySketch& operator=(FrequencySketch&&);
+
+  size_t Index(uint64_t hash, int row) const;
+  void Halve();
+
+  static const int kDepth_ = 4;
+  static const unsigned kMaxCount_ = 15;
+  const size_t width_;
+  const uint64_t sample_size_;
+  std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+  std::atomic<uint64_t> additions_;
+};
+
+}  // namespace detail
+
+// In-memory cache of chunk contents with a byte-based capacity, split into independently-locked
+// shards.  Lookups only take their shard's lock in shared mode, so concurrent GETs never block one
+// another.  Each shard evicts using CLOCK, and a new entry is only admitted over the entries CLOCK
+// would evict if it's been requested more often than them (TinyLFU), so a scan of one-off chunks
+// can't flush out the hot set.
+class HotChunkCache {
+ public:
+  typedef std::shared_ptr<const NonEmptyString> Value;
+
+  struct Stats {
+    Stats() : hits(0), misses(0), admitted(0), rejected(0), evicted(0), bytes(0), count(0) {}
+    uint64_t hits, misses, admitted, rejected, evicted, bytes, count;
+  };
+
+  explicit HotChunkCache(
+      uint64_t capacity_bytes = detail::Parameters::hot_chunk_cache_capacity_bytes,
+      size_t shard_count = detail::Parameters::hot_chunk_cache_shard_count);
+
+  // Returns nullptr if 'data_name' isn't cached.
+  Value Get(const DataNameVariant& data_name);
+  // Returns false if the content wasn't admitted, in which case any existing entry is kept.
+  // Replacing an existing entry only fails if the content is larger than a whole shard.
+  bool Put(const DataNameVariant& data_name, Value content);
+  bool Put(const DataNameVariant& data_name, const NonEmptyString& content);
+  void Erase(const DataNameVariant& data_name);
+  uint64_t capacity_bytes() const { return capacity_bytes_; }
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    Entry(const DataNameVariant& data_name_in, uint64_t hash_in, Value content_in)
+        : data_name(data_name_in), hash(hash_in), content(content_in), referenced(true) {}
+    DataNameVariant data_name;
+    uint64_t hash;
+    Value content;
+    std::atomic<bool> referenced;
+  };
+
+  struct Shard {
+    Shard() : mutex(), index(), ring(), free_slots(), hand(0), bytes(0) {}
+    boost::shared_mutex mutex;
+    std::unordered_map<DataNameVariant, size_t, detail::DataNameHash> index;
+    std::vector<std::unique_ptr<Entry>> ring;
+    std::vector<size_t> free_slots;
+    size_t hand;
+    uint64_t bytes;
+  };
+
+  HotChunkCache(const HotChunkCache&);
+  HotChunkCache& operator=(const HotChunkCache&);
+  HotChunkCache(HotChunkCache&&);
+  HotChunkCache& operator=(HotChunkCache&&);
+
+  Shard& GetShard(uint64_t hash);
+  // Advances the shard's CLOCK hand to choose entries totalling at least 'required' bytes.  Returns
+  // false (leaving the cache unchanged) if any of them is more popular than 'candidate_frequency'.
+  bool ChooseVictims(Shard& shard, uint64_t required, unsigned candidate_frequency,
+                     std::vector<size_t>& victims);
+  void EraseSlot(Shard& shard, size_t slot);
+
+  const uint64_t capacity_bytes_, shard_capacity_bytes_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  detail::FrequencySketch sketch_;
+  std::atomic<uint64_t> hits_, misses_, admitted_, rejected_, evicted_;
+};
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_HOT_CHUNK_CACHE_H_
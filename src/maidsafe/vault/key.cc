@@ -18,6 +18,7 @@
 
 #include "maidsafe/vault/key.h"
 
+#include <cstring>
 #include <tuple>
 
 #include "maidsafe/common/error.h"
@@ -47,9 +48,14 @@ Key::Key(const FixedWidthString& fixed_width_string)
                detail::FromFixedWidthString<detail::PaddedWidth::value>(
                    fixed_width_string.string().substr(NodeId::kSize)))) {}
 
-Key::Key(const Key& other) : name(other.name) {}
+Key::Key(const FixedWidthView& fixed_width_view)
+    : name(std::string(fixed_width_view.data, NodeId::kSize)),
+      type(static_cast<DataTagValue>(detail::DecodeFixedWidth<detail::PaddedWidth::value>(
+               fixed_width_view.data + NodeId::kSize))) {}
 
-Key::Key(Key&& other) : name(std::move(other.name)) {}
+Key::Key(const Key& other) : name(other.name), type(other.type) {}
+
+Key::Key(Key&& other) : name(std::move(other.name)), type(std::move(other.type)) {}
 
 Key& Key::operator=(Key other) {
   swap(*this, other);
@@ -64,9 +70,20 @@ std::string Key::Serialise() const {
 }
 
 Key::FixedWidthString Key::ToFixedWidthString() const {
-  return FixedWidthString(
-      name.string() +
-      detail::ToFixedWidthString<detail::PaddedWidth::value>(static_cast<uint32_t>(type)));
+  return FixedWidthString(ToFixedWidthBuffer().string());
+}
+
+Key::FixedWidthBuffer Key::ToFixedWidthBuffer() const {
+  FixedWidthBuffer buffer;
+  EncodeFixedWidth(buffer.data());
+  return buffer;
+}
+
+void Key::EncodeFixedWidth(char* out) const {
+  assert(name.string().size() == NodeId::kSize);
+  std::memcpy(out, name.string().data(), NodeId::kSize);
+  detail::EncodeFixedWidth<detail::PaddedWidth::value>(static_cast<uint32_t>(type),
+                                                       out + NodeId::kSize);
 }
 
 void swap(Key& lhs, Key& rhs) MAIDSAFE_NOEXCEPT {
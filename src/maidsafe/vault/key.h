@@ -37,11 +37,16 @@ namespace vault {
 namespace test {
 class KeyTest_BEH_Serialise_Test;
 class KeyTest_BEH_All_Test;
+class KeyTest_BEH_FixedWidthEncoding_Test;
+class KeyTest_FUNC_EncodeAllocations_Test;
 }  // namespace test
 
 //template<typename Persona>
 //class ManagerDb;
 
+template<typename KeyType, typename ValueType>
+class Db;
+
 struct Key {
   Key(const Identity& name_in, DataTagValue type_in);
   Key(const DataNameVariant& data_name);
@@ -56,14 +61,23 @@ struct Key {
 
   template<typename Persona>
   friend class ManagerDb;
+  template<typename KeyType, typename ValueType>
+  friend class Db;
+  friend class test::KeyTest_BEH_FixedWidthEncoding_Test;
+  friend class test::KeyTest_FUNC_EncodeAllocations_Test;
 
  private:
-  typedef maidsafe::detail::BoundedString<
-      NodeId::kSize + detail::PaddedWidth::value,
-      NodeId::kSize + detail::PaddedWidth::value> FixedWidthString;
+  static const size_t kFixedWidthSize = NodeId::kSize + detail::PaddedWidth::value;
+  typedef maidsafe::detail::BoundedString<kFixedWidthSize, kFixedWidthSize> FixedWidthString;
+  typedef detail::FixedWidthBuffer<kFixedWidthSize> FixedWidthBuffer;
+  typedef detail::FixedWidthView<kFixedWidthSize> FixedWidthView;
 
   explicit Key(const FixedWidthString& fixed_width_string);
+  explicit Key(const FixedWidthView& fixed_width_view);
   FixedWidthString ToFixedWidthString() const;
+  // Neither of these allocates.
+  FixedWidthBuffer ToFixedWidthBuffer() const;
+  void EncodeFixedWidth(char* out) const;
 };
 
 void swap(Key& lhs, Key& rhs) MAIDSAFE_NOEXCEPT;
@@ -18,6 +18,8 @@
 
 #include "maidsafe/vault/key_utils.h"
 
+#include <algorithm>
+
 
 namespace maidsafe {
 
@@ -25,16 +27,37 @@ namespace vault {
 
 namespace detail {
 
-template<>
-std::string ToFixedWidthString<1>(uint32_t number) {
-  assert(number < 256);
-  return std::string(1, static_cast<char>(number));
-}
+std::vector<NameRange> GetNameRangesWithinRadius(const std::vector<NodeId>& nodes,
+                                                 const NodeId& radius) {
+  const int kBitCount(NodeId::kSize * 8);
+  const std::string kRadius(radius.string());
+  // All names within 'radius' of a node share this many leading bits with it.
+  int prefix_bits(0);
+  while (prefix_bits != kBitCount &&
+         !(static_cast<unsigned char>(kRadius[prefix_bits / 8]) & (0x80 >> (prefix_bits % 8))))
+    ++prefix_bits;
+
+  std::vector<NameRange> ranges;
+  for (const auto& node : nodes) {
+    std::string lower(node.string()), upper(node.string());
+    for (int bit(prefix_bits); bit != kBitCount; ++bit) {
+      lower[bit / 8] = static_cast<char>(lower[bit / 8] & ~(0x80 >> (bit % 8)));
+      upper[bit / 8] = static_cast<char>(upper[bit / 8] | (0x80 >> (bit % 8)));
+    }
+    ranges.push_back(std::make_pair(NodeId(lower), NodeId(upper)));
+  }
 
-template<>
-uint32_t FromFixedWidthString<1>(const std::string& number_as_string) {
-  assert(number_as_string.size() == 1U);
-  return static_cast<uint32_t>(static_cast<unsigned char>(number_as_string[0]));
+  std::sort(std::begin(ranges), std::end(ranges));
+  std::vector<NameRange> merged;
+  for (const auto& range : ranges) {
+    if (!merged.empty() && !(merged.back().second < range.first)) {
+      if (merged.back().second < range.second)
+        merged.back().second = range.second;
+    } else {
+      merged.push_back(range);
+    }
+  }
+  return merged;
 }
 
 }  // namespace detail
@@ -20,9 +20,15 @@
 #define MAIDSAFE_VAULT_KEY_UTILS_H_
 
 #include <cassert>
-#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "leveldb/slice.h"
+
+#include "maidsafe/common/node_id.h"
 
 
 namespace maidsafe {
@@ -36,36 +42,76 @@ struct PaddedWidth {
   static const int value = 1;
 };
 
+// Writes 'number' big-endian into the 'width' bytes at 'out'.
 template<int width>
-std::string ToFixedWidthString(uint32_t number) {
+void EncodeFixedWidth(uint32_t number, char* out) {
   static_assert(width > 0 && width < 5, "width must be 1, 2, 3, or 4.");
-  assert(number < std::pow(256, width));
-  std::string result(width, 0);
-  for (int i(0); i != width; ++i) {
-    result[width - i - 1] = static_cast<char>(number);
-    number /= 256;
+  assert(width == 4 || number < (1U << (8 * width)));
+  for (int i(width - 1); i >= 0; --i) {
+    out[i] = static_cast<char>(number);
+    number >>= 8;
   }
+}
+
+template<int width>
+uint32_t DecodeFixedWidth(const char* in) {
+  static_assert(width > 0 && width < 5, "width must be 1, 2, 3, or 4.");
+  uint32_t result(0);
+  for (int i(0); i != width; ++i)
+    result = (result << 8) | static_cast<unsigned char>(in[i]);
+  return result;
+}
+
+template<int width>
+std::string ToFixedWidthString(uint32_t number) {
+  std::string result(width, 0);
+  EncodeFixedWidth<width>(number, &result[0]);
   return result;
 }
 
 template<int width>
 uint32_t FromFixedWidthString(const std::string& number_as_string) {
-  static_assert(width > 0 && width < 5, "width must be 1, 2, 3, or 4.");
   assert(static_cast<int>(number_as_string.size()) == width);
-  uint32_t result(0), factor(1);
-  for (int i(0); i != width; ++i) {
-    result += (static_cast<unsigned char>(number_as_string[width - i - 1]) * factor);
-    factor *= 256;
-  }
-  assert(result < std::pow(256, width));
-  return result;
+  return DecodeFixedWidth<width>(number_as_string.data());
 }
 
-template<>
-std::string ToFixedWidthString<1>(uint32_t number);
+// Stack storage for a key's fixed-width encoding, which leveldb can read as a Slice without the key
+// being copied to the heap.
+template<size_t size_in>
+class FixedWidthBuffer {
+ public:
+  static const size_t kSize = size_in;
+  char* data() { return data_; }
+  const char* data() const { return data_; }
+  size_t size() const { return kSize; }
+  leveldb::Slice slice() const { return leveldb::Slice(data_, kSize); }
+  std::string string() const { return std::string(data_, kSize); }
+
+ private:
+  char data_[kSize];
+};
+
+// Refers to a key's fixed-width encoding held elsewhere (e.g. by a leveldb iterator), so that the
+// key can be decoded from it directly.
+template<size_t size_in>
+struct FixedWidthView {
+  static const size_t kSize = size_in;
+  explicit FixedWidthView(const leveldb::Slice& encoded) : data(encoded.data()) {
+    assert(encoded.size() >= kSize);
+  }
+  const char* data;
+};
+
+// Inclusive range of names, lower bound first.
+typedef std::pair<NodeId, NodeId> NameRange;
 
-template<>
-uint32_t FromFixedWidthString<1>(const std::string& number_as_string);
+// Returns sorted, non-overlapping ranges covering every name within XOR distance 'radius' of any
+// of 'nodes'.  Each range is the smallest name prefix of the node which covers that distance, so
+// may include names up to twice as far away as 'radius'.  No churn handler passes ranges yet: the
+// personas' HandleChurnEvent bodies are still stubs, and routing::MatrixChange doesn't expose the
+// nodes which joined or left.
+std::vector<NameRange> GetNameRangesWithinRadius(const std::vector<NodeId>& nodes,
+                                                 const NodeId& radius);
 
 }  // namespace detail
 
@@ -31,13 +31,11 @@ struct ActionCreateRemoveAccount {
   static const nfs::MessageAction kActionId;
 };
 
-//template<>
-//const nfs::MessageAction ActionCreateRemoveAccount<false>::kActionId =
-//    nfs::MessageAction::kCreateAccountRequest;
+template<>
+const nfs::MessageAction ActionCreateRemoveAccount<false>::kActionId;
 
-//template<>
-//const nfs::MessageAction ActionCreateRemoveAccount<true>::kActionId =
-//    nfs::MessageAction::kRemoveAccountRequest;
+template<>
+const nfs::MessageAction ActionCreateRemoveAccount<true>::kActionId;
 
 typedef ActionCreateRemoveAccount<false> ActionCreateAccount;
 typedef ActionCreateRemoveAccount<true> ActionRemoveAccount;
@@ -28,13 +28,13 @@ namespace maidsafe {
 
 namespace vault {
 
-//template<>
-//const nfs::MessageAction ActionRegisterUnregisterPmid<false>::kActionId =
-//    nfs::MessageAction::kRegisterPmid;
-//
-//template<>
-//const nfs::MessageAction ActionRegisterUnregisterPmid<true>::kActionId =
-//    nfs::MessageAction::kUnregisterPmid;
+template<>
+const nfs::MessageAction ActionRegisterUnregisterPmid<false>::kActionId(
+    nfs::MessageAction::kRegisterPmidRequest);
+
+template<>
+const nfs::MessageAction ActionRegisterUnregisterPmid<true>::kActionId(
+    nfs::MessageAction::kUnregisterPmidRequest);
 
 template<>
 void ActionRegisterUnregisterPmid<false>::operator()(MaidManagerMetadata& metadata) const {
@@ -18,6 +18,8 @@
 
 #include "maidsafe/vault/maid_manager/dispatcher.h"
 
+#include "maidsafe/vault/message_types.h"
+
 namespace maidsafe {
 
 namespace vault {
@@ -99,9 +101,18 @@ void MaidManagerDispatcher::SendUnregisterPmidResponse(const MaidName& /*account
 //  routing_.Send(message);
 }
 
-void MaidManagerDispatcher::SendSync(const MaidName& /*account_name*/,
-                                     const NonEmptyString& /*serialised_action*/,
-                                     const nfs::MessageId& /*message_id*/) {
+void MaidManagerDispatcher::SendSync(const MaidName& account_name,
+                                     const NonEmptyString& serialised_sync,
+                                     const nfs::MessageId& message_id) {
+  typedef SynchroniseFromMaidManagerToMaidManager VaultMessage;
+  typedef routing::Message<VaultMessage::Sender, VaultMessage::Receiver> RoutingMessage;
+
+  VaultMessage vault_message(message_id, nfs_vault::Content(serialised_sync.string()));
+  RoutingMessage message(vault_message.Serialise(),
+                         VaultMessage::Sender(routing::GroupId(NodeId(account_name->string())),
+                                              routing::SingleId(routing_.kNodeId())),
+                         VaultMessage::Receiver(routing::GroupId(NodeId(account_name->string()))));
+  routing_.Send(message);
 }
 
 void MaidManagerDispatcher::SendAccountTransfer(const NodeId& /*destination_peer*/,
@@ -20,6 +20,7 @@
 
 #include <string>
 
+#include "maidsafe/common/utils.h"
 #include "maidsafe/nfs/vault/pmid_registration.h"
 #include "maidsafe/data_types/owner_directory.h"
 #include "maidsafe/data_types/group_directory.h"
@@ -142,19 +143,29 @@ T Merge(std::vector<T> values) {
 
 }  // unnamed namespace
 
-MaidManagerService::MaidManagerService(const passport::Pmid& pmid, routing::Routing& routing)
+MaidManagerService::MaidManagerService(const passport::Pmid& pmid, routing::Routing& routing,
+                                       const boost::filesystem::path& vault_root_dir,
+                                       const AccumulatorPolicy& accumulator_policy)
     : routing_(routing),
 //      public_key_getter_(public_key_getter),
-      group_db_(),
+      group_db_(vault_root_dir / "maid_manager" / "group_db"),
       accumulator_mutex_(),
-      accumulator_(),
+      accumulator_(accumulator_policy),
       dispatcher_(routing_, pmid),
       sync_create_accounts_(),
       sync_remove_accounts_(),
       sync_puts_(),
       sync_deletes_(),
       sync_register_pmids_(),
-      sync_unregister_pmids_() {}
+      sync_unregister_pmids_(),
+      sync_coalescer_([this](const NodeId& group_id, const std::string& serialised_batch) {
+                        dispatcher_.SendSync(MaidName(Identity(group_id.string())),
+                                             NonEmptyString(serialised_batch),
+                                             nfs::MessageId(RandomInt32()));
+                      }),
+      sync_scheduler_([this] { DoSync(); },
+                      [this] { return sync_coalescer_.queued_actions(); },
+                      [this] { sync_coalescer_.FlushDue(); }) {}
 
 //void MaidManagerService::HandleMessage(const nfs::Message& message,
 //                                       const routing::ReplyFunctor& reply_functor) {
@@ -322,6 +333,23 @@ MaidManagerService::MaidManagerService(const passport::Pmid& pmid, routing::Rout
 
 // =============== Sync ============================================================================
 
+void MaidManagerService::DoSync() {
+  auto group_id([](const MaidManager::Key& key) { return NodeId(key.group_name->string()); });
+  sync_coalescer_.AddUnresolvedActions(sync_create_accounts_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_remove_accounts_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_puts_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_deletes_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_register_pmids_, group_id);
+  sync_coalescer_.AddUnresolvedActions(sync_unregister_pmids_, group_id);
+  sync_coalescer_.FlushAll();
+  sync_create_accounts_.IncrementSyncAttempts();
+  sync_remove_accounts_.IncrementSyncAttempts();
+  sync_puts_.IncrementSyncAttempts();
+  sync_deletes_.IncrementSyncAttempts();
+  sync_register_pmids_.IncrementSyncAttempts();
+  sync_unregister_pmids_.IncrementSyncAttempts();
+}
+
 //void MaidManagerService::DoSync() {
 //  auto unresolved_create_accounts(sync_create_accounts_.GetUnresolvedActions());
 //  if (!unresolved_create_accounts.empty()) {
@@ -361,68 +389,56 @@ MaidManagerService::MaidManagerService(const passport::Pmid& pmid, routing::Rout
 //  }
 //}
 
-//void MaidManagerService::HandleSync(const nfs::Message& message) {
-//  protobuf::Sync proto_sync;
-//  if (!proto_sync.ParseFromString(message.data().content.string()))
-//    ThrowError(CommonErrors::parsing_error);
-
-//  switch (proto_sync.action_type()) {
-//    case ActionCreateAccount::kActionId: {
-//      MaidManager::UnresolvedCreateAccount unresolved_action(
-//          proto_sync.serialised_unresolved_action(), message.source().node_id, routing_.kNodeId());
-//      auto resolved_action(sync_create_accounts_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action) {
-//        MaidManager::Metadata metadata;
-//        group_db_.AddGroup(resolved_action->key.group_name, metadata);
-//      }
-//      break;
-//    }
-//    case ActionRemoveAccount::kActionId: {
-//      MaidManager::UnresolvedRemoveAccount unresolved_action(
-//          proto_sync.serialised_unresolved_action(), message.source().node_id, routing_.kNodeId());
-//      auto resolved_action(sync_remove_accounts_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        group_db_.DeleteGroup(resolved_action->key.group_name);
-//      break;
-//    }
-//    case ActionMaidManagerPut::kActionId: {
-//      MaidManager::UnresolvedPut unresolved_action(
-//          proto_sync.serialised_unresolved_action(), message.source().node_id, routing_.kNodeId());
-//      auto resolved_action(sync_puts_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        group_db_.Commit(resolved_action->key, resolved_action->action);
-//      break;
-//    }
-//    case ActionMaidManagerDelete::kActionId: {
-//      MaidManager::UnresolvedDelete unresolved_action(
-//          proto_sync.serialised_unresolved_action(), message.source().node_id, routing_.kNodeId());
-//      auto resolved_action(sync_deletes_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        group_db_.Commit(resolved_action->key, resolved_action->action);
-//      break;
-//    }
-//    case ActionRegisterPmid::kActionId: {
-//      MaidManager::UnresolvedRegisterPmid unresolved_action(
-//          proto_sync.serialised_unresolved_action(), message.source().node_id, routing_.kNodeId());
-//      auto resolved_action(sync_register_pmids_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        group_db_.Commit(resolved_action->key.group_name, resolved_action->action);
-//      break;
-//    }
-//    case ActionUnregisterPmid::kActionId: {
-//      MaidManager::UnresolvedUnregisterPmid unresolved_action(
-//          proto_sync.serialised_unresolved_action(), message.source().node_id, routing_.kNodeId());
-//      auto resolved_action(sync_unregister_pmids_.AddUnresolvedAction(unresolved_action));
-//      if (resolved_action)
-//        group_db_.Commit(resolved_action->key.group_name, resolved_action->action);
-//      break;
-//    }
-//    default: {
-//      assert(false);
-//      LOG(kError) << "Unhandled action type";
-//    }
-//  }
-//}
+void MaidManagerService::HandleSync(const std::string& serialised_batch,
+                                    const NodeId& sender_id) {
+  for (const auto& proto_sync : SyncCoalescer::Unpack(serialised_batch)) {
+    // Each entry is applied on its own, so one failing action doesn't drop the rest of the batch.
+    try {
+      auto action_type(static_cast<nfs::MessageAction>(proto_sync.action_type()));
+      if (action_type == ActionCreateAccount::kActionId) {
+        auto resolved_action(AddSyncAction(sync_create_accounts_, proto_sync, sender_id));
+        if (resolved_action)
+          group_db_.AddGroup(resolved_action->key.group_name, MaidManager::Metadata());
+      } else if (action_type == ActionRemoveAccount::kActionId) {
+        auto resolved_action(AddSyncAction(sync_remove_accounts_, proto_sync, sender_id));
+        if (resolved_action)
+          group_db_.DeleteGroup(resolved_action->key.group_name);
+      } else if (action_type == ActionMaidManagerPut::kActionId) {
+        auto resolved_action(AddSyncAction(sync_puts_, proto_sync, sender_id));
+        if (resolved_action)
+          group_db_.Commit(resolved_action->key, resolved_action->action);
+      } else if (action_type == ActionMaidManagerDelete::kActionId) {
+        auto resolved_action(AddSyncAction(sync_deletes_, proto_sync, sender_id));
+        if (resolved_action)
+          group_db_.Commit(resolved_action->key, resolved_action->action);
+      } else if (action_type == ActionRegisterPmid::kActionId) {
+        auto resolved_action(AddSyncAction(sync_register_pmids_, proto_sync, sender_id));
+        if (resolved_action)
+          group_db_.Commit(resolved_action->key.group_name, resolved_action->action);
+      } else if (action_type == ActionUnregisterPmid::kActionId) {
+        auto resolved_action(AddSyncAction(sync_unregister_pmids_, proto_sync, sender_id));
+        if (resolved_action)
+          group_db_.Commit(resolved_action->key.group_name, resolved_action->action);
+      } else {
+        LOG(kError) << "Unhandled action type " << proto_sync.action_type();
+      }
+    }
+    catch(const std::exception& e) {
+      LOG(kError) << "Failed to apply synced action of type " << proto_sync.action_type()
+                  << ": " << e.what();
+    }
+  }
+}
+
+template<typename UnresolvedAction>
+std::unique_ptr<UnresolvedAction> MaidManagerService::AddSyncAction(
+    Sync<UnresolvedAction>& sync,
+    const protobuf::Sync& proto_sync,
+    const NodeId& sender_id) {
+  UnresolvedAction unresolved_action(proto_sync.serialised_unresolved_action(), sender_id,
+                                     routing_.kNodeId());
+  return sync.AddUnresolvedAction(unresolved_action);
+}
 
 
 // =============== Account transfer ================================================================
@@ -692,6 +708,14 @@ void MaidManagerService::HandleMessage(
       accumulator_mutex_)(message, sender, receiver);
 }
 
+template<>
+void MaidManagerService::HandleMessage(
+    const SynchroniseFromMaidManagerToMaidManager& message,
+    const typename SynchroniseFromMaidManagerToMaidManager::Sender& sender,
+    const typename SynchroniseFromMaidManagerToMaidManager::Receiver& /*receiver*/) {
+  HandleSync(message.contents->data, sender.sender_id);
+}
+
 }  // namespace vault
 
 }  // namespace maidsafe
\ No newline at end of file
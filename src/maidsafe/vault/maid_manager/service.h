@@ -26,6 +26,8 @@
 #include <type_traits>
 #include <vector>
 
+#include "boost/filesystem/path.hpp"
+
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/on_scope_exit.h"
@@ -44,6 +46,9 @@
 #include "maidsafe/vault/group_db.h"
 #include "maidsafe/vault/message_types.h"
 #include "maidsafe/vault/sync.h"
+#include "maidsafe/vault/sync.pb.h"
+#include "maidsafe/vault/sync_coalescer.h"
+#include "maidsafe/vault/sync_scheduler.h"
 #include "maidsafe/vault/types.h"
 #include "maidsafe/vault/unresolved_action.h"
 #include "maidsafe/vault/utils.h"
@@ -73,9 +78,12 @@ struct GetPmidTotalsOp;
 class MaidManagerService {
  public:
   typedef nfs::MaidManagerServiceMessages PublicMessages;
-  typedef void VaultMessages;
+  typedef MaidManagerServiceMessages VaultMessages;
 
-  MaidManagerService(const passport::Pmid& pmid, routing::Routing& routing);
+  // Accounts are kept in a db under 'vault_root_dir', so they survive a restart.
+  MaidManagerService(const passport::Pmid& pmid, routing::Routing& routing,
+                     const boost::filesystem::path& vault_root_dir,
+                     const AccumulatorPolicy& accumulator_policy = AccumulatorPolicy());
 
   template<typename T>
   void HandleMessage(const T&, const typename T::Sender& , const typename T::Receiver&);
@@ -153,7 +161,15 @@ class MaidManagerService {
   void UpdatePmidTotalsCallback(const std::string& serialised_reply,
                                 std::shared_ptr<GetPmidTotalsOp> op_data);
 
+  // One round of 'sync_scheduler_': sends this node's unresolved actions to its peers, coalesced
+  // per account, then advances their sync attempts.
   void DoSync();
+  // Handles the content of a Synchronise message from a peer: a batch of unresolved actions.
+  void HandleSync(const std::string& serialised_batch, const NodeId& sender_id);
+  template<typename UnresolvedAction>
+  std::unique_ptr<UnresolvedAction> AddSyncAction(Sync<UnresolvedAction>& sync,
+                                                  const protobuf::Sync& proto_sync,
+                                                  const NodeId& sender_id);
 
   routing::Routing& routing_;
 //  nfs_client::DataGetter data_getter_;
@@ -167,6 +183,8 @@ class MaidManagerService {
   Sync<MaidManager::UnresolvedDelete> sync_deletes_;
   Sync<MaidManager::UnresolvedRegisterPmid> sync_register_pmids_;
   Sync<MaidManager::UnresolvedUnregisterPmid> sync_unregister_pmids_;
+  SyncCoalescer sync_coalescer_;
+  SyncScheduler sync_scheduler_;
   static const int kPutRepliesSuccessesRequired_;
   static const int kDefaultPaymentFactor_;
 };
@@ -240,6 +258,12 @@ void MaidManagerService::HandleMessage(
     const typename nfs::GetPmidHealthRequestFromMaidNodeToMaidManager::Sender& sender,
     const typename nfs::GetPmidHealthRequestFromMaidNodeToMaidManager::Receiver& receiver);
 
+template<>
+void MaidManagerService::HandleMessage(
+    const SynchroniseFromMaidManagerToMaidManager& message,
+    const typename SynchroniseFromMaidManagerToMaidManager::Sender& sender,
+    const typename SynchroniseFromMaidManagerToMaidManager::Receiver& receiver);
+
 
 
 // ==================== Implementation =============================================================
@@ -302,7 +326,7 @@ void MaidManagerService::HandlePutResponse(const MaidName& maid_name,
       typename MaidManager::GroupName(maid_name.value), data_name.raw_name, data_name.type);
   sync_puts_.AddLocalAction(typename MaidManager::UnresolvedPut(
       group_key, ActionMaidManagerPut(cost), routing_.kNodeId(), message_id));
-  DoSync();
+  sync_scheduler_.Notify();
 }
 
 // ================================== Delete Implementation =======================================
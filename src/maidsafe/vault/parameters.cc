@@ -33,6 +33,42 @@ namespace detail {
 const int Parameters::kMinNetworkHealth(12);
 size_t Parameters::max_recent_data_list_size(1000);
 int Parameters::max_file_element_count(10000);
+size_t Parameters::db_lock_stripe_count(64);
+size_t Parameters::max_transfer_chunk_bytes(1024 * 1024);
+size_t Parameters::accumulator_max_pending_count(300);
+size_t Parameters::accumulator_max_pending_bytes(16 * 1024 * 1024);
+std::chrono::steady_clock::duration Parameters::accumulator_max_pending_age(
+    std::chrono::seconds(60));
+size_t Parameters::accumulator_max_handled_count(1000);
+size_t Parameters::sync_batch_max_bytes(64 * 1024);
+std::chrono::steady_clock::duration Parameters::sync_batch_max_delay(
+    std::chrono::milliseconds(100));
+std::chrono::steady_clock::duration Parameters::sync_interval(std::chrono::milliseconds(500));
+std::chrono::steady_clock::duration Parameters::sync_max_interval(std::chrono::seconds(8));
+size_t Parameters::sync_max_queue_depth(10000);
+size_t Parameters::persona_executor_max_queue_size(10000);
+std::chrono::steady_clock::duration Parameters::persona_executor_max_lane_wait(
+    std::chrono::milliseconds(500));
+size_t Parameters::work_stealing_pool_thread_count(0);
+size_t Parameters::work_stealing_pool_strands_per_thread(16);
+uint64_t Parameters::hot_chunk_cache_capacity_bytes(200 * 1024 * 1024);
+size_t Parameters::hot_chunk_cache_shard_count(16);
+size_t Parameters::hot_chunk_cache_sketch_width(64 * 1024);
+size_t Parameters::chunk_io_thread_count(4);
+size_t Parameters::chunk_io_max_queue_size(1024);
+size_t Parameters::chunk_io_max_sync_batch(64);
+std::chrono::steady_clock::duration Parameters::chunk_io_max_sync_delay(
+    std::chrono::milliseconds(5));
+uint64_t Parameters::segment_store_max_segment_bytes(256 * 1024 * 1024);
+double Parameters::segment_store_compaction_garbage_ratio(0.5);
+double Parameters::pmid_node_permanent_disk_share(0.8);
+double Parameters::pmid_node_cache_disk_share(0.1);
+uint64_t Parameters::pmid_node_cache_memory_usage(200 * 1024 * 1024);
+size_t Parameters::group_db_metadata_cache_size(4096);
+size_t Parameters::group_db_max_unflushed_commits(256);
+std::chrono::steady_clock::duration Parameters::group_db_flush_interval(
+    std::chrono::milliseconds(100));
+bool Parameters::group_db_sync_flushes(false);
 
 }  // namespace detail
 
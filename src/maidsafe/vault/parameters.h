@@ -19,7 +19,9 @@
 #ifndef MAIDSAFE_VAULT_PARAMETERS_H_
 #define MAIDSAFE_VAULT_PARAMETERS_H_
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 
 
 namespace maidsafe {
@@ -36,6 +38,62 @@ struct Parameters {
   static size_t max_recent_data_list_size;
   // Max count of elements allowed in each account file
   static int max_file_element_count;
+  // Number of independently-locked key stripes in each Db and GroupDb.
+  static size_t db_lock_stripe_count;
+  // Approximate upper bound on the size of each chunk of db entries sent to a new holder on churn.
+  static size_t max_transfer_chunk_bytes;
+  // Default limits for each Accumulator (see AccumulatorPolicy).
+  static size_t accumulator_max_pending_count;
+  static size_t accumulator_max_pending_bytes;
+  static std::chrono::steady_clock::duration accumulator_max_pending_age;
+  static size_t accumulator_max_handled_count;
+  // A group's coalesced sync message is sent once its actions reach this many bytes...
+  static size_t sync_batch_max_bytes;
+  // ...or once it has been waiting this long.
+  static std::chrono::steady_clock::duration sync_batch_max_delay;
+  // Interval between each persona's sync rounds, and the interval it backs off to while its
+  // outbound queue holds more than 'sync_max_queue_depth' actions.
+  static std::chrono::steady_clock::duration sync_interval;
+  static std::chrono::steady_clock::duration sync_max_interval;
+  static size_t sync_max_queue_depth;
+  // Default queue bound for each persona's executor.
+  static size_t persona_executor_max_queue_size;
+  // How long a task may wait in a persona executor's lane before it's run ahead of higher priority
+  // lanes.
+  static std::chrono::steady_clock::duration persona_executor_max_lane_wait;
+  // Threads in the pool running all personas' tasks (0 uses the hardware concurrency), and the
+  // number of strands per thread which task affinities are hashed onto.
+  static size_t work_stealing_pool_thread_count;
+  static size_t work_stealing_pool_strands_per_thread;
+  // Size and number of shards of each PmidNode's in-memory cache of hot chunks, and the number of
+  // counters per row of the frequency sketch deciding which chunks are admitted to it.
+  static uint64_t hot_chunk_cache_capacity_bytes;
+  static size_t hot_chunk_cache_shard_count;
+  static size_t hot_chunk_cache_sketch_width;
+  // I/O threads and bounded submission queue size of each PmidNode's chunk I/O engine, and the
+  // largest group of written chunks (or longest wait) covered by a single sync.
+  static size_t chunk_io_thread_count;
+  static size_t chunk_io_max_queue_size;
+  static size_t chunk_io_max_sync_batch;
+  static std::chrono::steady_clock::duration chunk_io_max_sync_delay;
+  // Size at which a PmidNode's current storage segment is sealed, and the share of a sealed
+  // segment's bytes which must be deleted chunks before it's compacted.
+  static uint64_t segment_store_max_segment_bytes;
+  static double segment_store_compaction_garbage_ratio;
+  // Shares of the disk space available to a vault (free space plus what its permanent store
+  // already holds) given to the PmidNode's permanent store and its long-term cache, and the memory
+  // used by that cache.
+  static double pmid_node_permanent_disk_share;
+  static double pmid_node_cache_disk_share;
+  static uint64_t pmid_node_cache_memory_usage;
+  // Number of groups whose decoded metadata each GroupDb caches, and the durability point of the
+  // cache: committed updates are written to leveldb in one batch once this many commits are
+  // pending, or this long after the previous write (zero disables the timed write), optionally
+  // waiting for leveldb's log to be synced to disk.
+  static size_t group_db_metadata_cache_size;
+  static size_t group_db_max_unflushed_commits;
+  static std::chrono::steady_clock::duration group_db_flush_interval;
+  static bool group_db_sync_flushes;
 
  private:
   Parameters();
@@ -0,0 +1,232 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/persona_executor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+#include "maidsafe/common/log.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace {
+
+size_t MaxInFlight(const PersonaExecutorPolicy& policy, size_t thread_count,
+                   size_t pool_share_count) {
+  if (policy.max_in_flight != 0)
+    return policy.max_in_flight;
+  pool_share_count = std::max(pool_share_count, static_cast<size_t>(1));
+  return std::max((thread_count + pool_share_count - 1) / pool_share_count,
+                  static_cast<size_t>(1));
+}
+
+}  // unnamed namespace
+
+void LatencyHistogram::Add(std::chrono::steady_clock::duration latency) {
+  auto microseconds(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+  size_t bucket(0);
+  while (microseconds > 0 && bucket != kBucketCount - 1) {
+    microseconds >>= 1;
+    ++bucket;
+  }
+  ++buckets_[bucket];
+}
+
+uint64_t LatencyHistogram::count() const {
+  uint64_t total(0);
+  for (auto bucket_count : buckets_)
+    total += bucket_count;
+  return total;
+}
+
+std::chrono::microseconds LatencyHistogram::Percentile(double percentile) const {
+  auto target(static_cast<uint64_t>(std::ceil(count() * percentile / 100.0)));
+  uint64_t seen(0);
+  for (size_t bucket(0); bucket != kBucketCount; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen != 0 && seen >= target)
+      return std::chrono::microseconds(static_cast<int64_t>(1) << bucket);
+  }
+  return std::chrono::microseconds(0);
+}
+
+PersonaExecutor::PersonaExecutor(const std::string& name,
+                                 WorkStealingPool& pool,
+                                 const PersonaExecutorPolicy& policy,
+                                 size_t pool_share_count)
+    : kName_(name),
+      kPolicy_(policy),
+      kMaxInFlight_(MaxInFlight(policy, pool.thread_count(), pool_share_count)),
+      pool_(pool),
+      mutex_(),
+      condition_(),
+      lanes_(),
+      in_flight_(0),
+      next_affinity_(0),
+      stopped_(false),
+      stats_() {}
+
+PersonaExecutor::~PersonaExecutor() {
+  Stop();
+}
+
+bool PersonaExecutor::Post(Lane lane, uint64_t affinity, Task task) {
+  auto lane_index(static_cast<size_t>(lane));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopped_) {
+    ++stats_.shed;
+    ++stats_.lanes[lane_index].shed;
+    return false;
+  }
+  if (queue_size() >= kPolicy_.max_queue_size && !MakeRoom(lane_index)) {
+    LOG(kWarning) << kName_ << " executor queue full; rejecting task";
+    ++stats_.shed;
+    ++stats_.lanes[lane_index].shed;
+    return false;
+  }
+  lanes_[lane_index].push_back(QueuedTask(lane_index, affinity, task));
+  stats_.max_queue_depth = std::max(stats_.max_queue_depth, queue_size());
+  Dispatch();
+  return true;
+}
+
+bool PersonaExecutor::Post(Lane lane, Task task) {
+  uint64_t affinity(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    affinity = next_affinity_++;
+  }
+  return Post(lane, affinity, task);
+}
+
+void PersonaExecutor::Stop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopped_ = true;
+  for (size_t lane_index(0); lane_index != kLaneCount; ++lane_index) {
+    while (!lanes_[lane_index].empty())
+      Shed(lane_index, true);
+  }
+  condition_.wait(lock, [this] { return in_flight_ == 0; });
+}
+
+PersonaExecutor::Stats PersonaExecutor::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats(stats_);
+  stats.queue_depth = queue_size();
+  for (size_t lane_index(0); lane_index != kLaneCount; ++lane_index)
+    stats.lanes[lane_index].queue_depth = lanes_[lane_index].size();
+  return stats;
+}
+
+size_t PersonaExecutor::queue_size() const {
+  size_t size(0);
+  for (const auto& lane : lanes_)
+    size += lane.size();
+  return size;
+}
+
+bool PersonaExecutor::MakeRoom(size_t lane_index) {
+  // Prefer shedding from the lowest priority lane which has queued tasks.
+  size_t victim_index(kLaneCount);
+  while (victim_index != 0 && lanes_[victim_index - 1].empty())
+    --victim_index;
+  if (victim_index == 0)
+    return false;
+  --victim_index;
+  bool drop_oldest(kPolicy_.shedding_policy == SheddingPolicy::kDropOldest);
+  if (victim_index > lane_index) {
+    Shed(victim_index, drop_oldest);
+    return true;
+  }
+  if (victim_index == lane_index && drop_oldest) {
+    LOG(kWarning) << kName_ << " executor queue full; dropping oldest task";
+    Shed(lane_index, true);
+    return true;
+  }
+  return false;
+}
+
+void PersonaExecutor::Shed(size_t lane_index, bool oldest) {
+  if (oldest)
+    lanes_[lane_index].pop_front();
+  else
+    lanes_[lane_index].pop_back();
+  ++stats_.shed;
+  ++stats_.lanes[lane_index].shed;
+}
+
+size_t PersonaExecutor::NextLane() const {
+  // A lane whose oldest task has waited too long goes first; otherwise strict priority.
+  auto overdue(std::chrono::steady_clock::now() - kPolicy_.max_lane_wait);
+  size_t next(kLaneCount);
+  for (size_t lane_index(0); lane_index != kLaneCount; ++lane_index) {
+    if (lanes_[lane_index].empty())
+      continue;
+    if (next == kLaneCount)
+      next = lane_index;
+    if (lanes_[lane_index].front().queued <= overdue &&
+        lanes_[lane_index].front().queued < lanes_[next].front().queued) {
+      next = lane_index;
+    }
+  }
+  return next;
+}
+
+void PersonaExecutor::Dispatch() {
+  // WorkStealingPool::Post never runs a task inline, so it's safe to call with 'mutex_' held.
+  size_t lane_index(kLaneCount);
+  while (!stopped_ && in_flight_ < kMaxInFlight_ && (lane_index = NextLane()) != kLaneCount) {
+    QueuedTask queued_task(std::move(lanes_[lane_index].front()));
+    lanes_[lane_index].pop_front();
+    ++in_flight_;
+    auto affinity(queued_task.affinity);
+    pool_.Post(affinity, [this, queued_task] { Run(queued_task); });
+  }
+}
+
+void PersonaExecutor::Run(const QueuedTask& queued_task) {
+  auto started(std::chrono::steady_clock::now());
+  bool succeeded(true);
+  try {
+    queued_task.task();
+  }
+  catch(const std::exception& e) {
+    LOG(kError) << kName_ << " task failed: " << e.what();
+    succeeded = false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& lane_stats(stats_.lanes[queued_task.lane_index]);
+  ++lane_stats.executed;
+  lane_stats.wait_latency.Add(started - queued_task.queued);
+  ++stats_.executed;
+  if (!succeeded)
+    ++stats_.failed;
+  --in_flight_;
+  Dispatch();
+  if (in_flight_ == 0)
+    condition_.notify_all();
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
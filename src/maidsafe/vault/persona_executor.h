@@ -0,0 +1,186 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_PERSONA_EXECUTOR_H_
+#define MAIDSAFE_VAULT_PERSONA_EXECUTOR_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "maidsafe/vault/parameters.h"
+#include "maidsafe/vault/work_stealing_pool.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+// Classes of work, highest priority first.
+enum class Lane {
+  kControl,  // Churn handling
+  kSync,     // Sync and account transfer messages
+  kGet,
+  kPut       // PUTs, DELETEs and anything else
+};
+
+const size_t kLaneCount(4);
+
+// What a PersonaExecutor does with a task posted while its queue is full, if no task in a lower
+// priority lane can be shed instead.
+enum class SheddingPolicy {
+  kRejectNewest,  // Post returns false and the new task is discarded.
+  kDropOldest     // The longest-queued task in the new task's lane is discarded to make room.
+};
+
+struct PersonaExecutorPolicy {
+  PersonaExecutorPolicy()
+      : max_queue_size(detail::Parameters::persona_executor_max_queue_size),
+        shedding_policy(SheddingPolicy::kRejectNewest),
+        max_in_flight(0),
+        max_lane_wait(detail::Parameters::persona_executor_max_lane_wait) {}
+  PersonaExecutorPolicy(size_t max_queue_size_in, SheddingPolicy shedding_policy_in)
+      : max_queue_size(max_queue_size_in),
+        shedding_policy(shedding_policy_in),
+        max_in_flight(0),
+        max_lane_wait(detail::Parameters::persona_executor_max_lane_wait) {}
+  size_t max_queue_size;
+  SheddingPolicy shedding_policy;
+  // Max tasks handed to the pool at once; 0 means the executor's share of the pool's threads.
+  size_t max_in_flight;
+  // A lane's oldest task is run ahead of higher priority lanes once it has waited this long.
+  std::chrono::steady_clock::duration max_lane_wait;
+};
+
+struct PersonaExecutorPolicies {
+  PersonaExecutorPolicy maid_manager, version_manager, data_manager, pmid_manager, pmid_node;
+};
+
+// Counts durations in power-of-two buckets of microseconds.
+class LatencyHistogram {
+ public:
+  static const size_t kBucketCount = 32;
+
+  LatencyHistogram() : buckets_() {}
+  void Add(std::chrono::steady_clock::duration latency);
+  uint64_t count() const;
+  // Upper bound of the bucket holding the given percentile (0 to 100) of recorded latencies.
+  std::chrono::microseconds Percentile(double percentile) const;
+  const std::array<uint64_t, kBucketCount>& buckets() const { return buckets_; }
+
+ private:
+  std::array<uint64_t, kBucketCount> buckets_;
+};
+
+// Admits one persona's tasks to a shared WorkStealingPool through bounded, prioritised lanes, so
+// that a persona which falls behind sheds its own bulk load rather than delaying the others or
+// its own control traffic.  Tasks posted to the same lane with the same affinity run in the order
+// posted.
+class PersonaExecutor {
+ public:
+  typedef std::function<void()> Task;
+
+  struct LaneStats {
+    LaneStats() : executed(0), shed(0), queue_depth(0), wait_latency() {}
+    uint64_t executed, shed;
+    size_t queue_depth;
+    // Time from Post until the task started running.
+    LatencyHistogram wait_latency;
+  };
+
+  struct Stats {
+    Stats() : executed(0), failed(0), shed(0), queue_depth(0), max_queue_depth(0), lanes() {}
+    uint64_t executed, failed, shed;
+    // Tasks posted but not yet handed to the pool.
+    size_t queue_depth, max_queue_depth;
+    std::array<LaneStats, kLaneCount> lanes;
+  };
+
+  // 'pool_share_count' is the number of executors sharing 'pool'.  Unless the policy sets
+  // 'max_in_flight', each takes an even share of the pool's threads (rounded up), so one stalled
+  // executor can't occupy them all.
+  PersonaExecutor(const std::string& name,
+                  WorkStealingPool& pool,
+                  const PersonaExecutorPolicy& policy = PersonaExecutorPolicy(),
+                  size_t pool_share_count = 1);
+  // Sheds any queued tasks and waits for running ones to finish.
+  ~PersonaExecutor();
+
+  // Return false if the task was shed rather than queued.  Tasks posted after Stop are shed.
+  bool Post(Lane lane, uint64_t affinity, Task task);
+  // Spreads tasks without a natural affinity across the pool.
+  bool Post(Lane lane, Task task);
+  void Stop();
+  Stats stats();
+
+ private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  struct QueuedTask {
+    QueuedTask(size_t lane_index_in, uint64_t affinity_in, Task task_in)
+        : lane_index(lane_index_in),
+          affinity(affinity_in),
+          task(task_in),
+          queued(std::chrono::steady_clock::now()) {}
+    size_t lane_index;
+    uint64_t affinity;
+    Task task;
+    TimePoint queued;
+  };
+
+  PersonaExecutor(const PersonaExecutor&);
+  PersonaExecutor& operator=(const PersonaExecutor&);
+  PersonaExecutor(PersonaExecutor&&);
+  PersonaExecutor& operator=(PersonaExecutor&&);
+
+  // These require 'mutex_' to be held.
+  size_t queue_size() const;
+  bool MakeRoom(size_t lane_index);
+  void Shed(size_t lane_index, bool oldest);
+  // Returns kLaneCount if all lanes are empty.
+  size_t NextLane() const;
+  // Hands queued tasks to 'pool_' while 'in_flight_' allows.  This is done under 'mutex_' so that
+  // tasks reach their strands in the order they left the lanes.
+  void Dispatch();
+
+  void Run(const QueuedTask& queued_task);
+
+  const std::string kName_;
+  const PersonaExecutorPolicy kPolicy_;
+  const size_t kMaxInFlight_;
+  WorkStealingPool& pool_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::array<std::deque<QueuedTask>, kLaneCount> lanes_;
+  // Tasks handed to 'pool_' which haven't yet returned.
+  size_t in_flight_;
+  uint64_t next_affinity_;
+  bool stopped_;
+  Stats stats_;
+};
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_PERSONA_EXECUTOR_H_
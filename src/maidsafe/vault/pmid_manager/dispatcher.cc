@@ -18,6 +18,8 @@
 
 #include "maidsafe/vault/pmid_manager/dispatcher.h"
 
+#include "maidsafe/common/utils.h"
+
 #include "maidsafe/vault/message_types.h"
 
 namespace maidsafe {
@@ -40,18 +42,18 @@ PmidManagerDispatcher::PmidManagerDispatcher(routing::Routing& routing)
 //  routing_.Send(message);
 //}
 
-//void PmidManagerDispatcher::SendSync(const PmidName& pmid_node,
-//                                     const std::string& serialised_sync) {
-//  typedef nfs::SynchroniseFromPmidManagerToPmidManager NfsMessage;
-//  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
-
-//  NfsMessage nfs_message(serialised_sync); // TODO(Mahmoud): MUST BE FIXED
-//  RoutingMessage message(nfs_message.Serialise(),
-//                         NfsMessage::Sender(routing::GroupId(pmid_node),
-//                                            routing::SingleId(routing_.kNodeId())),
-//                         NfsMessage::Receiver(routing::GroupId(pmid_node)));
-//  routing_.Send(message);
-//}
+void PmidManagerDispatcher::SendSync(const PmidName& pmid_node,
+                                     const std::string& serialised_sync) {
+  typedef SynchroniseFromPmidManagerToPmidManager VaultMessage;
+  typedef routing::Message<VaultMessage::Sender, VaultMessage::Receiver> RoutingMessage;
+
+  VaultMessage vault_message(nfs::MessageId(RandomInt32()), nfs_vault::Content(serialised_sync));
+  RoutingMessage message(vault_message.Serialise(),
+                         VaultMessage::Sender(routing::GroupId(NodeId(pmid_node->string())),
+                                              routing::SingleId(routing_.kNodeId())),
+                         VaultMessage::Receiver(routing::GroupId(NodeId(pmid_node->string()))));
+  routing_.Send(message);
+}
 
 //void PmidManagerDispatcher::SendAccountTransfer(const PmidName& destination_peer,
 //                                                const PmidName& pmid_node,
@@ -19,6 +19,7 @@
 #include "maidsafe/vault/pmid_manager/service.h"
 
 #include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
 
 #include "maidsafe/vault/pmid_manager/pmid_manager.pb.h"
 #include "maidsafe/vault/pmid_manager/metadata.h"
@@ -45,12 +46,21 @@ inline bool ForThisPersona(const Message& message) {
 
 
 PmidManagerService::PmidManagerService(const passport::Pmid& /*pmid*/,
-                                       routing::Routing& routing)
+                                       routing::Routing& routing,
+                                       const AccumulatorPolicy& accumulator_policy)
     : routing_(routing),
 
       accumulator_mutex_(),
-      accumulator_(),
-      dispatcher_(routing_) {}
+      accumulator_(accumulator_policy),
+      dispatcher_(routing_),
+      sync_puts_(),
+      sync_coalescer_([this](const NodeId& group_id, const std::string& serialised_batch) {
+                        dispatcher_.SendSync(PmidName(Identity(group_id.string())),
+                                             serialised_batch);
+                      }),
+      sync_scheduler_([this] { DoSync(); },
+                      [this] { return sync_coalescer_.queued_actions(); },
+                      [this] { sync_coalescer_.FlushDue(); }) {}
 //      pmid_account_handler_(db, routing.kNodeId()),
 
 template<>
@@ -250,6 +260,14 @@ void PmidManagerService::HandleMessage(
 
 // =============== Sync ===========================================================================
 
+void PmidManagerService::DoSync() {
+  sync_coalescer_.AddUnresolvedActions(
+      sync_puts_,
+      [](const PmidManager::Key& key) { return NodeId(key.group_name->string()); });
+  sync_coalescer_.FlushAll();
+  sync_puts_.IncrementSyncAttempts();
+}
+
 //void PmidManagerService::Sync(const PmidName& account_name) {
 //  auto serialised_sync_data(pmid_account_handler_.GetSyncData(account_name));
 //  if (!serialised_sync_data.IsInitialised())  // Nothing to sync
@@ -262,17 +280,35 @@ void PmidManagerService::HandleMessage(
 //  nfs_.Sync(account_name, NonEmptyString(proto_sync.SerializeAsString()));
 //}
 
-//void PmidManagerService::HandleSync(const nfs::Message& message) {
-//  std::vector<PmidManagerUnresolvedEntry> resolved_entries;
-//  protobuf::Sync proto_sync;
-//  if (!proto_sync.ParseFromString(message.data().content.string())) {
-//    LOG(kError) << "Error parsing Synchronise message.";
-//    return;
-//  }
+// There is no PmidManager account store yet, so a resolved put has nothing further to apply;
+// adding the peer's action still lets the matching local action resolve and stop being re-sent.
+void PmidManagerService::HandleSync(const std::string& serialised_batch,
+                                    const NodeId& sender_id) {
+  for (const auto& proto_sync : SyncCoalescer::Unpack(serialised_batch)) {
+    try {
+      if (static_cast<nfs::MessageAction>(proto_sync.action_type()) ==
+          ActionPmidManagerPut::kActionId) {
+        PmidManager::UnresolvedPut unresolved_action(proto_sync.serialised_unresolved_action(),
+                                                     sender_id, routing_.kNodeId());
+        sync_puts_.AddUnresolvedAction(unresolved_action);
+      } else {
+        LOG(kError) << "Unhandled action type " << proto_sync.action_type();
+      }
+    }
+    catch(const std::exception& e) {
+      LOG(kError) << "Failed to apply synced action of type " << proto_sync.action_type()
+                  << ": " << e.what();
+    }
+  }
+}
 
-//  pmid_account_handler_.ApplySyncData(PmidName(Identity(proto_sync.account_name())),
-//                                      NonEmptyString(proto_sync.serialised_unresolved_entries()));
-//}
+template<>
+void PmidManagerService::HandleMessage(
+    const SynchroniseFromPmidManagerToPmidManager& message,
+    const typename SynchroniseFromPmidManagerToPmidManager::Sender& sender,
+    const typename SynchroniseFromPmidManagerToPmidManager::Receiver& /*receiver*/) {
+  HandleSync(message.contents->data, sender.sender_id);
+}
 
 // =============== Account transfer ===============================================================
 
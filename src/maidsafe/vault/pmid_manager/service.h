@@ -21,6 +21,7 @@
 
 #include <mutex>
 #include <set>
+#include <string>
 #include <vector>
 
 #include "boost/filesystem/path.hpp"
@@ -32,11 +33,14 @@
 #include "maidsafe/nfs/types.h"
 
 #include "maidsafe/vault/accumulator.h"
+#include "maidsafe/vault/message_types.h"
 #include "maidsafe/vault/pmid_manager/handler.h"
 #include "maidsafe/vault/types.h"
 #include "maidsafe/vault/pmid_manager/dispatcher.h"
 #include "maidsafe/vault/pmid_manager/pmid_manager.h"
 #include "maidsafe/vault/sync.h"
+#include "maidsafe/vault/sync_coalescer.h"
+#include "maidsafe/vault/sync_scheduler.h"
 
 
 namespace maidsafe {
@@ -45,9 +49,10 @@ namespace vault {
 class PmidManagerService {
  public:
   typedef nfs::PmidManagerServiceMessages PublicMessages;
-  typedef nfs::PmidManagerServiceMessages VaultMessages; // FIXME (Check with Fraser)
+  typedef PmidManagerServiceMessages VaultMessages;
 
-  PmidManagerService(const passport::Pmid& pmid, routing::Routing& routing);
+  PmidManagerService(const passport::Pmid& pmid, routing::Routing& routing,
+                     const AccumulatorPolicy& accumulator_policy = AccumulatorPolicy());
 
   template<typename T>
   void HandleMessage(const T& message,
@@ -86,7 +91,11 @@ class PmidManagerService {
   void HandlePutResponse(const typename Data::Name& data,
                          const PmidName& pmid_node,
                          const nfs::MessageId& message_id);
+  // One round of 'sync_scheduler_': sends this node's unresolved actions to its peers, coalesced
+  // per account, then advances their sync attempts.
   void DoSync();
+  // Handles the content of a Synchronise message from a peer: a batch of unresolved actions.
+  void HandleSync(const std::string& serialised_batch, const NodeId& sender_id);
 
 //  template<typename Data>
 //  void HandlePutCallback(const std::string& reply, const nfs::Message& message);
@@ -108,6 +117,8 @@ class PmidManagerService {
 //  PmidAccountHandler pmid_account_handler_;
   PmidManagerDispatcher dispatcher_;
   Sync<PmidManager::UnresolvedPut> sync_puts_;
+  SyncCoalescer sync_coalescer_;
+  SyncScheduler sync_scheduler_;
 };
 
 // ============================= Handle Message Specialisations ===================================
@@ -143,11 +154,11 @@ void PmidManagerService::HandleMessage(
     const typename nfs::GetPmidAccountResponseFromPmidManagerToPmidNode::Sender& sender,
     const typename nfs::GetPmidAccountResponseFromPmidManagerToPmidNode::Receiver& receiver);
 
-//template<>
-//void PmidManagerService::HandleMessage(
-//    const nfs::SynchroniseFromPmidManagerToPmidManager& message,
-//    const typename nfs::SynchroniseFromPmidManagerToPmidManager::Sender& sender,
-//    const typename nfs::SynchroniseFromPmidManagerToPmidManager::Receiver& receiver);
+template<>
+void PmidManagerService::HandleMessage(
+    const SynchroniseFromPmidManagerToPmidManager& message,
+    const typename SynchroniseFromPmidManagerToPmidManager::Sender& sender,
+    const typename SynchroniseFromPmidManagerToPmidManager::Receiver& receiver);
 
 //template<>
 //void PmidManagerService::HandleMessage(
@@ -193,7 +204,7 @@ void PmidManagerService::HandlePutResponse(const typename Data::Name& name,
                                  ActionPmidManagerPut(1024/* Needs size from timer cons*/),
                                  routing_.kNodeId(),
                                  message_id));
-  DoSync();
+  sync_scheduler_.Notify();
 }
 
 
@@ -0,0 +1,205 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/pmid_node/chunk_io_engine.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "maidsafe/common/log.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+ChunkIoEngine::ChunkIoEngine(WriteFunctor write_functor,
+                             SyncFunctor sync_functor,
+                             size_t thread_count,
+                             size_t max_queue_size,
+                             size_t max_sync_batch,
+                             std::chrono::steady_clock::duration max_sync_delay)
+    : kWriteFunctor_(write_functor),
+      kSyncFunctor_(sync_functor),
+      kMaxQueueSize_(std::max(max_queue_size, static_cast<size_t>(1))),
+      kMaxSyncBatch_(std::max(max_sync_batch, static_cast<size_t>(1))),
+      kMaxSyncDelay_(max_sync_delay),
+      mutex_(),
+      submit_condition_(),
+      write_condition_(),
+      sync_condition_(),
+      queue_(),
+      written_(),
+      oldest_written_(),
+      writing_(0),
+      stopped_(false),
+      stats_(),
+      writer_threads_(),
+      syncer_thread_() {
+  for (size_t i(0); i != std::max(thread_count, static_cast<size_t>(1)); ++i)
+    writer_threads_.push_back(std::thread([this] { RunWriter(); }));
+  syncer_thread_ = std::thread([this] { RunSyncer(); });
+}
+
+ChunkIoEngine::~ChunkIoEngine() {
+  Stop();
+}
+
+bool ChunkIoEngine::Submit(const DataNameVariant& data_name, const NonEmptyString& content,
+                           CompletionFunctor on_complete) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    submit_condition_.wait(lock, [this] { return stopped_ || queue_.size() < kMaxQueueSize_; });
+    if (!stopped_) {
+      queue_.push_back(Request(data_name, content, on_complete));
+      ++stats_.submitted;
+      stats_.max_queue_depth = std::max(stats_.max_queue_depth,
+                                        static_cast<uint64_t>(queue_.size()));
+      write_condition_.notify_one();
+      return true;
+    }
+  }
+  Complete(on_complete, maidsafe_error(make_error_code(CommonErrors::unable_to_handle_request)));
+  return false;
+}
+
+void ChunkIoEngine::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  submit_condition_.notify_all();
+  write_condition_.notify_all();
+  sync_condition_.notify_all();
+  for (auto& writer_thread : writer_threads_) {
+    if (writer_thread.joinable())
+      writer_thread.join();
+  }
+  if (syncer_thread_.joinable())
+    syncer_thread_.join();
+}
+
+ChunkIoEngine::Stats ChunkIoEngine::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats(stats_);
+  stats.queue_depth = queue_.size();
+  return stats;
+}
+
+void ChunkIoEngine::RunWriter() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    write_condition_.wait(lock, [this] { return stopped_ || !queue_.empty(); });
+    if (queue_.empty())
+      return;
+    Request request(std::move(queue_.front()));
+    queue_.pop_front();
+    ++writing_;
+    submit_condition_.notify_one();
+    lock.unlock();
+
+    bool written(false);
+    maidsafe_error error(make_error_code(CommonErrors::success));
+    try {
+      kWriteFunctor_(request.data_name, request.content);
+      written = true;
+    } catch(const maidsafe_error& write_error) {
+      LOG(kError) << "Failed to write chunk: " << write_error.what();
+      error = write_error;
+    } catch(const std::exception& e) {
+      LOG(kError) << "Failed to write chunk: " << e.what();
+      error = maidsafe_error(make_error_code(CommonErrors::filesystem_io_error));
+    }
+    if (!written)
+      Complete(request.on_complete, error);
+
+    lock.lock();
+    --writing_;
+    if (written) {
+      if (written_.empty())
+        oldest_written_ = std::chrono::steady_clock::now();
+      written_.push_back(std::move(request.on_complete));
+    } else {
+      ++stats_.failed;
+    }
+    // The syncer also needs waking to exit once the last write has finished after a Stop.
+    if (SyncDue(std::chrono::steady_clock::now()) ||
+        (stopped_ && queue_.empty() && writing_ == 0)) {
+      sync_condition_.notify_one();
+    }
+  }
+}
+
+bool ChunkIoEngine::SyncDue(TimePoint now) const {
+  return !written_.empty() &&
+         (written_.size() >= kMaxSyncBatch_ || (queue_.empty() && writing_ == 0) ||
+          now >= oldest_written_ + kMaxSyncDelay_);
+}
+
+void ChunkIoEngine::RunSyncer() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    while (!SyncDue(std::chrono::steady_clock::now())) {
+      if (written_.empty()) {
+        if (stopped_ && queue_.empty() && writing_ == 0)
+          return;
+        sync_condition_.wait(lock);
+      } else {
+        sync_condition_.wait_until(lock, oldest_written_ + kMaxSyncDelay_);
+      }
+    }
+    std::vector<CompletionFunctor> group;
+    group.swap(written_);
+    lock.unlock();
+
+    bool synced(false);
+    maidsafe_error error(make_error_code(CommonErrors::success));
+    try {
+      kSyncFunctor_();
+      synced = true;
+    } catch(const maidsafe_error& sync_error) {
+      LOG(kError) << "Failed to sync " << group.size() << " chunks: " << sync_error.what();
+      error = sync_error;
+    } catch(const std::exception& e) {
+      LOG(kError) << "Failed to sync " << group.size() << " chunks: " << e.what();
+      error = maidsafe_error(make_error_code(CommonErrors::filesystem_io_error));
+    }
+    for (const auto& on_complete : group)
+      Complete(on_complete, error);
+
+    lock.lock();
+    ++stats_.syncs;
+    if (synced)
+      stats_.completed += group.size();
+    else
+      stats_.failed += group.size();
+  }
+}
+
+void ChunkIoEngine::Complete(const CompletionFunctor& on_complete, const maidsafe_error& error) {
+  try {
+    on_complete(error);
+  } catch(const std::exception& e) {
+    LOG(kError) << "Chunk I/O completion functor threw: " << e.what();
+  }
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -0,0 +1,121 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_PMID_NODE_CHUNK_IO_ENGINE_H_
+#define MAIDSAFE_VAULT_PMID_NODE_CHUNK_IO_ENGINE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/data_types/data_name_variant.h"
+
+#include "maidsafe/vault/parameters.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+// Writes chunks off the message-handling threads.  Submitted chunks are queued (up to
+// 'max_queue_size', beyond which Submit blocks) and written by 'thread_count' I/O threads.  Written
+// chunks are made durable by a single 'sync_functor' call per group, and each chunk's completion
+// functor is only invoked once its group has been synced.  A group is synced as soon as it holds
+// 'max_sync_batch' chunks, when no further writes are queued or running, or when its oldest chunk
+// has waited 'max_sync_delay'.
+class ChunkIoEngine {
+ public:
+  typedef std::function<void(const DataNameVariant&, const NonEmptyString&)> WriteFunctor;
+  typedef std::function<void()> SyncFunctor;
+  typedef std::function<void(const maidsafe_error&)> CompletionFunctor;
+
+  struct Stats {
+    Stats() : submitted(0), completed(0), failed(0), syncs(0), queue_depth(0), max_queue_depth(0) {}
+    uint64_t submitted, completed, failed, syncs, queue_depth, max_queue_depth;
+  };
+
+  ChunkIoEngine(WriteFunctor write_functor,
+                SyncFunctor sync_functor,
+                size_t thread_count = detail::Parameters::chunk_io_thread_count,
+                size_t max_queue_size = detail::Parameters::chunk_io_max_queue_size,
+                size_t max_sync_batch = detail::Parameters::chunk_io_max_sync_batch,
+                std::chrono::steady_clock::duration max_sync_delay =
+                    detail::Parameters::chunk_io_max_sync_delay);
+  ~ChunkIoEngine();
+
+  // 'on_complete' is invoked on one of the engine's threads, or immediately with an error if the
+  // engine has been stopped, in which case the write functor is never called for 'content' and
+  // false is returned.
+  bool Submit(const DataNameVariant& data_name, const NonEmptyString& content,
+              CompletionFunctor on_complete);
+  // Writes and syncs everything already submitted, then stops the engine's threads.  Safe to call
+  // more than once.
+  void Stop();
+  Stats stats();
+
+ private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  struct Request {
+    Request(const DataNameVariant& data_name_in, const NonEmptyString& content_in,
+            CompletionFunctor on_complete_in)
+        : data_name(data_name_in), content(content_in), on_complete(on_complete_in) {}
+    DataNameVariant data_name;
+    NonEmptyString content;
+    CompletionFunctor on_complete;
+  };
+
+  ChunkIoEngine(const ChunkIoEngine&);
+  ChunkIoEngine& operator=(const ChunkIoEngine&);
+  ChunkIoEngine(ChunkIoEngine&&);
+  ChunkIoEngine& operator=(ChunkIoEngine&&);
+
+  void RunWriter();
+  void RunSyncer();
+  bool SyncDue(TimePoint now) const;
+  void Complete(const CompletionFunctor& on_complete, const maidsafe_error& error);
+
+  const WriteFunctor kWriteFunctor_;
+  const SyncFunctor kSyncFunctor_;
+  const size_t kMaxQueueSize_, kMaxSyncBatch_;
+  const std::chrono::steady_clock::duration kMaxSyncDelay_;
+  std::mutex mutex_;
+  std::condition_variable submit_condition_, write_condition_, sync_condition_;
+  std::deque<Request> queue_;
+  // Completion functors of written chunks awaiting the next sync.
+  std::vector<CompletionFunctor> written_;
+  TimePoint oldest_written_;
+  size_t writing_;
+  bool stopped_;
+  Stats stats_;
+  std::vector<std::thread> writer_threads_;
+  std::thread syncer_thread_;
+};
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_PMID_NODE_CHUNK_IO_ENGINE_H_
@@ -0,0 +1,68 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_PMID_NODE_CHUNK_VIEW_H_
+#define MAIDSAFE_VAULT_PMID_NODE_CHUNK_VIEW_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "maidsafe/common/types.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+// A read-only view of a stored chunk's content, either in memory or in a memory-mapped segment.
+// The view shares ownership of whatever holds the content, so it stays valid after the chunk is
+// deleted or its segment compacted.
+class ChunkView {
+ public:
+  ChunkView() : content_(), mapping_(), data_(nullptr), size_(0) {}
+  explicit ChunkView(std::shared_ptr<const NonEmptyString> content)
+      : content_(content),
+        mapping_(),
+        data_(content_ ? content_->string().data() : nullptr),
+        size_(content_ ? content_->string().size() : 0) {}
+  ChunkView(std::shared_ptr<const void> mapping, const char* data, size_t size)
+      : content_(), mapping_(mapping), data_(data), size_(size) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  // Null if the view is of a mapping.
+  const std::shared_ptr<const NonEmptyString>& content() const { return content_; }
+  // Copies the content out, unless it's already held in memory.
+  NonEmptyString ToNonEmptyString() const {
+    return content_ ? *content_ : NonEmptyString(std::string(data_, size_));
+  }
+
+ private:
+  std::shared_ptr<const NonEmptyString> content_;
+  std::shared_ptr<const void> mapping_;
+  const char* data_;
+  size_t size_;
+};
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_PMID_NODE_CHUNK_VIEW_H_
@@ -18,41 +18,109 @@
 
 #include "maidsafe/vault/pmid_node/handler.h"
 
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/variant/apply_visitor.hpp"
+
+#include "maidsafe/common/error.h"
+
 
 namespace maidsafe {
 namespace vault {
 
+namespace detail {
+
 namespace {
 
-MemoryUsage mem_usage = MemoryUsage(524288000);  // 500Mb
-MemoryUsage perm_usage = MemoryUsage(mem_usage / 5);
-DiskUsage perm_disk_usage = DiskUsage(10000);
-MemoryUsage cache_usage = MemoryUsage(mem_usage * 2 / 5);
+class PermanentStoreKeyVisitor : public boost::static_visitor<std::string> {
+ public:
+  template<typename DataName>
+  result_type operator()(const DataName& data_name) const {
+    return std::string(1, static_cast<char>(DataName::data_type)) + data_name.value.string();
+  }
+};
 
-MemoryUsage mem_only_cache_usage = MemoryUsage(100);  // size in elements
+}  // unnamed namespace
 
-// MemoryUsage mem_only_cache_usage = MemoryUsage(mem_usage * 2 / 5);
-//  fs::space_info space = fs::space("/tmp/vault_root_dir\\");  // FIXME  NOLINT
+std::string PermanentStoreKey(const DataNameVariant& data_name) {
+  return boost::apply_visitor(PermanentStoreKeyVisitor(), data_name);
+}
+
+}  // namespace detail
 
-//  DiskUsage disk_total = DiskUsage(space.available);
-//  DiskUsage permanent_size = DiskUsage(disk_total * 0.8);
-//  DiskUsage cache_size = DiskUsage(disk_total * 0.1);
+namespace {
 
-}  // namespace
+// Only run at startup.  The permanent store holds a handful of large segment files.
+uint64_t StoredBytes(const boost::filesystem::path& directory) {
+  uint64_t stored_bytes(0);
+  boost::system::error_code error_code;
+  for (boost::filesystem::directory_iterator itr(directory, error_code);
+       itr != boost::filesystem::directory_iterator(); ++itr) {
+    if (boost::filesystem::is_regular_file(itr->status()))
+      stored_bytes += boost::filesystem::file_size(itr->path());
+  }
+  return stored_bytes;
+}
+
+}  // unnamed namespace
 
 PmidNodeHandler::PmidNodeHandler(const boost::filesystem::path vault_root_dir)
   : space_info_(boost::filesystem::space(vault_root_dir)),
-    disk_total_(space_info_.available),
-    permanent_size_(disk_total_ * 4 / 5),
-    cache_size_(disk_total_ / 10),
-    permanent_data_store_(vault_root_dir / "pmid_node" / "permanent", DiskUsage(10000)),  // TODO(Fraser) BEFORE_RELEASE need to read value from disk
-    cache_data_store_(cache_usage, DiskUsage(cache_size_ / 2), nullptr,
-                      vault_root_dir / "pmid_node" / "cache"),  // FIXME - DiskUsage  NOLINT
-    mem_only_cache_(mem_only_cache_usage) {
+    // The space this vault can use is what's free plus what it has already stored.
+    disk_total_(space_info_.available + StoredBytes(vault_root_dir / "pmid_node" / "permanent")),
+    permanent_size_(static_cast<uint64_t>(disk_total_.data *
+                                          detail::Parameters::pmid_node_permanent_disk_share)),
+    cache_size_(static_cast<uint64_t>(disk_total_.data *
+                                      detail::Parameters::pmid_node_cache_disk_share)),
+    permanent_data_store_(vault_root_dir / "pmid_node" / "permanent", permanent_size_),
+    cache_data_store_(MemoryUsage(detail::Parameters::pmid_node_cache_memory_usage), cache_size_,
+                      nullptr, vault_root_dir / "pmid_node" / "cache"),
+    hot_chunk_cache_(),
+    chunk_io_engine_([this](const DataNameVariant& data_name, const NonEmptyString& content) {
+                       auto key(detail::PermanentStoreKey(data_name));
+                       permanent_data_store_.Put(key, content,
+                                                 SegmentStore::RecordSize(key.size(),
+                                                                          content.string().size()));
+                     },
+                     [this] { permanent_data_store_.Sync(); }) {
+}
+
+ChunkView PmidNodeHandler::GetFromPermanentStore(const DataNameVariant& data_name) {
+  auto cached(hot_chunk_cache_.Get(data_name));
+  if (cached)
+    return ChunkView(cached);
+  auto view(permanent_data_store_.GetView(detail::PermanentStoreKey(data_name)));
+  // Chunks in sealed segments are already served from the page cache through the mapping, so only
+  // those which had to be read into memory are worth offering to the hot chunk cache.
+  if (view.content())
+    hot_chunk_cache_.Put(data_name, view.content());
+  return view;
 }
 
 boost::filesystem::path PmidNodeHandler::GetPermanentStorePath() const {
-  return permanent_data_store_.GetDiskPath();
+  return permanent_data_store_.directory();
+}
+
+NonEmptyString PmidNodeHandler::GetFromCache(const DataNameVariant& data_name) {
+  if (!boost::apply_visitor(detail::CacheableVisitor(), data_name))
+    ThrowError(CommonErrors::invalid_parameter);
+  if (boost::apply_visitor(detail::LongTermCacheableVisitor(), data_name))
+    return cache_data_store_.Get(data_name);
+  auto cached(hot_chunk_cache_.Get(data_name));
+  if (!cached)
+    ThrowError(CommonErrors::no_such_element);
+  return *cached;
+}
+
+void PmidNodeHandler::StoreInCache(const DataNameVariant& data_name,
+                                   const NonEmptyString& content) {
+  if (!boost::apply_visitor(detail::CacheableVisitor(), data_name))
+    ThrowError(CommonErrors::invalid_parameter);
+  if (boost::apply_visitor(detail::LongTermCacheableVisitor(), data_name))
+    cache_data_store_.Store(data_name, content);
+  else
+    hot_chunk_cache_.Put(data_name, content);
 }
 
 }  // namespace vault
@@ -19,48 +19,110 @@
 #ifndef MAIDSAFE_VAULT_PMID_NODE_HANDLER_H_
 #define MAIDSAFE_VAULT_PMID_NODE_HANDLER_H_
 
+#include <string>
 
+#include "boost/variant/static_visitor.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/types.h"
 #include "maidsafe/data_store/data_store.h"
-#include "maidsafe/data_store/memory_buffer.h"
-#include "maidsafe/data_store/permanent_store.h"
 #include "maidsafe/data_store/data_buffer.h"
 #include "maidsafe/data_types/data_name_variant.h"
+#include "maidsafe/data_types/data_type_values.h"
+
+#include "maidsafe/vault/hot_chunk_cache.h"
+#include "maidsafe/vault/pmid_node/chunk_io_engine.h"
+#include "maidsafe/vault/pmid_node/chunk_view.h"
+#include "maidsafe/vault/pmid_node/segment_store.h"
 
 
 namespace maidsafe {
 namespace vault {
 
+namespace detail {
+
+class CacheableVisitor : public boost::static_visitor<bool> {
+ public:
+  template<typename DataName>
+  result_type operator()(const DataName& /*data_name*/) const {
+    return is_cacheable<typename DataName::data_type>::value;
+  }
+};
+
+class LongTermCacheableVisitor : public boost::static_visitor<bool> {
+ public:
+  template<typename DataName>
+  result_type operator()(const DataName& /*data_name*/) const {
+    return is_long_term_cacheable<typename DataName::data_type>::value;
+  }
+};
+
+// The permanent store's key for a chunk: the name's DataTagValue followed by its raw name.  The
+// tag, unlike the variant's index, doesn't change if DataNameVariant's types are reordered.
+std::string PermanentStoreKey(const DataNameVariant& data_name);
+
+}  // namespace detail
+
 class PmidNodeHandler {
  public:
   PmidNodeHandler(const boost::filesystem::path vault_root_dir);
 
+  // Queues the write and returns immediately.  'on_complete' is invoked on a chunk I/O thread once
+  // the chunk is stored, or with the error if storing failed.  If the chunk won't fit in the space
+  // left for the permanent store, 'on_complete' is invoked immediately with cannot_exceed_limit.
   template<typename Data>
-  void PutToPermanentStore(const Data& data);
+  void PutToPermanentStore(const Data& data, const ChunkIoEngine::CompletionFunctor& on_complete);
 
   template<typename Data>
-  void DeleteFromPermanentStore(const typename Data::name& name);
+  void DeleteFromPermanentStore(const typename Data::Name& name);
+
+  // Served without copying, from the hot chunk cache or the store's mapped segments.  Not yet
+  // called outside tests: PmidNodeService's handler for GetRequestFromDataManagerToPmidNode is
+  // still disabled along with the rest of the DataManager-to-PmidNode GET path.  Until that is
+  // restored, neither this nor the hot chunk cache's read-through serves network GETs.
+  ChunkView GetFromPermanentStore(const DataNameVariant& data_name);
 
   boost::filesystem::path GetPermanentStorePath() const;
 
+  // Long-term cacheable data is cached on disk, other cacheable data in the hot chunk cache.  Both
+  // throw if 'data_name' isn't of a cacheable type; GetFromCache also throws if it isn't cached.
+  NonEmptyString GetFromCache(const DataNameVariant& data_name);
+  void StoreInCache(const DataNameVariant& data_name, const NonEmptyString& content);
+
  private:
   boost::filesystem::space_info space_info_;
   DiskUsage disk_total_;
   DiskUsage permanent_size_;
   DiskUsage cache_size_;
-  data_store::PermanentStore permanent_data_store_;
+  SegmentStore permanent_data_store_;
   data_store::DataStore<data_store::DataBuffer<DataNameVariant>> cache_data_store_;
-  data_store::MemoryBuffer mem_only_cache_;
+  HotChunkCache hot_chunk_cache_;
+  ChunkIoEngine chunk_io_engine_;
 };
 
 template<typename Data>
-void PmidNodeHandler::PutToPermanentStore(const Data& data) {
-  typename Data::Name data_name(GetDataNameVariant(data.name().type, data.name().raw_name));
-  permanent_data_store_.Put(data_name, data.data());
+void PmidNodeHandler::PutToPermanentStore(const Data& data,
+                                          const ChunkIoEngine::CompletionFunctor& on_complete) {
+  DataNameVariant data_name(data.name());
+  uint64_t reserved(SegmentStore::RecordSize(detail::PermanentStoreKey(data_name).size(),
+                                             data.data().string().size()));
+  if (!permanent_data_store_.Reserve(reserved)) {
+    LOG(kWarning) << "Refusing chunk of " << data.data().string().size()
+                  << " bytes: permanent store is full.";
+    on_complete(maidsafe_error(make_error_code(CommonErrors::cannot_exceed_limit)));
+    return;
+  }
+  // The engine's write functor hands the reservation to Put, so it only needs releasing here if the
+  // chunk is never written.
+  if (!chunk_io_engine_.Submit(data_name, data.data(), on_complete))
+    permanent_data_store_.Release(reserved);
 }
 
 template<typename Data>
-void PmidNodeHandler::DeleteFromPermanentStore(const typename Data::name& name) {
-  permanent_data_store_.Delete(name);
+void PmidNodeHandler::DeleteFromPermanentStore(const typename Data::Name& name) {
+  permanent_data_store_.Delete(detail::PermanentStoreKey(name));
+  hot_chunk_cache_.Erase(name);
 }
 
 }  // namespace vault
@@ -0,0 +1,474 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/pmid_node/segment_store.h"
+
+#ifdef MAIDSAFE_WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/interprocess/exceptions.hpp"
+#include "boost/interprocess/file_mapping.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace {
+
+const uint32_t kRecordMagic(0x4D534731);
+const uint32_t kPutRecord(0), kTombstoneRecord(1);
+const std::string kSegmentPrefix("segment_"), kSegmentExtension(".log");
+
+struct RecordHeader {
+  uint32_t magic, type, key_size, content_size;
+};
+
+void Seek(std::FILE* file, uint64_t offset) {
+  if (std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0)  // NOLINT (long)
+    ThrowError(CommonErrors::filesystem_io_error);
+}
+
+void Write(std::FILE* file, const void* data, size_t size) {
+  if (std::fwrite(data, 1, size, file) != size)
+    ThrowError(CommonErrors::filesystem_io_error);
+}
+
+bool Read(std::FILE* file, void* data, size_t size) {
+  return size == 0 || std::fread(data, 1, size, file) == size;
+}
+
+void FlushToDisk(std::FILE* file) {
+  if (std::fflush(file) != 0)
+    ThrowError(CommonErrors::filesystem_io_error);
+#ifdef MAIDSAFE_WIN32
+  if (_commit(_fileno(file)) != 0)
+#else
+  if (fsync(fileno(file)) != 0)
+#endif
+    ThrowError(CommonErrors::filesystem_io_error);
+}
+
+// Returns a new descriptor for the file's stdio buffer, which has been flushed to the OS.
+int FlushAndDuplicate(std::FILE* file) {
+  if (std::fflush(file) != 0)
+    ThrowError(CommonErrors::filesystem_io_error);
+#ifdef MAIDSAFE_WIN32
+  int descriptor(_dup(_fileno(file)));
+#else
+  int descriptor(dup(fileno(file)));
+#endif
+  if (descriptor == -1)
+    ThrowError(CommonErrors::filesystem_io_error);
+  return descriptor;
+}
+
+// Syncs and then closes a descriptor returned by FlushAndDuplicate.
+void SyncAndClose(int descriptor) {
+#ifdef MAIDSAFE_WIN32
+  bool synced(_commit(descriptor) == 0);
+  _close(descriptor);
+#else
+  bool synced(fsync(descriptor) == 0);
+  close(descriptor);
+#endif
+  if (!synced)
+    ThrowError(CommonErrors::filesystem_io_error);
+}
+
+}  // unnamed namespace
+
+uint64_t SegmentStore::RecordSize(size_t key_size, size_t content_size) {
+  return sizeof(RecordHeader) + key_size + content_size;
+}
+
+SegmentStore::SegmentStore(const fs::path& directory,
+                           DiskUsage max_disk_usage,
+                           uint64_t max_segment_bytes,
+                           double compaction_garbage_ratio)
+    : kDirectory_(directory),
+      kMaxSegmentBytes_(max_segment_bytes),
+      kCompactionGarbageRatio_(compaction_garbage_ratio),
+      kMaxDiskUsage_(max_disk_usage.data),
+      compaction_mutex_(),
+      mutex_(),
+      compactor_condition_(),
+      segments_(),
+      current_segment_(0),
+      index_(),
+      live_bytes_(0),
+      disk_usage_(0),
+      reserved_(0),
+      compaction_due_(false),
+      stopped_(false),
+      compactions_(0),
+      compactor_thread_() {
+  Recover();
+  compactor_thread_ = std::thread([this] { RunCompactor(); });
+}
+
+SegmentStore::~SegmentStore() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  compactor_condition_.notify_one();
+  compactor_thread_.join();
+  try {
+    Sync();
+  } catch(const std::exception& e) {
+    LOG(kError) << "Failed to sync " << SegmentPath(current_segment_) << ": " << e.what();
+  }
+}
+
+fs::path SegmentStore::SegmentPath(uint32_t segment_id) const {
+  std::string id(std::to_string(segment_id));
+  return kDirectory_ / (kSegmentPrefix + std::string(10 - std::min(id.size(), size_t(10)), '0') +
+                        id + kSegmentExtension);
+}
+
+void SegmentStore::Recover() {
+  fs::create_directories(kDirectory_);
+  std::vector<uint32_t> segment_ids;
+  for (fs::directory_iterator itr(kDirectory_); itr != fs::directory_iterator(); ++itr) {
+    std::string file_name(itr->path().filename().string());
+    if (file_name.size() > kSegmentPrefix.size() + kSegmentExtension.size() &&
+        file_name.compare(0, kSegmentPrefix.size(), kSegmentPrefix) == 0 &&
+        itr->path().extension().string() == kSegmentExtension) {
+      segment_ids.push_back(static_cast<uint32_t>(std::stoul(
+          file_name.substr(kSegmentPrefix.size(),
+                           file_name.size() - kSegmentPrefix.size() - kSegmentExtension.size()))));
+    }
+  }
+  std::sort(std::begin(segment_ids), std::end(segment_ids));
+
+  if (segment_ids.empty()) {
+    segments_[current_segment_].file.reset(
+        std::fopen(SegmentPath(current_segment_).string().c_str(), "w+b"));
+    if (!segments_[current_segment_].file)
+      ThrowError(CommonErrors::filesystem_io_error);
+    return;
+  }
+  current_segment_ = segment_ids.back();
+  for (auto segment_id : segment_ids)
+    RecoverSegment(segment_id, segment_id == current_segment_);
+}
+
+void SegmentStore::RecoverSegment(uint32_t segment_id, bool is_last) {
+  auto path(SegmentPath(segment_id));
+  auto& segment(segments_[segment_id]);
+  segment.file.reset(std::fopen(path.string().c_str(), "r+b"));
+  if (!segment.file)
+    ThrowError(CommonErrors::filesystem_io_error);
+  uint64_t file_size(fs::file_size(path)), offset(0);
+  RecordHeader header;
+  while (offset + sizeof(header) <= file_size) {
+    Seek(segment.file.get(), offset);
+    if (!Read(segment.file.get(), &header, sizeof(header)) || header.magic != kRecordMagic ||
+        header.type > kTombstoneRecord ||
+        offset + RecordSize(header.key_size, header.content_size) > file_size) {
+      break;
+    }
+    std::string key(header.key_size, '\0');
+    if (!Read(segment.file.get(), &key[0], key.size()))
+      break;
+
+    auto itr(index_.find(key));
+    if (itr != std::end(index_)) {
+      AddGarbage(itr->second, header.key_size);
+      live_bytes_ -= itr->second.content_size;
+    }
+    if (header.type == kPutRecord) {
+      index_[key] = Location(segment_id, offset, header.content_size);
+      live_bytes_ += header.content_size;
+    } else {
+      if (itr != std::end(index_))
+        index_.erase(itr);
+      segment.garbage += RecordSize(header.key_size, 0);
+    }
+    offset += RecordSize(header.key_size, header.content_size);
+  }
+  segment.size = offset;
+  disk_usage_ += offset;
+
+  if (offset != file_size) {
+    // Anything after the last whole record is ignored.  In the last segment, it's a write torn by a
+    // crash, and is truncated so that new records follow on from the last whole one.
+    LOG(kWarning) << "Ignoring " << file_size - offset << " trailing bytes in " << path;
+    if (is_last) {
+      segment.file.reset();
+      fs::resize_file(path, offset);
+      segment.file.reset(std::fopen(path.string().c_str(), "r+b"));
+      if (!segment.file)
+        ThrowError(CommonErrors::filesystem_io_error);
+    }
+  }
+}
+
+bool SegmentStore::Reserve(uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (disk_usage_ + reserved_ + bytes > kMaxDiskUsage_)
+    return false;
+  reserved_ += bytes;
+  return true;
+}
+
+void SegmentStore::Release(uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  reserved_ -= std::min(bytes, reserved_);
+}
+
+void SegmentStore::Put(const std::string& key, const NonEmptyString& content,
+                       uint64_t reserved) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Append adds the record to disk_usage_ before the lock is released, so the space is never
+  // counted twice.
+  reserved_ -= std::min(reserved, reserved_);
+  auto location(Append(key, &content));
+  auto itr(index_.find(key));
+  if (itr != std::end(index_)) {
+    AddGarbage(itr->second, static_cast<uint32_t>(key.size()));
+    live_bytes_ -= itr->second.content_size;
+    itr->second = location;
+  } else {
+    index_.insert(std::make_pair(key, location));
+  }
+  live_bytes_ += location.content_size;
+}
+
+NonEmptyString SegmentStore::Get(const std::string& key) {
+  return GetView(key).ToNonEmptyString();
+}
+
+ChunkView SegmentStore::GetView(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(index_.find(key));
+  if (itr == std::end(index_))
+    ThrowError(CommonErrors::no_such_element);
+  auto& segment(segments_.at(itr->second.segment));
+  uint64_t content_offset(itr->second.offset + RecordSize(key.size(), 0));
+  if (itr->second.segment != current_segment_) {
+    if (!segment.mapping) {
+      try {
+        boost::interprocess::file_mapping file_mapping(
+            SegmentPath(itr->second.segment).string().c_str(), boost::interprocess::read_only);
+        segment.mapping = std::make_shared<boost::interprocess::mapped_region>(
+            file_mapping, boost::interprocess::read_only);
+      } catch(const boost::interprocess::interprocess_exception& e) {
+        LOG(kError) << "Failed to map " << SegmentPath(itr->second.segment) << ": " << e.what();
+        ThrowError(CommonErrors::filesystem_io_error);
+      }
+    }
+    return ChunkView(segment.mapping,
+                     static_cast<const char*>(segment.mapping->get_address()) + content_offset,
+                     itr->second.content_size);
+  }
+
+  // The current segment is still being appended to, so its chunks are read into memory.
+  std::string content(itr->second.content_size, '\0');
+  Seek(segment.file.get(), content_offset);
+  if (!Read(segment.file.get(), &content[0], content.size()))
+    ThrowError(CommonErrors::filesystem_io_error);
+  return ChunkView(std::make_shared<const NonEmptyString>(content));
+}
+
+void SegmentStore::Delete(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(index_.find(key));
+  if (itr == std::end(index_))
+    ThrowError(CommonErrors::no_such_element);
+  auto tombstone(Append(key, nullptr));
+  segments_.at(tombstone.segment).garbage += RecordSize(key.size(), 0);
+  AddGarbage(itr->second, static_cast<uint32_t>(key.size()));
+  live_bytes_ -= itr->second.content_size;
+  index_.erase(itr);
+}
+
+void SegmentStore::Sync() {
+  // Only the stdio buffer is flushed under 'mutex_', so writers aren't held up by the fsync.  That
+  // runs on a duplicate descriptor, which stays valid even if the segment is sealed, compacted and
+  // closed meanwhile.
+  int descriptor(-1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    descriptor = FlushAndDuplicate(segments_.at(current_segment_).file.get());
+  }
+  SyncAndClose(descriptor);
+}
+
+SegmentStore::Location SegmentStore::Append(const std::string& key,
+                                            const NonEmptyString* content) {
+  RecordHeader header = { kRecordMagic, content ? kPutRecord : kTombstoneRecord,
+                          static_cast<uint32_t>(key.size()),
+                          content ? static_cast<uint32_t>(content->string().size()) : 0 };
+  uint64_t record_size(RecordSize(key.size(), header.content_size));
+  Segment* segment(&segments_.at(current_segment_));
+  if (segment->size != 0 && segment->size + record_size > kMaxSegmentBytes_) {
+    // Seal the current segment.
+    FlushToDisk(segment->file.get());
+    File file(std::fopen(SegmentPath(current_segment_ + 1).string().c_str(), "w+b"));
+    if (!file)
+      ThrowError(CommonErrors::filesystem_io_error);
+    uint32_t sealed_segment(current_segment_++);
+    segment = &segments_[current_segment_];
+    segment->file = std::move(file);
+    const auto& sealed(segments_.at(sealed_segment));
+    if (sealed.garbage >= kCompactionGarbageRatio_ * sealed.size) {
+      compaction_due_ = true;
+      compactor_condition_.notify_one();
+    }
+  }
+
+  // A failed write leaves 'segment->size' unchanged, so the next record overwrites any part of it.
+  Seek(segment->file.get(), segment->size);
+  Write(segment->file.get(), &header, sizeof(header));
+  Write(segment->file.get(), key.data(), key.size());
+  if (content)
+    Write(segment->file.get(), content->string().data(), header.content_size);
+  Location location(current_segment_, segment->size, header.content_size);
+  segment->size += record_size;
+  disk_usage_ += record_size;
+  return location;
+}
+
+void SegmentStore::AddGarbage(const Location& location, uint32_t key_size) {
+  auto& segment(segments_.at(location.segment));
+  segment.garbage += RecordSize(key_size, location.content_size);
+  if (location.segment != current_segment_ &&
+      segment.garbage >= kCompactionGarbageRatio_ * segment.size) {
+    compaction_due_ = true;
+    compactor_condition_.notify_one();
+  }
+}
+
+void SegmentStore::Compact() {
+  std::lock_guard<std::mutex> compaction_lock(compaction_mutex_);
+  std::vector<uint32_t> due_segments;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    compaction_due_ = false;
+    for (const auto& segment : segments_) {
+      if (segment.first != current_segment_ &&
+          segment.second.garbage >= kCompactionGarbageRatio_ * segment.second.size) {
+        due_segments.push_back(segment.first);
+      }
+    }
+  }
+  for (auto segment_id : due_segments)
+    CompactSegment(segment_id);
+}
+
+void SegmentStore::CompactSegment(uint32_t segment_id) {
+  // The segment is sealed, so it's read through a separate handle without holding 'mutex_'.
+  auto path(SegmentPath(segment_id));
+  File file(std::fopen(path.string().c_str(), "rb"));
+  if (!file)
+    ThrowError(CommonErrors::filesystem_io_error);
+  uint64_t size(0), offset(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size = segments_.at(segment_id).size;
+  }
+
+  RecordHeader header;
+  while (offset < size) {
+    if (!Read(file.get(), &header, sizeof(header)))
+      ThrowError(CommonErrors::filesystem_io_error);
+    std::string key(header.key_size, '\0'), content(header.content_size, '\0');
+    if (!Read(file.get(), &key[0], key.size()) || !Read(file.get(), &content[0], content.size()))
+      ThrowError(CommonErrors::filesystem_io_error);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header.type == kPutRecord) {
+      // Only copy the record if it's still the live one for its key.
+      auto itr(index_.find(key));
+      if (itr != std::end(index_) && itr->second.segment == segment_id &&
+          itr->second.offset == offset) {
+        NonEmptyString live_content(content);
+        itr->second = Append(key, &live_content);
+      }
+    } else if (segments_.begin()->first < segment_id && index_.find(key) == std::end(index_)) {
+      // A tombstone must be kept while an older segment might hold a record it deletes, unless the
+      // key has since been put again: the copied tombstone would follow, and so delete, that put.
+      auto tombstone(Append(key, nullptr));
+      segments_.at(tombstone.segment).garbage += RecordSize(key.size(), 0);
+    }
+    offset += RecordSize(header.key_size, header.content_size);
+  }
+
+  {
+    // The copies must be durable before the originals are removed.
+    std::lock_guard<std::mutex> lock(mutex_);
+    FlushToDisk(segments_.at(current_segment_).file.get());
+    disk_usage_ -= segments_.at(segment_id).size;
+    segments_.erase(segment_id);
+    ++compactions_;
+  }
+  file.reset();
+  boost::system::error_code error_code;
+  fs::remove(path, error_code);
+  if (error_code)
+    LOG(kWarning) << "Failed to remove compacted segment " << path << ": " << error_code.message();
+}
+
+void SegmentStore::RunCompactor() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    compactor_condition_.wait(lock, [this] { return stopped_ || compaction_due_; });
+    if (stopped_)
+      return;
+    lock.unlock();
+    try {
+      Compact();
+    } catch(const std::exception& e) {
+      LOG(kError) << "Segment compaction failed: " << e.what();
+    }
+    lock.lock();
+  }
+}
+
+SegmentStore::Stats SegmentStore::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.segments = segments_.size();
+  stats.live_count = index_.size();
+  stats.live_bytes = live_bytes_;
+  for (const auto& segment : segments_)
+    stats.garbage_bytes += segment.second.garbage;
+  stats.compactions = compactions_;
+  stats.disk_usage = disk_usage_;
+  stats.reserved = reserved_;
+  return stats;
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -0,0 +1,157 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_PMID_NODE_SEGMENT_STORE_H_
+#define MAIDSAFE_VAULT_PMID_NODE_SEGMENT_STORE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "boost/filesystem/path.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/vault/parameters.h"
+#include "maidsafe/vault/pmid_node/chunk_view.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+// Stores chunks by appending them to a sequence of large segment files in 'directory', rather than
+// as one file per chunk.  An in-memory index maps each key to its record's location and is rebuilt
+// by scanning the segments on construction; a torn record at the end of the last segment is
+// truncated.  Deletes append a tombstone.  Once a full ("sealed") segment's dead records make up
+// 'compaction_garbage_ratio' of it, a background thread copies its live records to the current
+// segment and removes it.  Writes are only durable once Sync has been called.  Sealed segments are
+// memory-mapped on first read, so their chunks can be viewed without being copied.
+//
+// The segments' total size is tracked as records are appended and segments compacted away.  Room
+// for a PUT is reserved before its content is handed over, so a chunk which won't fit within
+// 'max_disk_usage' is refused up front, and Put turns that reservation into usage as it appends
+// the record.  Put itself doesn't check the limit, and neither deletes nor compaction are limited,
+// so that space can always be reclaimed.
+class SegmentStore {
+ public:
+  struct Stats {
+    Stats()
+        : segments(0), live_count(0), live_bytes(0), garbage_bytes(0), compactions(0),
+          disk_usage(0), reserved(0) {}
+    uint64_t segments, live_count, live_bytes, garbage_bytes, compactions, disk_usage, reserved;
+  };
+
+  // The bytes a record for 'key' and 'content_size' bytes of content occupies on disk.
+  static uint64_t RecordSize(size_t key_size, size_t content_size);
+
+  SegmentStore(
+      const boost::filesystem::path& directory,
+      DiskUsage max_disk_usage,
+      uint64_t max_segment_bytes = detail::Parameters::segment_store_max_segment_bytes,
+      double compaction_garbage_ratio = detail::Parameters::segment_store_compaction_garbage_ratio);
+  ~SegmentStore();
+
+  // Returns false if 'bytes' more would take the store over its limit.  Every successful Reserve
+  // must be handed to the Put it was for, or matched by a Release if that Put is never attempted.
+  bool Reserve(uint64_t bytes);
+  void Release(uint64_t bytes);
+  // Releases 'reserved' bytes of reservation, whether or not the record is appended.
+  void Put(const std::string& key, const NonEmptyString& content, uint64_t reserved = 0);
+  // All three throw if 'key' isn't stored.  GetView only copies chunks in the current segment.
+  NonEmptyString Get(const std::string& key);
+  ChunkView GetView(const std::string& key);
+  void Delete(const std::string& key);
+  // Flushes the current segment to disk.
+  void Sync();
+  // Compacts all sealed segments over the garbage threshold now, rather than waiting for the
+  // background thread.
+  void Compact();
+  boost::filesystem::path directory() const { return kDirectory_; }
+  Stats stats();
+
+ private:
+  struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+  };
+  typedef std::unique_ptr<std::FILE, FileCloser> File;
+
+  struct Segment {
+    Segment() : file(), mapping(), size(0), garbage(0) {}
+    File file;
+    // Only set once the segment is sealed and read from.
+    std::shared_ptr<const boost::interprocess::mapped_region> mapping;
+    uint64_t size, garbage;
+  };
+
+  struct Location {
+    Location() : segment(0), offset(0), content_size(0) {}
+    Location(uint32_t segment_in, uint64_t offset_in, uint32_t content_size_in)
+        : segment(segment_in), offset(offset_in), content_size(content_size_in) {}
+    uint32_t segment;
+    // Offset of the record's header within the segment.
+    uint64_t offset;
+    uint32_t content_size;
+  };
+
+  SegmentStore(const SegmentStore&);
+  SegmentStore& operator=(const SegmentStore&);
+  SegmentStore(SegmentStore&&);
+  SegmentStore& operator=(SegmentStore&&);
+
+  boost::filesystem::path SegmentPath(uint32_t segment_id) const;
+  void Recover();
+  void RecoverSegment(uint32_t segment_id, bool is_last);
+  // Appends a record (a tombstone if 'content' is null) to the current segment, starting a new one
+  // first if it's full.  Must be called with 'mutex_' held.
+  Location Append(const std::string& key, const NonEmptyString* content);
+  // Accounts for the record at 'location' being superseded, and wakes the compactor if that takes
+  // a sealed segment over the threshold.  Must be called with 'mutex_' held.
+  void AddGarbage(const Location& location, uint32_t key_size);
+  void CompactSegment(uint32_t segment_id);
+  void RunCompactor();
+
+  const boost::filesystem::path kDirectory_;
+  const uint64_t kMaxSegmentBytes_;
+  const double kCompactionGarbageRatio_;
+  const uint64_t kMaxDiskUsage_;
+  // Serialises compactions.  Never acquired while 'mutex_' is held.
+  std::mutex compaction_mutex_;
+  std::mutex mutex_;
+  std::condition_variable compactor_condition_;
+  std::map<uint32_t, Segment> segments_;
+  uint32_t current_segment_;
+  std::unordered_map<std::string, Location> index_;
+  uint64_t live_bytes_, disk_usage_, reserved_;
+  bool compaction_due_, stopped_;
+  uint64_t compactions_;
+  std::thread compactor_thread_;
+};
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_PMID_NODE_SEGMENT_STORE_H_
@@ -56,9 +56,11 @@ inline bool ForThisPersona(const Message& message) {
 
 PmidNodeService::PmidNodeService(const passport::Pmid& /*pmid*/,
                                  routing::Routing& routing,
-                                 const fs::path& vault_root_dir)
+                                 const fs::path& vault_root_dir,
+                                 const AccumulatorPolicy& accumulator_policy)
     : routing_(routing),
       accumulator_mutex_(),
+      accumulator_(accumulator_policy),
       dispatcher_(routing_),
       handler_(vault_root_dir),
       active_(),
@@ -83,6 +85,36 @@ void PmidNodeService::HandleMessage(
       accumulator_mutex_)(message, sender, receiver);
 }
 
+template<>
+bool PmidNodeService::GetFromCache<nfs::GetRequestFromMaidNodeToDataManager>(
+    const nfs::GetRequestFromMaidNodeToDataManager& message,
+    const typename nfs::GetRequestFromMaidNodeToDataManager::Sender& sender,
+    const typename nfs::GetRequestFromMaidNodeToDataManager::Receiver& /*receiver*/) {
+  return DoGetFromCache(message, sender);
+}
+
+template<>
+bool PmidNodeService::GetFromCache<nfs::GetRequestFromPmidNodeToDataManager>(
+    const nfs::GetRequestFromPmidNodeToDataManager& message,
+    const typename nfs::GetRequestFromPmidNodeToDataManager::Sender& sender,
+    const typename nfs::GetRequestFromPmidNodeToDataManager::Receiver& /*receiver*/) {
+  return DoGetFromCache(message, sender);
+}
+
+template<>
+void PmidNodeService::StoreInCache<nfs::GetResponseFromDataManagerToMaidNode>(
+    const nfs::GetResponseFromDataManagerToMaidNode& message,
+    const typename nfs::GetResponseFromDataManagerToMaidNode::Sender& /*sender*/,
+    const typename nfs::GetResponseFromDataManagerToMaidNode::Receiver& /*receiver*/) {
+  if (!message.contents->data)
+    return;
+  try {
+    handler_.StoreInCache(GetDataNameVariant(message.contents->data->name.type,
+                                             message.contents->data->name.raw_name),
+                          message.contents->data->content);
+  } catch(const maidsafe_error& /*error*/) {}  // Not a cacheable type
+}
+
 template<>
 void PmidNodeService::HandleMessage(
     const nfs::GetPmidAccountResponseFromPmidManagerToPmidNode& /*message*/,
@@ -128,22 +128,6 @@ class GetCallerVisitor : public boost::static_visitor<> {
   DataStoreFunctor store_functor_;
 };
 
-class LongTermCacheableVisitor : public boost::static_visitor<bool> {
-  public:
-   template<typename Data>
-   void operator()() {
-     return is_long_term_cacheable<Data>::value;
-   }
-};
-
-class CacheableVisitor : public boost::static_visitor<bool> {
-  public:
-   template<typename Data>
-   void operator()() {
-     return is_cacheable<Data>::value;
-   }
-};
-
 }  // noname namespace
 
 class PmidNodeService {
@@ -155,35 +139,32 @@ class PmidNodeService {
 
   PmidNodeService(const passport::Pmid& pmid,
                   routing::Routing& routing,
-                  const boost::filesystem::path& vault_root_dir);
+                  const boost::filesystem::path& vault_root_dir,
+                  const AccumulatorPolicy& accumulator_policy = AccumulatorPolicy());
 
   template<typename T>
   void HandleMessage(const T& message,
                      const typename T::Sender& sender,
                      const typename T::Receiver& receiver);
 
+  // Called on routing's thread for messages passing through this node.  Only the specialisations
+  // defined below serve from or populate the cache; other messages aren't cacheable.
   template<typename T>
   bool GetFromCache(const T& /*message*/,
                     const typename T::Sender& /*sender*/,
                     const typename T::Receiver& /*receiver*/) {
-    T::invalid_message_type_passed::should_be_one_of_the_specialisations_defined_below;
     return false;
   }
 
   template<typename T>
   void StoreInCache(const T& /*message*/,
                     const typename T::Sender& /*sender*/,
-                    const typename T::Receiver& /*receiver*/) {
-    T::invalid_message_type_passed::should_be_one_of_the_specialisations_defined_below;
-  }
+                    const typename T::Receiver& /*receiver*/) {}
 
   template<typename Data>
   friend class test::DataHolderTest;
 
  private:
-  typedef std::true_type IsCacheable, IsLongTermCacheable;
-  typedef std::false_type IsNotCacheable, IsShortTermCacheable;
-
 // ================================ Pmid Account ===============================================
   void SendAccountRequest();
 
@@ -213,33 +194,12 @@ class PmidNodeService {
 
 // ===================================Cache=====================================================
   template<typename T>
-  bool DoGetFromCache(const T& message,
-                      const typename T::Sender& sender,
-                      const typename T::Receiver& receiver);
-
-  template<typename T>
-  bool CacheGet(const T& message,
-                const typename T::Sender& sender,
-                const typename T::Receiver& receiver,
-                IsShortTermCacheable);
-
-  template<typename T>
-  bool CacheGet(const T& message,
-                const typename T::Sender& sender,
-                const typename T::Receiver& receiver,
-                IsLongTermCacheable);
-
-  template<typename T>
-  void CacheStore(const T& message, const DataNameVariant& data_name, IsShortTermCacheable);
-
-  template<typename T>
-  void CacheStore(const T& message, const DataNameVariant& data_name, IsLongTermCacheable);
+  bool DoGetFromCache(const T& message, const typename T::Sender& sender);
 
   template <typename T>
   void SendCachedData(const T& message,
                       const typename T::Sender& sender,
-                      const typename T::Receiver& receiver,
-                      const std::shared_ptr<NonEmptyString> content);
+                      const NonEmptyString& content);
 
   routing::Routing& routing_;
   std::mutex accumulator_mutex_;
@@ -277,23 +237,23 @@ void PmidNodeService::HandleMessage(
 //    const typename nfs::GetPmidAccountResponseFromPmidManagerToPmidNode::Sender& sender,
 //    const typename nfs::GetPmidAccountResponseFromPmidManagerToPmidNode::Receiver& receiver);
 
-//template<>
-//bool PmidNodeService::GetFromCache<nfs::GetRequestFromMaidNodeToDataManager>(
-//    const nfs::GetRequestFromMaidNodeToDataManager& message,
-//    const typename nfs::GetRequestFromMaidNodeToDataManager::Sender& sender,
-//    const typename nfs::GetRequestFromMaidNodeToDataManager::Receiver& receiver);
+template<>
+bool PmidNodeService::GetFromCache<nfs::GetRequestFromMaidNodeToDataManager>(
+    const nfs::GetRequestFromMaidNodeToDataManager& message,
+    const typename nfs::GetRequestFromMaidNodeToDataManager::Sender& sender,
+    const typename nfs::GetRequestFromMaidNodeToDataManager::Receiver& receiver);
 
-//template<>
-//bool PmidNodeService::GetFromCache<nfs::GetRequestFromPmidNodeToDataManager>(
-//    const nfs::GetRequestFromPmidNodeToDataManager& message,
-//    const typename nfs::GetRequestFromPmidNodeToDataManager::Sender& sender,
-//    const typename nfs::GetRequestFromPmidNodeToDataManager::Receiver& receiver);
+template<>
+bool PmidNodeService::GetFromCache<nfs::GetRequestFromPmidNodeToDataManager>(
+    const nfs::GetRequestFromPmidNodeToDataManager& message,
+    const typename nfs::GetRequestFromPmidNodeToDataManager::Sender& sender,
+    const typename nfs::GetRequestFromPmidNodeToDataManager::Receiver& receiver);
 
-//template<>
-//void PmidNodeService::StoreInCache<nfs::GetResponseFromDataManagerToMaidNode>(
-//    const nfs::GetResponseFromDataManagerToMaidNode& message,
-//    const typename nfs::GetResponseFromDataManagerToMaidNode::Sender& sender,
-//    const typename nfs::GetResponseFromDataManagerToMaidNode::Receiver& receiver);
+template<>
+void PmidNodeService::StoreInCache<nfs::GetResponseFromDataManagerToMaidNode>(
+    const nfs::GetResponseFromDataManagerToMaidNode& message,
+    const typename nfs::GetResponseFromDataManagerToMaidNode::Sender& sender,
+    const typename nfs::GetResponseFromDataManagerToMaidNode::Receiver& receiver);
 
 
 // ============================== Put implementation =============================================
@@ -306,12 +266,9 @@ void PmidNodeService::HandleMessage(const T& /*message*/,
 
 template<typename Data>
 void PmidNodeService::HandlePut(const Data& data, const nfs::MessageId& message_id) {
-  try {
-    handler_.PutToPermanentStore(data);
-    dispatcher_.SendPutRespnse(data, message_id, make_error_code(CommonErrors::success));
-  } catch(const maidsafe_error& error) {
-    dispatcher_.SendPutRespnse(data, message_id, error);
-  }
+  handler_.PutToPermanentStore(data, [this, data, message_id](const maidsafe_error& error) {
+                                       dispatcher_.SendPutRespnse(data, message_id, error);
+                                     });
 }
 
 //template<>
@@ -407,111 +364,34 @@ void PmidNodeService::HandleDelete(const typename Data::Name& name,
 }
 
 
-//template<>
-//bool PmidNodeService::GetFromCache<nfs::GetRequestFromMaidNodeToDataManager>(
-//    const nfs::GetRequestFromMaidNodeToDataManager& message,
-//    const typename nfs::GetRequestFromMaidNodeToDataManager::Sender& sender,
-//    const typename nfs::GetRequestFromMaidNodeToDataManager::Receiver& receiver) {
-//  return DoGetFromCache(message, sender, receiver);
-//}
-
-//template<>
-//bool PmidNodeService::GetFromCache<nfs::GetRequestFromPmidNodeToDataManager>(
-//    const nfs::GetRequestFromPmidNodeToDataManager& message,
-//    const typename nfs::GetRequestFromPmidNodeToDataManager::Sender& sender,
-//    const typename nfs::GetRequestFromPmidNodeToDataManager::Receiver& receiver) {
-//  return DoGetFromCache(message, sender, receiver);
-//}
-
-//template<typename T>
-//bool PmidNodeService::DoGetFromCache(const T& message,
-//                                     const typename T::Sender& sender,
-//                                     const typename T::Receiver& receiver) {
-//  auto data_name(GetDataNameVariant(message.contents->type, message.contents->raw_name));
-//  if (!boost::apply_visitor(CacheableVisitor(), data_name))
-//    return false;
-//  if (boost::apply_visitor(LongTermCacheableVisitor(), data_name))
-//    return CacheGet(message, sender, receiver, IsLongTermCacheable());
-//  return CacheGet(message, sender, receiver, IsShortTermCacheable());
-//}
-
-//template<typename T>
-//bool PmidNodeService::CacheGet(const T& message,
-//                               const typename T::Sender& sender,
-//                               const typename T::Receiver& receiver,
-//                               IsShortTermCacheable) {
-//  try {
-//    auto content(std::make_shared<NonEmptyString>(handler_.mem_only_cache_.Get(*message.contents)));
-//    active_.Send([=]() {
-//                   SendCachedData(message, sender, receiver, content);
-//                 });
-//  } catch(maidsafe_error& /*error*/) {
-//    return false;
-//  }
-//  return true;
-//}
-
-//template<typename T>
-//bool PmidNodeService::CacheGet(const T& message,
-//                               const typename T::Sender& sender,
-//                               const typename T::Receiver& receiver,
-//                               IsLongTermCacheable) {
-//  try {
-//    auto content(std::make_shared<NonEmptyString>(handler_.cache_data_store_.Get(*message.contents)));
-//    active_.Send([=]() {
-//                   SendCachedData(message, sender, receiver, content);
-//                 });
-//  } catch(maidsafe_error& /*error*/) {
-//    return false;
-//  }
-//  return true;
-//}
-
-//template<>
-//void PmidNodeService::StoreInCache<nfs::GetResponseFromDataManagerToMaidNode>(
-//    const nfs::GetResponseFromDataManagerToMaidNode& message,
-//    const typename nfs::GetResponseFromDataManagerToMaidNode::Sender& /*sender*/,
-//    const typename nfs::GetResponseFromDataManagerToMaidNode::Receiver& /*receiver*/) {
-//  auto data_name(GetDataNameVariant(message.contents->data->name.type,
-//                                    message.contents->data->name.raw_name));
-//  if (!boost::apply_visitor(CacheableVisitor(), data_name))
-//    return;
-//  if (boost::apply_visitor(LongTermCacheableVisitor(), data_name))
-//    CacheStore(message, data_name, IsLongTermCacheable());
-//  else
-//    CacheStore(message, data_name, IsShortTermCacheable());
-//}
-
-//template<typename T>
-//void PmidNodeService::CacheStore(const T& message,
-//                                 const DataNameVariant& data_name,
-//                                 IsShortTermCacheable) {
-//  handler_.mem_only_cache_.Store(data_name, message.contents->data->content);
-//}
-
-//template<typename T>
-//void PmidNodeService::CacheStore(const T& message,
-//                                 const DataNameVariant& name,
-//                                 IsLongTermCacheable) {
-//  handler_.cache_data_store_.Store(name, message.contents->data->content);
-//}
+template<typename T>
+bool PmidNodeService::DoGetFromCache(const T& message, const typename T::Sender& sender) {
+  // The cached content is sent back as stored; it's never parsed into a Data object.
+  try {
+    auto content(std::make_shared<NonEmptyString>(handler_.GetFromCache(
+        GetDataNameVariant(message.contents->type, message.contents->raw_name))));
+    active_.Send([=]() { SendCachedData(message, sender, *content); });
+  } catch(const maidsafe_error& /*error*/) {
+    return false;
+  }
+  return true;
+}
 
-//template <typename T>
-//void PmidNodeService::SendCachedData(const T& message,
-//                                     const typename T::Sender& sender,
-//                                     const typename T::Receiver& /*receiver*/,
-//                                     const std::shared_ptr<NonEmptyString> content) {
-//  typedef nfs::GetCachedResponseFromPmidNodeToMaidNode NfsMessage;
-//  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
-//  NfsMessage nfs_message(nfs_client::DataNameAndContentOrReturnCode(
-//      nfs_vault::DataNameAndContent(DataTagValue(message.contents->type),
-//                                    message.contents->raw_name,
-//                                    *content)));
-//  RoutingMessage routing_message(nfs_message.Serialise(),
-//                                 NfsMessage::Sender(routing::SingleId(routing_.kNodeId())),
-//                                 NfsMessage::Receiver(sender));
-//  routing_.Send(routing_message);
-//}
+template <typename T>
+void PmidNodeService::SendCachedData(const T& message,
+                                     const typename T::Sender& sender,
+                                     const NonEmptyString& content) {
+  typedef nfs::GetCachedResponseFromPmidNodeToMaidNode NfsMessage;
+  typedef routing::Message<NfsMessage::Sender, NfsMessage::Receiver> RoutingMessage;
+  NfsMessage nfs_message(nfs_client::DataNameAndContentOrReturnCode(
+      nfs_vault::DataNameAndContent(DataTagValue(message.contents->type),
+                                    message.contents->raw_name,
+                                    content)));
+  RoutingMessage routing_message(nfs_message.Serialise(),
+                                 NfsMessage::Sender(routing::SingleId(routing_.kNodeId())),
+                                 NfsMessage::Receiver(sender));
+  routing_.Send(routing_message);
+}
 
 // Commented by Mahmoud on 15 Sep. MUST BE FIXED
 //template<>
@@ -0,0 +1,80 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/striped_mutex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+
+namespace maidsafe {
+
+namespace vault {
+
+StripedMutex::StripedMutex(size_t stripe_count) : mutexes_() {
+  assert(stripe_count != 0);
+  for (size_t i(0); i != std::max(stripe_count, static_cast<size_t>(1)); ++i)
+    mutexes_.push_back(std::unique_ptr<std::mutex>(new std::mutex));
+}
+
+std::mutex& StripedMutex::Stripe(const std::string& key) {
+  return *mutexes_[Index(leveldb::Slice(key))];
+}
+
+std::mutex& StripedMutex::Stripe(const leveldb::Slice& key) {
+  return *mutexes_[Index(key)];
+}
+
+StripedMutex::Locks StripedMutex::Lock(const std::vector<std::string>& keys) {
+  return Lock(std::vector<leveldb::Slice>(std::begin(keys), std::end(keys)));
+}
+
+StripedMutex::Locks StripedMutex::Lock(const std::vector<leveldb::Slice>& keys) {
+  std::vector<size_t> indices;
+  indices.reserve(keys.size());
+  for (const auto& key : keys)
+    indices.push_back(Index(key));
+  std::sort(std::begin(indices), std::end(indices));
+  indices.erase(std::unique(std::begin(indices), std::end(indices)), std::end(indices));
+  Locks locks;
+  for (auto index : indices)
+    locks.push_back(std::unique_lock<std::mutex>(*mutexes_[index]));
+  return locks;
+}
+
+StripedMutex::Locks StripedMutex::LockAll() {
+  Locks locks;
+  for (auto& mutex : mutexes_)
+    locks.push_back(std::unique_lock<std::mutex>(*mutex));
+  return locks;
+}
+
+size_t StripedMutex::Index(const leveldb::Slice& key) const {
+  // FNV-1a over the key's bytes, so that callers needn't copy them into a std::string to hash them.
+  uint64_t hash(14695981039346656037ULL);
+  for (size_t i(0); i != key.size(); ++i) {
+    hash ^= static_cast<unsigned char>(key[i]);
+    hash *= 1099511628211ULL;
+  }
+  return static_cast<size_t>(hash % mutexes_.size());
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -0,0 +1,66 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_STRIPED_MUTEX_H_
+#define MAIDSAFE_VAULT_STRIPED_MUTEX_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "leveldb/slice.h"
+
+namespace maidsafe {
+
+namespace vault {
+
+// Fixed set of mutexes selected by a hash of the key, so that operations on unrelated keys can
+// proceed in parallel while operations on the same key remain serialised.  Where several stripes
+// are needed they are always locked in ascending index order to avoid deadlock.
+class StripedMutex {
+ public:
+  typedef std::vector<std::unique_lock<std::mutex>> Locks;
+
+  explicit StripedMutex(size_t stripe_count);
+
+  // A key's stripe depends only on its bytes, so the string and Slice overloads agree.
+  std::mutex& Stripe(const std::string& key);
+  std::mutex& Stripe(const leveldb::Slice& key);
+  Locks Lock(const std::vector<std::string>& keys);
+  Locks Lock(const std::vector<leveldb::Slice>& keys);
+  Locks LockAll();
+  size_t stripe_count() const { return mutexes_.size(); }
+
+ private:
+  StripedMutex(const StripedMutex&);
+  StripedMutex& operator=(const StripedMutex&);
+  StripedMutex(StripedMutex&&);
+  StripedMutex& operator=(StripedMutex&&);
+
+  size_t Index(const leveldb::Slice& key) const;
+
+  std::vector<std::unique_ptr<std::mutex>> mutexes_;
+};
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_STRIPED_MUTEX_H_
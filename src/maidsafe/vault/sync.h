@@ -21,8 +21,13 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -42,6 +47,17 @@ namespace maidsafe {
 
 namespace vault {
 
+namespace detail {
+
+template<typename Key>
+struct SyncKeyHash {
+  size_t operator()(const Key& key) const {
+    return std::hash<std::string>()(key.name.string());
+  }
+};
+
+}  // namespace detail
+
 // The purpose of this class is to ensure enough peers have agreed a given request is valid before
 // recording the corresponding unresolved_action to a Persona's database.  This should ensure that all peers
 // hold similar, if not identical databases.
@@ -67,19 +83,38 @@ class Sync {
   std::vector<UnresolvedAction> GetUnresolvedActions();
   // Calling this will increment the sync counter and delete actions that reach the
   // 'kSyncCounterMax_' limit.  Actions which are resolved by all peers (i.e. have 4 messages) are
-  // also pruned here.
+  // pruned as soon as they become so.
   void IncrementSyncAttempts();
+  size_t size();
 
  private:
+  typedef typename UnresolvedAction::KeyType Key;
+  struct Entry {
+    Entry(const UnresolvedAction& unresolved_action_in, uint64_t added_in_round_in)
+        : unresolved_action(unresolved_action_in), added_in_round(added_in_round_in) {}
+    UnresolvedAction unresolved_action;
+    uint64_t added_in_round;
+  };
+  typedef std::list<Entry> EntryList;
+  typedef std::unordered_multimap<Key, typename EntryList::iterator, detail::SyncKeyHash<Key>>
+      Index;
+
   Sync(Sync&&);
   Sync(const Sync&);
   Sync& operator=(Sync other);
   std::unique_ptr<UnresolvedAction> AddAction(const UnresolvedAction& unresolved_action,
                                               bool merge);
-  bool CanBeErased(const UnresolvedAction& unresolved_action) const;
+  // Returns a copy of the entry's action with its current sync counter.
+  UnresolvedAction Copy(const Entry& entry) const;
+  void Erase(typename EntryList::iterator entry);
 
   std::mutex mutex_;
-  std::vector<UnresolvedAction> unresolved_actions_;
+  // All actions are added with a sync counter of zero and every counter is incremented together,
+  // so the counters are held as the round in which each action was added, and the list kept in
+  // order of addition is also in order of expiry.  'index_' finds the actions for a given key.
+  EntryList unresolved_actions_;
+  Index index_;
+  uint64_t sync_round_;
   static const int32_t kSyncCounterMax_ = 10;  // TODO(dirvine) decide how to decide on this number.
 };
 
@@ -93,6 +128,20 @@ bool IsFromThisNode(const UnresolvedAction& unresolved_action) {
   return !unresolved_action.this_node_and_entry_id.first.IsZero();
 }
 
+// Whether 'existing_action' already holds a message from the sender of 'new_action', regardless of
+// entry ID.
+template<typename UnresolvedAction>
+bool HasMessageFromSender(const UnresolvedAction& new_action,
+                          const UnresolvedAction& existing_action) {
+  if (IsFromThisNode(new_action))
+    return IsFromThisNode(existing_action);
+  return std::any_of(std::begin(existing_action.peer_and_entry_ids),
+                     std::end(existing_action.peer_and_entry_ids),
+                     [&new_action](const std::pair<NodeId, int32_t>& test) {
+      return test.first == new_action.peer_and_entry_ids.front().first;
+  });
+}
+
 template<typename UnresolvedAction>
 bool IsRecorded(const UnresolvedAction& new_action, const UnresolvedAction& existing_action) {
   assert(IsFromThisNode(new_action) ? new_action.peer_and_entry_ids.empty() :
@@ -127,7 +176,7 @@ bool IsResolvedOnAllPeers(const UnresolvedAction& unresolved_action) {
 
 
 template<typename UnresolvedAction>
-Sync<UnresolvedAction>::Sync() : mutex_(), unresolved_actions_() {}
+Sync<UnresolvedAction>::Sync() : mutex_(), unresolved_actions_(), index_(), sync_round_(0) {}
 
 template<typename UnresolvedAction>
 std::unique_ptr<UnresolvedAction> Sync<UnresolvedAction>::AddUnresolvedAction(
@@ -140,78 +189,99 @@ void Sync<UnresolvedAction>::AddLocalAction(const UnresolvedAction& unresolved_a
   AddAction(unresolved_action, false);
 }
 
+// The message is merged into the first action with the same key which doesn't yet hold a message
+// from the same sender; if there's none, it starts a new action.
 template<typename UnresolvedAction>
 std::unique_ptr<UnresolvedAction> Sync<UnresolvedAction>::AddAction(
     const UnresolvedAction& unresolved_action,
     bool merge) {
+  std::lock_guard<std::mutex> lock(mutex_);
   std::unique_ptr<UnresolvedAction> resolved_action;
-  auto found(std::begin(unresolved_actions_));
-  for (;;) {
-    found = std::find_if(found,
-                         std::end(unresolved_actions_),
-                         [&unresolved_action](const UnresolvedAction &test) {
-                           return test.key == unresolved_action.key;
-                         });
-
-    if (found == std::end(unresolved_actions_)) {
-      unresolved_actions_.push_back(unresolved_action);
-      break;
-    } else {
-      // If merge is false and the unresolved_action is from this node, we're adding local
-      // unresolved_action, so this shouldn't already exist.
-      assert(!merge || !detail::IsFromThisNode(unresolved_action));
-    }
-
-    if (!detail::IsRecorded(unresolved_action, (*found))) {
-      if (detail::IsFromThisNode(unresolved_action)) {
-        found->this_node_and_entry_id = unresolved_action.this_node_and_entry_id;
-      } else {
-        found->peer_and_entry_ids.push_back(unresolved_action.peer_and_entry_ids.front());
-      }
-    }
-
-    if (merge && detail::IsResolved(*found)) {
-      resolved_action.reset(new UnresolvedAction(*found));
-      break;
+  auto range(index_.equal_range(unresolved_action.key));
+  auto target(std::end(unresolved_actions_));
+  for (auto itr(range.first); itr != range.second; ++itr) {
+    const auto& existing_action(itr->second->unresolved_action);
+    if (detail::HasMessageFromSender(unresolved_action, existing_action)) {
+      if (detail::IsRecorded(unresolved_action, existing_action))
+        return std::move(resolved_action);
+    } else if (target == std::end(unresolved_actions_)) {
+      target = itr->second;
     }
+  }
 
-    ++found;
+  if (target == std::end(unresolved_actions_)) {
+    unresolved_actions_.push_back(Entry(unresolved_action, sync_round_));
+    index_.insert(std::make_pair(unresolved_action.key, std::prev(std::end(unresolved_actions_))));
+    return std::move(resolved_action);
   }
 
+  auto& found(target->unresolved_action);
+  bool was_resolved(detail::IsResolved(found));
+  if (detail::IsFromThisNode(unresolved_action))
+    found.this_node_and_entry_id = unresolved_action.this_node_and_entry_id;
+  else
+    found.peer_and_entry_ids.push_back(unresolved_action.peer_and_entry_ids.front());
+
+  if (merge && !was_resolved && detail::IsResolved(found))
+    resolved_action.reset(new UnresolvedAction(Copy(*target)));
+  if (detail::IsResolvedOnAllPeers(found))
+    Erase(target);
   return std::move(resolved_action);
 }
 
 template<typename UnresolvedAction>
 std::vector<UnresolvedAction> Sync<UnresolvedAction>::GetUnresolvedActions() {
+  std::lock_guard<std::mutex> lock(mutex_);
   std::vector<UnresolvedAction> result;
-  for (auto& unresolved_action : unresolved_actions_) {
-    if (detail::IsResolvedOnAllPeers(unresolved_action))
-      continue;
+  auto itr(std::begin(unresolved_actions_));
+  while (itr != std::end(unresolved_actions_)) {
+    auto& unresolved_action(itr->unresolved_action);
     if (detail::IsFromThisNode(unresolved_action)) {
       unresolved_action.sent_to_peers = true;
-      result.push_back(unresolved_action);
+      result.push_back(Copy(*itr));
     }
+    if (detail::IsResolvedOnAllPeers(unresolved_action))
+      Erase(itr++);
+    else
+      ++itr;
   }
   return result;
 }
 
 template<typename UnresolvedAction>
-bool Sync<UnresolvedAction>::CanBeErased(const UnresolvedAction& unresolved_action) const {
-  return unresolved_action.sync_counter > kSyncCounterMax_ ||
-         detail::IsResolvedOnAllPeers(unresolved_action);
+void Sync<UnresolvedAction>::IncrementSyncAttempts() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++sync_round_;
+  while (!unresolved_actions_.empty() &&
+         sync_round_ - unresolved_actions_.front().added_in_round >
+             static_cast<uint64_t>(kSyncCounterMax_)) {
+    Erase(std::begin(unresolved_actions_));
+  }
 }
 
 template<typename UnresolvedAction>
-void Sync<UnresolvedAction>::IncrementSyncAttempts() {
-  auto itr = std::begin(unresolved_actions_);
-  while (itr != std::end(unresolved_actions_)) {
-    assert((*itr).peer_and_entry_ids.size() < routing::Parameters::node_group_size);
-    ++(*itr).sync_counter;
-    if (CanBeErased(*itr))
-      itr = unresolved_actions_.erase(itr);
-    else
-      ++itr;
+size_t Sync<UnresolvedAction>::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return unresolved_actions_.size();
+}
+
+template<typename UnresolvedAction>
+UnresolvedAction Sync<UnresolvedAction>::Copy(const Entry& entry) const {
+  UnresolvedAction copy(entry.unresolved_action);
+  copy.sync_counter = static_cast<int>(sync_round_ - entry.added_in_round);
+  return copy;
+}
+
+template<typename UnresolvedAction>
+void Sync<UnresolvedAction>::Erase(typename EntryList::iterator entry) {
+  auto range(index_.equal_range(entry->unresolved_action.key));
+  for (auto itr(range.first); itr != range.second; ++itr) {
+    if (itr->second == entry) {
+      index_.erase(itr);
+      break;
+    }
   }
+  unresolved_actions_.erase(entry);
 }
 
 }  // namespace vault
@@ -0,0 +1,126 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/sync_coalescer.h"
+
+#include "maidsafe/common/error.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+SyncCoalescer::SyncCoalescer(SendFunctor send_functor,
+                             size_t max_batch_bytes,
+                             std::chrono::steady_clock::duration max_batch_delay)
+    : kSendFunctor_(send_functor),
+      kMaxBatchBytes_(max_batch_bytes),
+      kMaxBatchDelay_(max_batch_delay),
+      mutex_(),
+      batches_(),
+      open_order_(),
+      queued_actions_(0),
+      stats_() {}
+
+void SyncCoalescer::Add(const NodeId& group_id, int32_t action_type,
+                        const std::string& serialised_unresolved_action) {
+  SerialisedBatches ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(batches_.find(group_id));
+    if (itr == std::end(batches_)) {
+      itr = batches_.insert(std::make_pair(group_id, Batch())).first;
+      open_order_.push_back(std::make_pair(itr->second.opened, group_id));
+    }
+    auto proto_sync(itr->second.batch.add_syncs());
+    proto_sync->set_action_type(action_type);
+    proto_sync->set_serialised_unresolved_action(serialised_unresolved_action);
+    itr->second.bytes += serialised_unresolved_action.size();
+    ++queued_actions_;
+    ++stats_.actions_added;
+    if (itr->second.bytes >= kMaxBatchBytes_)
+      Take(itr, ready);
+    TakeDue(ready);
+  }
+  Send(ready);
+}
+
+void SyncCoalescer::FlushDue() {
+  SerialisedBatches due;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TakeDue(due);
+  }
+  Send(due);
+}
+
+void SyncCoalescer::FlushAll() {
+  SerialisedBatches all;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!batches_.empty())
+      Take(std::begin(batches_), all);
+    open_order_.clear();
+  }
+  Send(all);
+}
+
+SyncCoalescer::Stats SyncCoalescer::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+size_t SyncCoalescer::queued_actions() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queued_actions_;
+}
+
+std::vector<protobuf::Sync> SyncCoalescer::Unpack(const std::string& serialised_batch) {
+  protobuf::SyncBatch proto_batch;
+  if (!proto_batch.ParseFromString(serialised_batch))
+    ThrowError(CommonErrors::parsing_error);
+  return std::vector<protobuf::Sync>(proto_batch.syncs().begin(), proto_batch.syncs().end());
+}
+
+void SyncCoalescer::TakeDue(SerialisedBatches& due) {
+  auto cutoff(std::chrono::steady_clock::now() - kMaxBatchDelay_);
+  while (!open_order_.empty() && open_order_.front().first <= cutoff) {
+    auto itr(batches_.find(open_order_.front().second));
+    // Only take the batch if it's the one this entry was recorded for, not a newer one.
+    if (itr != std::end(batches_) && itr->second.opened == open_order_.front().first)
+      Take(itr, due);
+    open_order_.pop_front();
+  }
+}
+
+void SyncCoalescer::Take(std::map<NodeId, Batch>::iterator itr, SerialisedBatches& taken) {
+  taken.push_back(std::make_pair(itr->first, itr->second.batch.SerializeAsString()));
+  queued_actions_ -= static_cast<size_t>(itr->second.batch.syncs_size());
+  ++stats_.batches_sent;
+  stats_.bytes_sent += taken.back().second.size();
+  batches_.erase(itr);
+}
+
+void SyncCoalescer::Send(const SerialisedBatches& batches) {
+  for (const auto& batch : batches)
+    kSendFunctor_(batch.first, batch.second);
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
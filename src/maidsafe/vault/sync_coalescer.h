@@ -0,0 +1,126 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_SYNC_COALESCER_H_
+#define MAIDSAFE_VAULT_SYNC_COALESCER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/vault/parameters.h"
+#include "maidsafe/vault/sync.pb.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+// Packs unresolved actions bound for the same group into a single protobuf::SyncBatch.  A group's
+// batch is passed to the send functor once it reaches 'max_batch_bytes', or once it has been open
+// for 'max_batch_delay' and FlushDue or Add is next called.  A sync round should end with FlushAll,
+// since its batches were only just opened.  The send functor is never invoked while the
+// coalescer's lock is held.
+class SyncCoalescer {
+ public:
+  typedef std::function<void(const NodeId& group_id, const std::string& serialised_batch)>
+      SendFunctor;
+
+  struct Stats {
+    Stats() : actions_added(0), batches_sent(0), bytes_sent(0) {}
+    uint64_t actions_added, batches_sent, bytes_sent;
+  };
+
+  explicit SyncCoalescer(
+      SendFunctor send_functor,
+      size_t max_batch_bytes = detail::Parameters::sync_batch_max_bytes,
+      std::chrono::steady_clock::duration max_batch_delay =
+          detail::Parameters::sync_batch_max_delay);
+
+  void Add(const NodeId& group_id, int32_t action_type,
+           const std::string& serialised_unresolved_action);
+  // Adds all actions which 'sync' has to send to peers, each bound for the group which
+  // 'group_id_functor' returns for the action's key.
+  template<typename SyncType, typename GroupIdFunctor>
+  void AddUnresolvedActions(SyncType& sync, GroupIdFunctor group_id_functor);
+  void FlushDue();
+  void FlushAll();
+  Stats stats();
+  // Number of actions held in batches which have not yet been sent.
+  size_t queued_actions();
+
+  // Parses a batch produced by a SyncCoalescer.  Throws on parsing failure.
+  static std::vector<protobuf::Sync> Unpack(const std::string& serialised_batch);
+
+ private:
+  typedef std::vector<std::pair<NodeId, std::string>> SerialisedBatches;
+
+  struct Batch {
+    Batch() : batch(), bytes(0), opened(std::chrono::steady_clock::now()) {}
+    protobuf::SyncBatch batch;
+    size_t bytes;
+    std::chrono::steady_clock::time_point opened;
+  };
+
+  SyncCoalescer(const SyncCoalescer&);
+  SyncCoalescer& operator=(const SyncCoalescer&);
+  SyncCoalescer(SyncCoalescer&&);
+  SyncCoalescer& operator=(SyncCoalescer&&);
+
+  // These require 'mutex_' to be held.
+  void TakeDue(SerialisedBatches& due);
+  void Take(std::map<NodeId, Batch>::iterator itr, SerialisedBatches& taken);
+
+  void Send(const SerialisedBatches& batches);
+
+  const SendFunctor kSendFunctor_;
+  const size_t kMaxBatchBytes_;
+  const std::chrono::steady_clock::duration kMaxBatchDelay_;
+  std::mutex mutex_;
+  std::map<NodeId, Batch> batches_;
+  // Open batches in the order they were opened, with their opening times.  Entries for batches
+  // which have since been sent are skipped.
+  std::deque<std::pair<std::chrono::steady_clock::time_point, NodeId>> open_order_;
+  size_t queued_actions_;
+  Stats stats_;
+};
+
+template<typename SyncType, typename GroupIdFunctor>
+void SyncCoalescer::AddUnresolvedActions(SyncType& sync, GroupIdFunctor group_id_functor) {
+  for (const auto& unresolved_action : sync.GetUnresolvedActions()) {
+    typedef typename std::decay<decltype(unresolved_action)>::type UnresolvedAction;
+    Add(group_id_functor(unresolved_action.key),
+        static_cast<int32_t>(UnresolvedAction::Action::kActionId),
+        unresolved_action.Serialise());
+  }
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_SYNC_COALESCER_H_
@@ -0,0 +1,154 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/sync_scheduler.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "maidsafe/common/log.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+SyncScheduler::SyncScheduler(RoundFunctor round_functor,
+                             QueueDepthFunctor queue_depth_functor,
+                             DrainFunctor drain_functor,
+                             std::chrono::steady_clock::duration interval,
+                             std::chrono::steady_clock::duration max_interval,
+                             size_t max_queue_depth)
+    : kRoundFunctor_(round_functor),
+      kQueueDepthFunctor_(queue_depth_functor),
+      kDrainFunctor_(drain_functor),
+      kInterval_(interval),
+      kMaxInterval_(std::max(interval, max_interval)),
+      kMaxQueueDepth_(max_queue_depth),
+      mutex_(),
+      condition_(),
+      current_interval_(interval),
+      notified_(false),
+      stopped_(false),
+      oldest_notified_(),
+      stats_(),
+      thread_([this] { Run(); }) {}
+
+SyncScheduler::~SyncScheduler() {
+  Stop();
+}
+
+void SyncScheduler::Notify() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!notified_) {
+    notified_ = true;
+    oldest_notified_ = std::chrono::steady_clock::now();
+  }
+}
+
+void SyncScheduler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  condition_.notify_one();
+  if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id())
+    thread_.join();
+}
+
+SyncScheduler::Stats SyncScheduler::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::chrono::steady_clock::duration SyncScheduler::current_lag() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return notified_ ? std::chrono::steady_clock::now() - oldest_notified_ :
+                     std::chrono::steady_clock::duration::zero();
+}
+
+void SyncScheduler::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopped_) {
+    condition_.wait_for(lock, current_interval_, [this] { return stopped_; });
+    if (stopped_)
+      break;
+    lock.unlock();
+    bool backlogged(kQueueDepthFunctor_() > kMaxQueueDepth_);
+    lock.lock();
+    if (backlogged) {
+      ++stats_.deferred_rounds;
+      current_interval_ = std::min(current_interval_ * 2, kMaxInterval_);
+      lock.unlock();
+      Drain();
+      lock.lock();
+      continue;
+    }
+    current_interval_ = kInterval_;
+    lock.unlock();
+    RunRound();
+    lock.lock();
+  }
+  lock.unlock();
+  // Give actions added since the last round a chance to reach the peers before shutting down.
+  RunRound();
+}
+
+void SyncScheduler::RunRound() {
+  bool covers_notify(false);
+  TimePoint oldest_notified;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(covers_notify, notified_);
+    oldest_notified = oldest_notified_;
+  }
+  bool succeeded(true);
+  try {
+    kRoundFunctor_();
+  }
+  catch(const std::exception& e) {
+    LOG(kError) << "Sync round failed: " << e.what();
+    succeeded = false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.rounds;
+  if (!succeeded) {
+    ++stats_.failed_rounds;
+    // The notified actions are still waiting; keep their lag running.
+    if (covers_notify) {
+      notified_ = true;
+      oldest_notified_ = oldest_notified;
+    }
+  } else if (covers_notify) {
+    stats_.last_lag = std::chrono::steady_clock::now() - oldest_notified;
+    stats_.max_lag = std::max(stats_.max_lag, stats_.last_lag);
+  }
+}
+
+void SyncScheduler::Drain() {
+  try {
+    kDrainFunctor_();
+  }
+  catch(const std::exception& e) {
+    LOG(kError) << "Sync drain failed: " << e.what();
+  }
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -0,0 +1,102 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_SYNC_SCHEDULER_H_
+#define MAIDSAFE_VAULT_SYNC_SCHEDULER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "maidsafe/vault/parameters.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+// Drives a persona's sync rounds from a dedicated thread, so that message handlers only need to
+// call Notify after adding a local action and never wait on sync fan-out themselves.  A round is
+// run every 'interval'.  While 'queue_depth_functor' reports more than 'max_queue_depth' queued
+// outbound actions, rounds are skipped and the interval doubles, up to 'max_interval'.  A skipped
+// round still calls 'drain_functor', which should send what is already queued without gathering
+// new actions, so that the queue can fall back below the limit.
+class SyncScheduler {
+ public:
+  typedef std::function<void()> RoundFunctor;
+  typedef std::function<size_t()> QueueDepthFunctor;
+  typedef std::function<void()> DrainFunctor;
+
+  struct Stats {
+    Stats() : rounds(0), deferred_rounds(0), failed_rounds(0), last_lag(), max_lag() {}
+    uint64_t rounds, deferred_rounds, failed_rounds;
+    // Time from the earliest Notify covered by a round until that round completed.
+    std::chrono::steady_clock::duration last_lag, max_lag;
+  };
+
+  SyncScheduler(RoundFunctor round_functor,
+                QueueDepthFunctor queue_depth_functor,
+                DrainFunctor drain_functor,
+                std::chrono::steady_clock::duration interval = detail::Parameters::sync_interval,
+                std::chrono::steady_clock::duration max_interval =
+                    detail::Parameters::sync_max_interval,
+                size_t max_queue_depth = detail::Parameters::sync_max_queue_depth);
+  ~SyncScheduler();
+
+  // Records that a local action is waiting to be synced.  Doesn't block on a running round.
+  void Notify();
+  // Runs one final round, then stops the scheduler's thread.  Safe to call more than once.
+  void Stop();
+  Stats stats();
+  // How long the oldest action notified since the last round started has been waiting, or zero.
+  std::chrono::steady_clock::duration current_lag();
+
+ private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  SyncScheduler(const SyncScheduler&);
+  SyncScheduler& operator=(const SyncScheduler&);
+  SyncScheduler(SyncScheduler&&);
+  SyncScheduler& operator=(SyncScheduler&&);
+
+  void Run();
+  void RunRound();
+  void Drain();
+
+  const RoundFunctor kRoundFunctor_;
+  const QueueDepthFunctor kQueueDepthFunctor_;
+  const DrainFunctor kDrainFunctor_;
+  const std::chrono::steady_clock::duration kInterval_, kMaxInterval_;
+  const size_t kMaxQueueDepth_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::chrono::steady_clock::duration current_interval_;
+  bool notified_, stopped_;
+  TimePoint oldest_notified_;
+  Stats stats_;
+  std::thread thread_;
+};
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_SYNC_SCHEDULER_H_
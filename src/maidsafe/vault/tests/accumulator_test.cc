@@ -1,20 +1,20 @@
-///*  Copyright 2012 MaidSafe.net limited
+/*  Copyright 2012 MaidSafe.net limited
 
-//    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
-//    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
-//    licence you accepted on initial access to the Software (the "Licences").
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
 
-//    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
-//    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
-//    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
-//    available at: http://www.maidsafe.net/licenses
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
 
-//    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
-//    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
-//    OF ANY KIND, either express or implied.
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
 
-//    See the Licences for the specific language governing permissions and limitations relating to
-//    use of the MaidSafe Software.                                                                 */
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
 
 //#include "maidsafe/vault/accumulator.h"
 
@@ -145,3 +145,353 @@
 //}  // namespace vault
 
 //}  // namespace maidsafe
+
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/variant/variant.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/data_types/immutable_data.h"
+#include "maidsafe/nfs/vault/messages.h"
+#include "maidsafe/routing/message.h"
+#include "maidsafe/routing/parameters.h"
+
+#include "maidsafe/vault/accumulator.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+struct TestPutRequest {
+  TestPutRequest(int id, const std::string& content)
+      : message_id(id),
+        contents(std::make_shared<nfs_vault::DataNameAndContent>(MakeNameAndContent(content))) {}
+  static nfs_vault::DataNameAndContent MakeNameAndContent(const std::string& content) {
+    ImmutableData data((NonEmptyString(content)));
+    return nfs_vault::DataNameAndContent(ImmutableData::Name::data_type, data.name(), data.data());
+  }
+  nfs::MessageId message_id;
+  std::shared_ptr<nfs_vault::DataNameAndContent> contents;
+};
+
+struct TestGetRequest {
+  explicit TestGetRequest(int id)
+      : message_id(id), contents(std::make_shared<Identity>(RandomString(NodeId::kSize))) {}
+  nfs::MessageId message_id;
+  std::shared_ptr<Identity> contents;
+};
+
+typedef boost::variant<TestPutRequest, TestGetRequest> TestRequest;
+typedef Accumulator<TestRequest> TestAccumulator;
+
+routing::GroupSource GenerateGroupSource(const NodeId& group_id) {
+  return routing::GroupSource(routing::GroupId(group_id),
+                              routing::SingleId(NodeId(NodeId::kRandomId)));
+}
+
+TestAccumulator::AddResult WaitForQuorum(const std::vector<TestRequest>& requests) {
+  return requests.size() >= routing::Parameters::node_group_size - 1 ?
+         TestAccumulator::AddResult::kSuccess : TestAccumulator::AddResult::kWaiting;
+}
+
+// The lookups of the deque-based accumulator this replaced, kept as a reference for its results.
+class LinearAccumulator {
+ public:
+  LinearAccumulator() : pending_requests_(), handled_requests_() {}
+
+  TestAccumulator::AddResult AddPendingRequest(const TestRequest& request,
+                                               const routing::GroupSource& source) {
+    if (CheckHandled(request))
+      return TestAccumulator::AddResult::kHandled;
+    if (!RequestExists(request, source)) {
+      pending_requests_.push_back(TestAccumulator::PendingRequest(request, source));
+      if (pending_requests_.size() > 300)
+        pending_requests_.pop_front();
+    }
+    return WaitForQuorum(Get(request));
+  }
+
+  bool CheckHandled(const TestRequest& request) {
+    for (auto handled_request : handled_requests_) {
+      if (Matches(handled_request, request))
+        return true;
+    }
+    return false;
+  }
+
+  void SetHandled(const TestRequest& request) {
+    for (auto itr(std::begin(pending_requests_)); itr != std::end(pending_requests_);) {
+      if (Matches(itr->request, request))
+        itr = pending_requests_.erase(itr);
+      else
+        ++itr;
+    }
+    handled_requests_.push_back(request);
+    if (handled_requests_.size() > 1000)
+      handled_requests_.pop_front();
+  }
+
+ private:
+  static bool Matches(const TestRequest& lhs, const TestRequest& rhs) {
+    return lhs.which() == rhs.which() &&
+           boost::apply_visitor(MessageIdRequestVisitor(), lhs) ==
+               boost::apply_visitor(MessageIdRequestVisitor(), rhs);
+  }
+
+  std::vector<TestRequest> Get(const TestRequest& request) {
+    std::vector<TestRequest> requests;
+    for (auto pending_request : pending_requests_) {
+      if (Matches(pending_request.request, request))
+        requests.push_back(pending_request.request);
+    }
+    return requests;
+  }
+
+  bool RequestExists(const TestRequest& request, const routing::GroupSource& source) {
+    for (auto pending_request : pending_requests_) {
+      if (Matches(pending_request.request, request) && pending_request.source == source)
+        return true;
+    }
+    return false;
+  }
+
+  std::deque<TestAccumulator::PendingRequest> pending_requests_;
+  std::deque<TestRequest> handled_requests_;
+};
+
+// Feeds 'message_count' requests through 'accumulator', each arriving once from every member of
+// its group with the copies spread over the next 300 requests.  Returns the result of each add.
+template<typename AccumulatorType, typename AddFunctor>
+std::vector<TestAccumulator::AddResult> AccumulateMessages(AccumulatorType& accumulator,
+                                                           int message_count, AddFunctor add) {
+  const int kSpread(300);
+  const NodeId kGroupId(NodeId::kRandomId);
+  std::vector<routing::GroupSource> sources;
+  for (uint16_t i(0); i != routing::Parameters::node_group_size; ++i)
+    sources.push_back(GenerateGroupSource(kGroupId));
+
+  std::vector<TestAccumulator::AddResult> results;
+  for (int id(0); id != message_count + kSpread; ++id) {
+    // Deliver the first copy of a new request and later copies of earlier ones.
+    for (int copy(0); copy != static_cast<int>(sources.size()); ++copy) {
+      int request_id(id - copy * kSpread / static_cast<int>(sources.size()));
+      if (request_id < 0 || request_id >= message_count)
+        continue;
+      TestRequest request(TestPutRequest(request_id, "content"));
+      results.push_back(add(accumulator, request, sources[copy]));
+      if (results.back() == TestAccumulator::AddResult::kSuccess)
+        accumulator.SetHandled(request);
+    }
+  }
+  return results;
+}
+
+}  // unnamed namespace
+
+TEST(AccumulatorTest, BEH_AddPendingRequest) {
+  TestAccumulator accumulator;
+  const NodeId kGroupId(NodeId::kRandomId);
+  TestRequest put(TestPutRequest(1, "content")), get(TestGetRequest(1));
+  auto source(GenerateGroupSource(kGroupId));
+
+  EXPECT_EQ(TestAccumulator::AddResult::kWaiting,
+            accumulator.AddPendingRequest(put, source, WaitForQuorum));
+  // Duplicates from the same source are ignored.
+  EXPECT_EQ(TestAccumulator::AddResult::kWaiting,
+            accumulator.AddPendingRequest(put, source, WaitForQuorum));
+  EXPECT_EQ(1U, accumulator.Get(put).size());
+  // Same message id but a different message type is a different request.
+  EXPECT_TRUE(accumulator.Get(get).empty());
+
+  for (uint16_t i(2); i != routing::Parameters::node_group_size - 1; ++i) {
+    EXPECT_EQ(TestAccumulator::AddResult::kWaiting,
+              accumulator.AddPendingRequest(put, GenerateGroupSource(kGroupId), WaitForQuorum));
+  }
+  EXPECT_EQ(TestAccumulator::AddResult::kSuccess,
+            accumulator.AddPendingRequest(put, GenerateGroupSource(kGroupId), WaitForQuorum));
+
+  EXPECT_FALSE(accumulator.CheckHandled(put));
+  accumulator.SetHandled(put);
+  EXPECT_TRUE(accumulator.CheckHandled(put));
+  EXPECT_FALSE(accumulator.CheckHandled(get));
+  EXPECT_TRUE(accumulator.Get(put).empty());
+  EXPECT_EQ(TestAccumulator::AddResult::kHandled,
+            accumulator.AddPendingRequest(put, source, WaitForQuorum));
+}
+
+TEST(AccumulatorTest, BEH_BoundedFifoEviction) {
+  TestAccumulator accumulator;
+  const NodeId kGroupId(NodeId::kRandomId);
+  const int kPendingLimit(300), kHandledLimit(1000);
+  for (int i(0); i != kPendingLimit + 1; ++i) {
+    accumulator.AddPendingRequest(TestGetRequest(i), GenerateGroupSource(kGroupId),
+                                  WaitForQuorum);
+  }
+  // The oldest pending request is evicted first.
+  EXPECT_TRUE(accumulator.Get(TestGetRequest(0)).empty());
+  EXPECT_EQ(1U, accumulator.Get(TestGetRequest(1)).size());
+  EXPECT_EQ(1U, accumulator.Get(TestGetRequest(kPendingLimit)).size());
+
+  // Handled requests don't count against the pending limit.
+  for (int i(1); i != kPendingLimit / 2; ++i)
+    accumulator.SetHandled(TestGetRequest(i));
+  for (int i(0); i != kPendingLimit / 2 - 1; ++i) {
+    accumulator.AddPendingRequest(TestPutRequest(i, "content"), GenerateGroupSource(kGroupId),
+                                  WaitForQuorum);
+  }
+  EXPECT_EQ(1U, accumulator.Get(TestGetRequest(kPendingLimit / 2)).size());
+  // Eviction skips the handled requests and takes the oldest still pending.
+  accumulator.AddPendingRequest(TestPutRequest(kPendingLimit / 2, "content"),
+                                GenerateGroupSource(kGroupId), WaitForQuorum);
+  EXPECT_TRUE(accumulator.Get(TestGetRequest(kPendingLimit / 2)).empty());
+  EXPECT_EQ(1U, accumulator.Get(TestGetRequest(kPendingLimit / 2 + 1)).size());
+
+  for (int i(0); i != kHandledLimit; ++i)
+    accumulator.SetHandled(TestPutRequest(kPendingLimit + i, "content"));
+  EXPECT_FALSE(accumulator.CheckHandled(TestGetRequest(1)));
+  EXPECT_TRUE(accumulator.CheckHandled(TestPutRequest(kPendingLimit, "content")));
+}
+
+TEST(AccumulatorTest, BEH_EvictionPolicy) {
+  const NodeId kGroupId(NodeId::kRandomId);
+  AccumulatorPolicy policy;
+  policy.max_pending_count = 10;
+  policy.max_handled_count = 2;
+  {
+    TestAccumulator accumulator(policy);
+    for (int i(0); i != 15; ++i)
+      accumulator.AddPendingRequest(TestGetRequest(i), GenerateGroupSource(kGroupId),
+                                    WaitForQuorum);
+    EXPECT_EQ(10U, accumulator.pending_count());
+    EXPECT_EQ(5U, accumulator.stats().evicted);
+    EXPECT_TRUE(accumulator.Get(TestGetRequest(4)).empty());
+    EXPECT_EQ(1U, accumulator.Get(TestGetRequest(5)).size());
+
+    for (int i(0); i != 3; ++i)
+      accumulator.SetHandled(TestGetRequest(i + 5));
+    EXPECT_EQ(1U, accumulator.stats().handled_evicted);
+    EXPECT_FALSE(accumulator.CheckHandled(TestGetRequest(5)));
+    EXPECT_TRUE(accumulator.CheckHandled(TestGetRequest(7)));
+    EXPECT_EQ(TestAccumulator::AddResult::kHandled,
+              accumulator.AddPendingRequest(TestGetRequest(6), GenerateGroupSource(kGroupId),
+                                            WaitForQuorum));
+    EXPECT_EQ(2U, accumulator.stats().handled_hits);
+    EXPECT_EQ(0U, accumulator.stats().expired);
+  }
+  {
+    // Room for three copies of a chunk-carrying request.
+    TestAccumulator probe;
+    probe.AddPendingRequest(TestPutRequest(0, "content"), GenerateGroupSource(kGroupId),
+                            WaitForQuorum);
+    policy.max_pending_bytes = 3 * probe.pending_bytes();
+    TestAccumulator accumulator(policy);
+    for (int i(0); i != 5; ++i) {
+      accumulator.AddPendingRequest(TestPutRequest(i, "content"), GenerateGroupSource(kGroupId),
+                                    WaitForQuorum);
+    }
+    EXPECT_EQ(3U, accumulator.pending_count());
+    EXPECT_LE(accumulator.pending_bytes(), policy.max_pending_bytes);
+    EXPECT_EQ(2U, accumulator.stats().evicted);
+  }
+  {
+    policy.max_pending_bytes = AccumulatorPolicy().max_pending_bytes;
+    policy.max_pending_age = std::chrono::milliseconds(100);
+    TestAccumulator accumulator(policy);
+    for (int i(0); i != 5; ++i)
+      accumulator.AddPendingRequest(TestGetRequest(i), GenerateGroupSource(kGroupId),
+                                    WaitForQuorum);
+    accumulator.SetHandled(TestGetRequest(0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    accumulator.AddPendingRequest(TestGetRequest(5), GenerateGroupSource(kGroupId),
+                                  WaitForQuorum);
+    EXPECT_EQ(1U, accumulator.pending_count());
+    EXPECT_EQ(4U, accumulator.stats().expired);
+    EXPECT_EQ(0U, accumulator.stats().evicted);
+    EXPECT_EQ(1U, accumulator.Get(TestGetRequest(5)).size());
+  }
+}
+
+TEST(AccumulatorTest, FUNC_MatchesLinearAccumulator) {
+  const int kMessageCount(10000);
+  auto add([](TestAccumulator& accumulator, const TestRequest& request,
+              const routing::GroupSource& source) {
+    return accumulator.AddPendingRequest(request, source, WaitForQuorum);
+  });
+  auto add_linear([](LinearAccumulator& accumulator, const TestRequest& request,
+                     const routing::GroupSource& source) {
+    return accumulator.AddPendingRequest(request, source);
+  });
+
+  LinearAccumulator linear_accumulator;
+  TestAccumulator accumulator;
+  auto linear_results(AccumulateMessages(linear_accumulator, kMessageCount, add_linear));
+  auto results(AccumulateMessages(accumulator, kMessageCount, add));
+  // Both evict the oldest pending copy beyond 300 and remember the last 1000 handled requests, so
+  // every add must give the same result.
+  ASSERT_EQ(linear_results.size(), results.size());
+  EXPECT_TRUE(linear_results == results);
+  EXPECT_EQ(0U, accumulator.stats().expired);
+}
+
+TEST(AccumulatorTest, BEH_PayloadsStoredAsDigests) {
+  const size_t kChunkSize(256 * 1024), kDigestSize(crypto::SHA512::DIGESTSIZE);
+  // Fills the accumulator to its pending limit without evicting anything.
+  const int kRequestCount(300 / (routing::Parameters::node_group_size - 1));
+  const size_t kCopyCount(kRequestCount * (routing::Parameters::node_group_size - 1));
+  const NodeId kGroupId(NodeId::kRandomId);
+  TestAccumulator accumulator;
+  std::vector<TestRequest> requests;
+  for (int i(0); i != kRequestCount; ++i) {
+    requests.push_back(TestPutRequest(i, RandomString(kChunkSize)));
+    for (uint16_t j(0); j != routing::Parameters::node_group_size - 1; ++j) {
+      accumulator.AddPendingRequest(requests.back(), GenerateGroupSource(kGroupId),
+                                    WaitForQuorum);
+    }
+  }
+
+  size_t stored_payload_bytes(0);
+  for (const auto& request : requests) {
+    const auto& contents(*boost::get<TestPutRequest>(request).contents);
+    // The caller's message is left intact.
+    EXPECT_EQ(kChunkSize, contents.content.string().size());
+    auto pending(accumulator.Get(request));
+    ASSERT_EQ(routing::Parameters::node_group_size - 1U, pending.size());
+    for (const auto& pending_request : pending) {
+      const auto& pending_contents(*boost::get<TestPutRequest>(pending_request).contents);
+      EXPECT_EQ(crypto::Hash<crypto::SHA512>(contents.content).string(),
+                pending_contents.content.string());
+      stored_payload_bytes += pending_contents.content.string().size();
+    }
+  }
+  EXPECT_EQ(kCopyCount * kDigestSize, stored_payload_bytes);
+
+  // Differing payloads still produce differing digests.
+  TestRequest other(TestPutRequest(kRequestCount, RandomString(kChunkSize)));
+  TestRequest same_id_other_payload(TestPutRequest(kRequestCount, RandomString(kChunkSize)));
+  accumulator.AddPendingRequest(other, GenerateGroupSource(kGroupId), WaitForQuorum);
+  accumulator.AddPendingRequest(same_id_other_payload, GenerateGroupSource(kGroupId),
+                                WaitForQuorum);
+  auto pending(accumulator.Get(other));
+  ASSERT_EQ(2U, pending.size());
+  EXPECT_NE(boost::get<TestPutRequest>(pending.front()).contents->content,
+            boost::get<TestPutRequest>(pending.back()).contents->content);
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
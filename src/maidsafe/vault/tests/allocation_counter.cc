@@ -0,0 +1,78 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/tests/allocation_counter.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+
+namespace {
+
+std::atomic<bool> g_counting(false);
+std::atomic<uint64_t> g_allocations(0), g_allocated_bytes(0);
+
+}  // unnamed namespace
+
+void* operator new(size_t size) {
+  if (g_counting) {
+    ++g_allocations;
+    g_allocated_bytes += size;
+  }
+  void* pointer(std::malloc(size == 0 ? 1 : size));
+  if (!pointer)
+    throw std::bad_alloc();
+  return pointer;
+}
+
+void operator delete(void* pointer) throw() {
+  std::free(pointer);
+}
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+AllocationCounter::AllocationCounter() {
+  assert(!g_counting);
+  g_allocations = 0;
+  g_allocated_bytes = 0;
+  g_counting = true;
+}
+
+AllocationCounter::~AllocationCounter() {
+  g_counting = false;
+}
+
+uint64_t AllocationCounter::allocations() const {
+  return g_allocations;
+}
+
+uint64_t AllocationCounter::allocated_bytes() const {
+  return g_allocated_bytes;
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -0,0 +1,54 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_TESTS_ALLOCATION_COUNTER_H_
+#define MAIDSAFE_VAULT_TESTS_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+// Counts the heap allocations made through the global operator new (which the test binary replaces)
+// while an instance is alive.  The counts are process-wide, so include other threads' allocations.
+// Only one instance may exist at a time.
+class AllocationCounter {
+ public:
+  AllocationCounter();
+  ~AllocationCounter();
+  uint64_t allocations() const;
+  uint64_t allocated_bytes() const;
+
+ private:
+  AllocationCounter(const AllocationCounter&);
+  AllocationCounter& operator=(const AllocationCounter&);
+  AllocationCounter(AllocationCounter&&);
+  AllocationCounter& operator=(AllocationCounter&&);
+};
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_TESTS_ALLOCATION_COUNTER_H_
@@ -0,0 +1,191 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/pmid_node/chunk_io_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/data_types/immutable_data.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+DataNameVariant RandomName() {
+  return DataNameVariant(ImmutableData::Name(Identity(RandomString(64))));
+}
+
+// Stands in for a disk: each write and each sync takes a fixed time, and a device which can't
+// service requests in parallel (like an HDD's single head) handles them one at a time.
+class FakeBlockDevice {
+ public:
+  FakeBlockDevice(std::chrono::microseconds write_latency, std::chrono::microseconds sync_latency,
+                  bool parallel)
+      : kWriteLatency_(write_latency),
+        kSyncLatency_(sync_latency),
+        kParallel_(parallel),
+        mutex_(),
+        written_(0),
+        synced_(0) {}
+
+  uint64_t Write() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+      if (!kParallel_)
+        lock.lock();
+      std::this_thread::sleep_for(kWriteLatency_);
+    }
+    return ++written_;
+  }
+
+  void Sync() {
+    uint64_t written(written_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::this_thread::sleep_for(kSyncLatency_);
+    synced_ = std::max(synced_.load(), written);
+  }
+
+  uint64_t synced() const { return synced_; }
+
+ private:
+  const std::chrono::microseconds kWriteLatency_, kSyncLatency_;
+  const bool kParallel_;
+  std::mutex mutex_;
+  std::atomic<uint64_t> written_, synced_;
+};
+
+}  // unnamed namespace
+
+TEST(ChunkIoEngineTest, BEH_CompletesOnlyOnceSynced) {
+  FakeBlockDevice device(std::chrono::microseconds(100), std::chrono::microseconds(500), true);
+  const int kChunkCount(500);
+  // Each chunk's content is its index, so the write functor can record the device's sequence
+  // number for it.  A chunk must not be completed before a sync covering that write.
+  std::vector<uint64_t> write_sequence(kChunkCount, 0);
+  std::atomic<int> completed(0), unsynced(0);
+  {
+    ChunkIoEngine engine([&](const DataNameVariant&, const NonEmptyString& content) {
+                           write_sequence[std::stoi(content.string())] = device.Write();
+                         },
+                         [&] { device.Sync(); }, 4, 16, 8);
+    for (int i(0); i != kChunkCount; ++i) {
+      engine.Submit(RandomName(), NonEmptyString(std::to_string(i)),
+                    [&, i](const maidsafe_error& error) {
+                      EXPECT_EQ(make_error_code(CommonErrors::success), error.code());
+                      if (write_sequence[i] == 0 || write_sequence[i] > device.synced())
+                        ++unsynced;
+                      ++completed;
+                    });
+    }
+    engine.Stop();
+    auto stats(engine.stats());
+    EXPECT_EQ(static_cast<uint64_t>(kChunkCount), stats.submitted);
+    EXPECT_EQ(static_cast<uint64_t>(kChunkCount), stats.completed);
+    EXPECT_EQ(0U, stats.failed);
+    EXPECT_LE(stats.max_queue_depth, 16U);
+    // Syncs were grouped.
+    EXPECT_LT(stats.syncs, static_cast<uint64_t>(kChunkCount));
+    EXPECT_GE(stats.syncs, static_cast<uint64_t>(kChunkCount / 8));
+  }
+  EXPECT_EQ(kChunkCount, completed.load());
+  EXPECT_EQ(0, unsynced.load());
+  EXPECT_EQ(static_cast<uint64_t>(kChunkCount), device.synced());
+}
+
+TEST(ChunkIoEngineTest, BEH_FailuresAndStop) {
+  auto failing_name(RandomName());
+  std::atomic<int> succeeded(0), failed(0), syncs(0);
+  ChunkIoEngine engine([&](const DataNameVariant& data_name, const NonEmptyString&) {
+                         if (data_name == failing_name)
+                           ThrowError(CommonErrors::filesystem_io_error);
+                       },
+                       [&] { ++syncs; }, 2);
+  auto on_complete([&](const maidsafe_error& error) {
+                     if (error.code() == make_error_code(CommonErrors::success))
+                       ++succeeded;
+                     else
+                       ++failed;
+                   });
+  engine.Submit(failing_name, NonEmptyString("a"), on_complete);
+  for (int i(0); i != 10; ++i)
+    engine.Submit(RandomName(), NonEmptyString("b"), on_complete);
+  engine.Stop();
+  EXPECT_EQ(10, succeeded.load());
+  EXPECT_EQ(1, failed.load());
+  EXPECT_LT(0, syncs.load());
+
+  // Once stopped, submissions fail immediately.
+  EXPECT_FALSE(engine.Submit(RandomName(), NonEmptyString("c"), on_complete));
+  EXPECT_EQ(2, failed.load());
+  EXPECT_NO_THROW(engine.Stop());
+  EXPECT_EQ(1U, engine.stats().failed);
+}
+
+TEST(ChunkIoEngineTest, FUNC_SustainedPutsShareSyncs) {
+  // Writing and syncing each chunk on the calling thread (as PutToPermanentStore used to) costs a
+  // sync per chunk.  Pipelined through the engine, each sync should cover several writes.
+  const size_t kChunkSize(256 * 1024), kChunkCount(200);
+  const NonEmptyString kContent(RandomString(kChunkSize));
+  struct Profile {
+    std::chrono::microseconds write_latency, sync_latency;
+    bool parallel;
+  };
+  const Profile kProfiles[] = {
+      { std::chrono::microseconds(2000), std::chrono::microseconds(10000), false },
+      { std::chrono::microseconds(100), std::chrono::microseconds(500), true } };
+
+  for (const auto& profile : kProfiles) {
+    FakeBlockDevice device(profile.write_latency, profile.sync_latency, profile.parallel);
+    std::atomic<size_t> completed(0);
+    ChunkIoEngine::Stats stats;
+    {
+      ChunkIoEngine engine(
+          [&](const DataNameVariant&, const NonEmptyString&) { device.Write(); },
+          [&] { device.Sync(); });
+      for (size_t i(0); i != kChunkCount; ++i)
+        engine.Submit(RandomName(), kContent, [&](const maidsafe_error&) { ++completed; });
+      while (completed != kChunkCount)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      stats = engine.stats();
+    }
+    EXPECT_EQ(kChunkCount, stats.completed);
+    EXPECT_EQ(0U, stats.failed);
+    EXPECT_EQ(kChunkCount, device.synced());
+    EXPECT_LT(stats.syncs, kChunkCount);
+  }
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -0,0 +1,112 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/pmid_node/chunk_view.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault/pmid_node/segment_store.h"
+#include "maidsafe/vault/tests/allocation_counter.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+const DiskUsage kMaxDiskUsage(std::numeric_limits<uint64_t>::max());
+
+}  // unnamed namespace
+
+TEST(ChunkViewTest, BEH_ViewOutlivesDeleteAndCompaction) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  SegmentStore store(*test_path, kMaxDiskUsage, 4 * 1024, 0.5);
+  std::vector<std::string> keys;
+  std::vector<NonEmptyString> contents;
+  for (int i(0); i != 20; ++i) {
+    keys.push_back(RandomString(64));
+    contents.push_back(NonEmptyString(RandomString(512)));
+    store.Put(keys.back(), contents.back());
+  }
+
+  // The first chunk's segment is sealed, so it's mapped rather than copied.
+  auto sealed_view(store.GetView(keys.front()));
+  EXPECT_TRUE(sealed_view.content() == nullptr);
+  EXPECT_EQ(contents.front().string(), std::string(sealed_view.data(), sealed_view.size()));
+  EXPECT_EQ(contents.front(), sealed_view.ToNonEmptyString());
+  auto current_view(store.GetView(keys.back()));
+  ASSERT_TRUE(current_view.content() != nullptr);
+  EXPECT_EQ(contents.back(), *current_view.content());
+
+  for (size_t i(0); i != keys.size() - 1; ++i)
+    store.Delete(keys[i]);
+  store.Compact();
+  EXPECT_LT(0U, store.stats().compactions);
+  EXPECT_THROW(store.GetView(keys.front()), std::exception);
+  EXPECT_EQ(contents.front().string(), std::string(sealed_view.data(), sealed_view.size()));
+}
+
+TEST(ChunkViewTest, FUNC_GetAllocationsAndCopies) {
+  const size_t kChunkSize(64 * 1024), kChunkCount(100);
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  SegmentStore store(*test_path, kMaxDiskUsage, 1024 * 1024);
+  std::vector<std::string> keys;
+  for (size_t i(0); i != kChunkCount; ++i) {
+    keys.push_back(RandomString(64));
+    store.Put(keys.back(), NonEmptyString(RandomString(kChunkSize)));
+  }
+  // Only measure chunks in sealed segments, each of which holds fifteen chunks.
+  keys.resize(kChunkCount - 15);
+  for (const auto& key : keys)
+    store.GetView(key);
+
+  // Returns the bytes allocated per GET.
+  auto measure([&](bool copy, uint64_t& checksum) {
+    AllocationCounter counter;
+    for (const auto& key : keys) {
+      if (copy) {
+        checksum += static_cast<unsigned char>(store.Get(key).string()[0]);
+      } else {
+        auto view(store.GetView(key));
+        checksum += static_cast<unsigned char>(view.data()[0]);
+      }
+    }
+    return static_cast<double>(counter.allocated_bytes()) / keys.size();
+  });
+  uint64_t copying_checksum(0), view_checksum(0);
+  auto copying_bytes(measure(true, copying_checksum));
+  auto view_bytes(measure(false, view_checksum));
+  EXPECT_LE(static_cast<double>(kChunkSize), copying_bytes);
+  EXPECT_GT(static_cast<double>(kChunkSize) / 16, view_bytes);
+  EXPECT_EQ(copying_checksum, view_checksum);
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
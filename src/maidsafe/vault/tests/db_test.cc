@@ -1,20 +1,20 @@
-///*  Copyright 2012 MaidSafe.net limited
+/*  Copyright 2012 MaidSafe.net limited
 
-//    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
-//    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
-//    licence you accepted on initial access to the Software (the "Licences").
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
 
-//    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
-//    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
-//    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
-//    available at: http://www.maidsafe.net/licenses
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
 
-//    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
-//    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
-//    OF ANY KIND, either express or implied.
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
 
-//    See the Licences for the specific language governing permissions and limitations relating to
-//    use of the MaidSafe Software.                                                                 */
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
 
 //#include <functional>
 //#include <memory>
@@ -386,3 +386,349 @@
 //}  // namespace test
 //}  // namespace vault
 //}  // namespace maidsafe
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/common/tagged_value.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/data_types/data_type_values.h"
+#include "maidsafe/routing/matrix_change.h"
+#include "maidsafe/routing/parameters.h"
+
+#include "maidsafe/vault/db.h"
+#include "maidsafe/vault/key.h"
+#include "maidsafe/vault/key_utils.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+class TestDbValue {
+ public:
+  typedef TaggedValue<NonEmptyString, struct TestDbValueTag> serialised_type;
+  explicit TestDbValue(const std::string& serialised_value) : count_(std::stoi(serialised_value)) {}
+  TestDbValue() : count_(0) {}
+  serialised_type Serialise() const {
+    return serialised_type(NonEmptyString(std::to_string(count_)));
+  }
+  void Increment() { ++count_; }
+  int count() const { return count_; }
+
+ private:
+  int count_;
+};
+
+typedef Db<Key, TestDbValue> TestDb;
+
+Key GenerateKey() {
+  return Key(Identity(RandomString(NodeId::kSize)), DataTagValue::kImmutableDataValue);
+}
+
+void Increment(boost::optional<TestDbValue>& value) {
+  if (!value)
+    value.reset(TestDbValue());
+  value->Increment();
+}
+
+std::shared_ptr<routing::MatrixChange> GenerateMatrixChange(const NodeId& this_node_id) {
+  std::vector<NodeId> old_matrix, new_matrix;
+  for (int i(0); i != 8; ++i)
+    old_matrix.push_back(NodeId(NodeId::kRandomId));
+  new_matrix = old_matrix;
+  new_matrix.push_back(NodeId(NodeId::kRandomId));
+  return std::make_shared<routing::MatrixChange>(this_node_id, old_matrix, new_matrix);
+}
+
+}  // unnamed namespace
+
+TEST(DbCommitTest, BEH_BatchCommit) {
+  TestDb db;
+  std::vector<Key> keys;
+  std::vector<std::pair<Key, TestDb::Functor>> key_functor_pairs;
+  for (int i(0); i != 100; ++i) {
+    keys.push_back(GenerateKey());
+    key_functor_pairs.push_back(std::make_pair(keys.back(), Increment));
+  }
+  // Repeated keys within one batch see the result of the preceding functor.
+  key_functor_pairs.push_back(std::make_pair(keys.front(), Increment));
+  EXPECT_NO_THROW(db.Commit(key_functor_pairs));
+  EXPECT_EQ(2, db.Get(keys.front())->count());
+  for (size_t i(1); i != keys.size(); ++i)
+    EXPECT_EQ(1, db.Get(keys[i])->count());
+
+  // A throwing functor leaves the db unmodified.
+  key_functor_pairs.push_back(std::make_pair(keys.back(),
+                                             [](boost::optional<TestDbValue>&) {
+                                               ThrowError(CommonErrors::invalid_parameter);
+                                             }));
+  EXPECT_THROW(db.Commit(key_functor_pairs), maidsafe_error);
+  EXPECT_EQ(2, db.Get(keys.front())->count());
+
+  // Resetting the value deletes the entry.
+  std::vector<std::pair<Key, TestDb::Functor>> delete_pairs;
+  for (const auto& key : keys)
+    delete_pairs.push_back(std::make_pair(key, [](boost::optional<TestDbValue>& value) {
+                                                 value.reset();
+                                               }));
+  EXPECT_NO_THROW(db.Commit(delete_pairs));
+  for (const auto& key : keys)
+    EXPECT_FALSE(db.Get(key));
+}
+
+TEST(DbCommitTest, BEH_PruneSkipsEntriesChangedDuringStream) {
+  // Fewer entries than one prune batch, so nothing is pruned until every chunk has been passed on.
+  const int kEntryCount(500);
+  TestDb db;
+  std::vector<Key> keys;
+  std::vector<std::pair<Key, TestDb::Functor>> key_functor_pairs;
+  for (int i(0); i != kEntryCount; ++i) {
+    keys.push_back(GenerateKey());
+    key_functor_pairs.push_back(std::make_pair(keys.back(), Increment));
+  }
+  db.Commit(key_functor_pairs);
+
+  // Every entry is modified after the snapshot is taken, so none may be pruned.
+  auto matrix_change(GenerateMatrixChange(NodeId(NodeId::kRandomId)));
+  bool modified(false);
+  db.StreamTransferInfo(matrix_change,
+                        [&](const NodeId&, const std::vector<TestDb::KvPair>&) {
+                          if (!modified)
+                            db.Commit(key_functor_pairs);
+                          modified = true;
+                        });
+  ASSERT_TRUE(modified);
+  for (const auto& key : keys)
+    EXPECT_EQ(2, db.Get(key)->count());
+
+  // Unmodified entries which are out of range are pruned.
+  db.StreamTransferInfo(matrix_change, [](const NodeId&, const std::vector<TestDb::KvPair>&) {});
+  int remaining_count(0);
+  for (const auto& key : keys) {
+    if (db.Get(key))
+      ++remaining_count;
+  }
+  EXPECT_LT(remaining_count, kEntryCount);
+}
+
+TEST(DbCommitTest, BEH_RangeScanMatchesFullScanWithinRanges) {
+  // As in FUNC_RangeRestrictedChurnScan, the matrix is kept smaller than a group so that nothing is
+  // pruned and the joining node is a new holder of every entry.
+  const size_t kMatrixSize(routing::Parameters::node_group_size - 2);
+  // Each changed node's range covers 1/256 of the name space.
+  std::string radius_string(NodeId::kSize, 0);
+  radius_string[1] = static_cast<char>(0x80);
+  const NodeId kRadius(radius_string);
+
+  std::vector<NodeId> old_matrix, new_matrix;
+  for (size_t i(0); i != kMatrixSize; ++i)
+    old_matrix.push_back(NodeId(NodeId::kRandomId));
+  new_matrix = old_matrix;
+  std::vector<NodeId> changed_nodes(1, new_matrix.front());
+  new_matrix.erase(std::begin(new_matrix));
+  new_matrix.push_back(NodeId(NodeId::kRandomId));
+  changed_nodes.push_back(new_matrix.back());
+  auto matrix_change(std::make_shared<routing::MatrixChange>(NodeId(NodeId::kRandomId),
+                                                             old_matrix, new_matrix));
+  auto name_ranges(detail::GetNameRangesWithinRadius(changed_nodes, kRadius));
+  ASSERT_FALSE(name_ranges.empty());
+  auto in_ranges([&name_ranges](const Key& key) -> bool {
+    NodeId name(key.name.string());
+    for (const auto& name_range : name_ranges) {
+      if (!(name < name_range.first) && !(name_range.second < name))
+        return true;
+    }
+    return false;
+  });
+
+  // Random entries, almost all outside the ranges, plus entries on each range's bounds and inside.
+  std::vector<Key> keys;
+  for (int i(0); i != 1000; ++i)
+    keys.push_back(GenerateKey());
+  for (const auto& name_range : name_ranges) {
+    keys.push_back(Key(Identity(name_range.first.string()), DataTagValue::kImmutableDataValue));
+    keys.push_back(Key(Identity(name_range.second.string()), DataTagValue::kImmutableDataValue));
+    for (int i(0); i != 10; ++i) {
+      std::string name(name_range.first.string());
+      name.replace(1, std::string::npos, RandomString(NodeId::kSize - 1));
+      keys.push_back(Key(Identity(name), DataTagValue::kImmutableDataValue));
+    }
+  }
+  std::vector<std::pair<Key, TestDb::Functor>> key_functor_pairs;
+  for (const auto& key : keys)
+    key_functor_pairs.push_back(std::make_pair(key, Increment));
+  TestDb full_scan_db, range_scan_db;
+  full_scan_db.Commit(key_functor_pairs);
+  range_scan_db.Commit(key_functor_pairs);
+
+  typedef std::set<std::pair<NodeId, Key>> Transfers;
+  Transfers full_scan_transfers, range_scan_transfers;
+  full_scan_db.StreamTransferInfo(
+      matrix_change,
+      [&](const NodeId& new_holder, const std::vector<TestDb::KvPair>& contents) {
+        for (const auto& kv_pair : contents) {
+          if (in_ranges(kv_pair.first))
+            full_scan_transfers.insert(std::make_pair(new_holder, kv_pair.first));
+        }
+      });
+  range_scan_db.StreamTransferInfo(
+      matrix_change,
+      [&](const NodeId& new_holder, const std::vector<TestDb::KvPair>& contents) {
+        for (const auto& kv_pair : contents)
+          range_scan_transfers.insert(std::make_pair(new_holder, kv_pair.first));
+      },
+      name_ranges);
+  EXPECT_FALSE(range_scan_transfers.empty());
+  EXPECT_EQ(full_scan_transfers, range_scan_transfers);
+}
+
+TEST(DbCommitTest, FUNC_BatchCommitsApplyEveryEntry) {
+  const size_t kTotalCommits(16384);
+  for (size_t batch_size : { 1, 16, 256, 4096 }) {
+    TestDb db;
+    std::vector<std::vector<std::pair<Key, TestDb::Functor>>> batches(kTotalCommits / batch_size);
+    for (auto& batch : batches) {
+      for (size_t i(0); i != batch_size; ++i)
+        batch.push_back(std::make_pair(GenerateKey(), Increment));
+    }
+    for (const auto& batch : batches)
+      db.Commit(batch);
+    for (const auto& batch : batches) {
+      for (const auto& key_functor_pair : batch)
+        ASSERT_EQ(1, db.Get(key_functor_pair.first)->count());
+    }
+  }
+}
+
+TEST(DbCommitTest, FUNC_ParallelCommits) {
+  const int kOpsPerThread(2000);
+  for (int thread_count(1); thread_count <= 32; thread_count *= 2) {
+    TestDb db;
+    std::vector<std::vector<Key>> keys(thread_count);
+    for (auto& thread_keys : keys) {
+      for (int i(0); i != kOpsPerThread / 2; ++i)
+        thread_keys.push_back(GenerateKey());
+    }
+    std::vector<std::thread> threads;
+    for (int i(0); i != thread_count; ++i) {
+      threads.push_back(std::thread([&db, &keys, i] {
+          for (const auto& key : keys[i]) {
+            db.Commit(key, Increment);
+            EXPECT_EQ(1, db.Get(key)->count());
+          }
+      }));
+    }
+    for (auto& thread : threads)
+      thread.join();
+    for (const auto& thread_keys : keys) {
+      for (const auto& key : thread_keys)
+        ASSERT_EQ(1, db.Get(key)->count());
+    }
+  }
+}
+
+TEST(DbCommitTest, FUNC_StreamTransferInfoDuringTraffic) {
+  const int kEntryCount(100000), kCommitCount(5000);
+  TestDb db;
+  std::vector<std::pair<Key, TestDb::Functor>> key_functor_pairs;
+  for (int i(0); i != kEntryCount; ++i)
+    key_functor_pairs.push_back(std::make_pair(GenerateKey(), Increment));
+  db.Commit(key_functor_pairs);
+
+  std::atomic<bool> churn_done(false);
+  size_t transferred_count(0), max_chunk_bytes(0);
+  std::thread churn([&] {
+      db.StreamTransferInfo(GenerateMatrixChange(NodeId(NodeId::kRandomId)),
+                            [&](const NodeId&, const std::vector<TestDb::KvPair>& contents) {
+                              transferred_count += contents.size();
+                              size_t chunk_bytes(0);
+                              for (const auto& kv_pair : contents)
+                                chunk_bytes += NodeId::kSize + 1 +
+                                               kv_pair.second.Serialise()->string().size();
+                              max_chunk_bytes = std::max(max_chunk_bytes, chunk_bytes);
+                            });
+      churn_done = true;
+  });
+
+  // Commits must keep being applied while the transfer info is streamed.
+  std::vector<Key> committed_keys;
+  while (!churn_done || static_cast<int>(committed_keys.size()) < kCommitCount) {
+    committed_keys.push_back(GenerateKey());
+    db.Commit(committed_keys.back(), Increment);
+  }
+  churn.join();
+  for (const auto& key : committed_keys)
+    ASSERT_EQ(1, db.Get(key)->count());
+  EXPECT_LE(max_chunk_bytes, detail::Parameters::max_transfer_chunk_bytes + 1024);
+}
+
+TEST(DbCommitTest, FUNC_RangeRestrictedChurnScan) {
+  const int kEntryCount(1000000), kChurnCount(100);
+  // Matrices are kept smaller than a group so that every entry stays in range and neither scan
+  // prunes anything; both dbs therefore hold all entries for every churn event.
+  const size_t kMatrixSize(routing::Parameters::node_group_size - 2);
+  // Each changed node's range covers 1/1024 of the name space.
+  std::string radius_string(NodeId::kSize, 0);
+  radius_string[1] = 0x20;
+  const NodeId kRadius(radius_string);
+
+  TestDb full_scan_db, range_scan_db;
+  for (int i(0); i != kEntryCount; i += 10000) {
+    std::vector<std::pair<Key, TestDb::Functor>> key_functor_pairs;
+    for (int j(0); j != 10000; ++j)
+      key_functor_pairs.push_back(std::make_pair(GenerateKey(), Increment));
+    full_scan_db.Commit(key_functor_pairs);
+    range_scan_db.Commit(key_functor_pairs);
+  }
+
+  const NodeId kThisNodeId(NodeId::kRandomId);
+  std::vector<NodeId> matrix;
+  for (size_t i(0); i != kMatrixSize; ++i)
+    matrix.push_back(NodeId(NodeId::kRandomId));
+  size_t full_scan_transferred(0), range_scan_transferred(0);
+  for (int i(0); i != kChurnCount; ++i) {
+    // One node leaves and another joins.
+    std::vector<NodeId> old_matrix(matrix);
+    std::vector<NodeId> changed_nodes(1, matrix.front());
+    matrix.erase(std::begin(matrix));
+    matrix.push_back(NodeId(NodeId::kRandomId));
+    changed_nodes.push_back(matrix.back());
+    auto matrix_change(std::make_shared<routing::MatrixChange>(kThisNodeId, old_matrix, matrix));
+
+    full_scan_db.StreamTransferInfo(
+        matrix_change,
+        [&](const NodeId&, const std::vector<TestDb::KvPair>& contents) {
+          full_scan_transferred += contents.size();
+        });
+    range_scan_db.StreamTransferInfo(
+        matrix_change,
+        [&](const NodeId&, const std::vector<TestDb::KvPair>& contents) {
+          range_scan_transferred += contents.size();
+        },
+        detail::GetNameRangesWithinRadius(changed_nodes, kRadius));
+  }
+  EXPECT_LE(range_scan_transferred, full_scan_transferred);
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -1,20 +1,20 @@
-///*  Copyright 2012 MaidSafe.net limited
+/*  Copyright 2012 MaidSafe.net limited
 
-//    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
-//    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
-//    licence you accepted on initial access to the Software (the "Licences").
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
 
-//    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
-//    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
-//    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
-//    available at: http://www.maidsafe.net/licenses
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
 
-//    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
-//    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
-//    OF ANY KIND, either express or implied.
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
 
-//    See the Licences for the specific language governing permissions and limitations relating to
-//    use of the MaidSafe Software.                                                                 */
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
 
 //#include "maidsafe/vault/demultiplexer.h"
 
@@ -560,3 +560,137 @@
 //}  // namespace vault
 
 //}  // namespace maidsafe
+
+#include <cstdint>
+#include <string>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault/demultiplexer.h"
+#include "maidsafe/vault/message_types.h"
+#include "maidsafe/vault/tests/allocation_counter.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+void AppendVarint(uint64_t value, std::string& buffer) {
+  while (value >= 0x80) {
+    buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<char>(value));
+}
+
+void AppendVarintField(uint32_t field_number, uint64_t value, std::string& buffer) {
+  AppendVarint(field_number << 3, buffer);
+  AppendVarint(value, buffer);
+}
+
+void AppendBytesField(uint32_t field_number, const std::string& value, std::string& buffer) {
+  AppendVarint((field_number << 3) | 2, buffer);
+  AppendVarint(value.size(), buffer);
+  buffer += value;
+}
+
+// Lays a wrapper out as nfs does: action, source, destination, message id, then payload.
+std::string SerialiseWrapper(nfs::Persona destination, const std::string& payload) {
+  std::string wrapper;
+  AppendVarintField(1, 1, wrapper);
+  AppendVarintField(2, static_cast<uint64_t>(nfs::Persona::kMaidNode), wrapper);
+  AppendVarintField(3, static_cast<uint64_t>(destination), wrapper);
+  AppendVarintField(4, RandomUint32(), wrapper);
+  AppendBytesField(5, payload, wrapper);
+  return wrapper;
+}
+
+}  // unnamed namespace
+
+TEST(DemultiplexerTest, BEH_PeekDestinationPersona) {
+  nfs::Persona persona(nfs::Persona::kMaidNode);
+  auto wrapper(SerialiseWrapper(nfs::Persona::kPmidNode, RandomString(1000)));
+  EXPECT_TRUE(detail::PeekDestinationPersona(wrapper, persona));
+  EXPECT_EQ(nfs::Persona::kPmidNode, persona);
+
+  // Field order doesn't matter.
+  std::string reordered;
+  AppendBytesField(5, RandomString(10), reordered);
+  AppendVarintField(3, static_cast<uint64_t>(nfs::Persona::kDataManager), reordered);
+  EXPECT_TRUE(detail::PeekDestinationPersona(reordered, persona));
+  EXPECT_EQ(nfs::Persona::kDataManager, persona);
+
+  std::string missing;
+  AppendVarintField(1, 1, missing);
+  AppendBytesField(5, RandomString(10), missing);
+  EXPECT_FALSE(detail::PeekDestinationPersona(missing, persona));
+  EXPECT_FALSE(detail::PeekDestinationPersona(std::string(), persona));
+  // Payload length running past the end of the buffer.
+  EXPECT_FALSE(detail::PeekDestinationPersona(wrapper.substr(0, wrapper.size() - 1), persona));
+  // Unterminated varint.
+  EXPECT_FALSE(detail::PeekDestinationPersona(std::string(3, static_cast<char>(0x80)), persona));
+}
+
+TEST(DemultiplexerTest, BEH_PeekNfsSerialisedWrapper) {
+  // Guards the field numbers peeked at against changes to nfs's wire layout.
+  auto check([](const std::string& serialised_message_wrapper, nfs::Persona expected_persona) {
+    nfs::Persona persona(nfs::Persona::kMaidNode);
+    nfs::MessageAction action(nfs::MessageAction::kGet);
+    EXPECT_TRUE(detail::PeekDestinationPersona(serialised_message_wrapper, persona));
+    EXPECT_EQ(expected_persona, persona);
+    EXPECT_TRUE(detail::PeekAction(serialised_message_wrapper, action));
+    EXPECT_EQ(nfs::MessageAction::kSynchronise, action);
+  });
+  const nfs_vault::Content kContent(RandomString(1000));
+  check(SynchroniseFromDataManagerToDataManager(nfs::MessageId(RandomInt32()),
+                                                kContent).Serialise(),
+        nfs::Persona::kDataManager);
+  check(SynchroniseFromMaidManagerToMaidManager(nfs::MessageId(RandomInt32()),
+                                                kContent).Serialise(),
+        nfs::Persona::kMaidManager);
+  check(SynchroniseFromPmidManagerToPmidManager(nfs::MessageId(RandomInt32()),
+                                                kContent).Serialise(),
+        nfs::Persona::kPmidManager);
+}
+
+TEST(DemultiplexerTest, FUNC_PeekVersusParseDispatchAllocations) {
+  const int kIterations(1000);
+  const std::string kWrapper(SerialiseWrapper(nfs::Persona::kPmidNode, RandomString(1 << 20)));
+  nfs::Persona persona(nfs::Persona::kMaidNode);
+
+  // What dispatch used to cost: copying the message into the posted handler and extracting the
+  // payload while parsing just to find the destination.
+  bool peeked(true);
+  uint64_t copying_allocations(0), peeking_allocations(0);
+  {
+    AllocationCounter counter;
+    for (int i(0); i != kIterations; ++i) {
+      std::string handler_copy(kWrapper);
+      std::string parsed_payload(handler_copy.substr(handler_copy.size() - (1 << 20)));
+      peeked = detail::PeekDestinationPersona(handler_copy, persona) && peeked;
+    }
+    copying_allocations = counter.allocations();
+  }
+  {
+    AllocationCounter counter;
+    for (int i(0); i != kIterations; ++i)
+      peeked = detail::PeekDestinationPersona(kWrapper, persona) && peeked;
+    peeking_allocations = counter.allocations();
+  }
+
+  EXPECT_TRUE(peeked);
+  EXPECT_EQ(nfs::Persona::kPmidNode, persona);
+  EXPECT_LE(2U * kIterations, copying_allocations);
+  EXPECT_EQ(0U, peeking_allocations);
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
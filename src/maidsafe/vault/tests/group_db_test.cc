@@ -0,0 +1,266 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/group_db.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/tagged_value.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault/group_key.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+struct TestPersona {
+  typedef TaggedValue<Identity, struct TestGroupNameTag> GroupName;
+  typedef GroupKey<GroupName> Key;
+  struct Value {
+    Value() : content() {}
+    explicit Value(const std::string& serialised_value) : content(serialised_value) {}
+    std::string Serialise() const { return content; }
+    std::string content;
+  };
+  struct Metadata {
+    Metadata() : content() {}
+    explicit Metadata(const std::string& serialised_metadata) : content(serialised_metadata) {}
+    std::string Serialise() const { return content; }
+    std::string content;
+  };
+};
+
+typedef TestPersona::GroupName GroupName;
+
+typedef TestPersona::Key Key;
+typedef TestPersona::Value Value;
+typedef TestPersona::Metadata Metadata;
+
+GroupName RandomGroupName() {
+  return GroupName(Identity(RandomString(64)));
+}
+
+Key RandomKey(const GroupName& group_name) {
+  return Key(group_name, Identity(RandomString(64)), DataTagValue::kImmutableDataValue);
+}
+
+// Sets the value to 'content' (or deletes it if empty) and appends 'content' to the metadata.
+void Update(GroupDb<TestPersona>& group_db, const Key& key, const std::string& content) {
+  group_db.Commit(key, [&](Metadata& metadata, boost::optional<Value>& value) {
+    metadata.content += content;
+    if (content.empty())
+      value.reset();
+    else
+      value = Value(content);
+  });
+}
+
+}  // unnamed namespace
+
+TEST(GroupDbTest, BEH_GroupDirectoryPersistsAndIdsAreReused) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  const boost::filesystem::path kDbPath(*test_path / "group_db");
+  std::vector<GroupName> group_names;
+  {
+    GroupDb<TestPersona> group_db(kDbPath);
+    for (int i(0); i != 10; ++i) {
+      group_names.push_back(RandomGroupName());
+      group_db.AddGroup(group_names.back(), TestPersona::Metadata());
+    }
+    EXPECT_THROW(group_db.AddGroup(group_names.front(), TestPersona::Metadata()), std::exception);
+    group_db.DeleteGroup(group_names.back());
+    group_names.pop_back();
+  }
+
+  // The directory is reloaded from the db, so existing groups are still known.
+  GroupDb<TestPersona> group_db(kDbPath);
+  for (const auto& group_name : group_names)
+    EXPECT_THROW(group_db.AddGroup(group_name, TestPersona::Metadata()), std::exception);
+  group_db.DeleteGroup(group_names.front());
+  EXPECT_NO_THROW(group_db.AddGroup(group_names.front(), TestPersona::Metadata()));
+  EXPECT_NO_THROW(group_db.AddGroup(RandomGroupName(), TestPersona::Metadata()));
+}
+
+TEST(GroupDbTest, BEH_CommitAndGet) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  const boost::filesystem::path kDbPath(*test_path / "group_db");
+  const GroupName kGroupName(RandomGroupName()), kOtherGroupName(RandomGroupName());
+  const Key kKey(RandomKey(kGroupName)), kOtherKey(RandomKey(kOtherGroupName));
+  {
+    GroupDb<TestPersona> group_db(kDbPath);
+    EXPECT_FALSE(group_db.GetMetadata(kGroupName));
+    EXPECT_THROW(Update(group_db, kKey, "a"), std::exception);
+    group_db.AddGroup(kGroupName, Metadata("m"));
+    group_db.AddGroup(kOtherGroupName, Metadata("n"));
+    ASSERT_TRUE(group_db.GetMetadata(kGroupName));
+    EXPECT_EQ("m", group_db.GetMetadata(kGroupName)->content);
+    EXPECT_FALSE(group_db.GetValue(kKey));
+
+    Update(group_db, kKey, "a");
+    Update(group_db, kOtherKey, "b");
+    ASSERT_TRUE(group_db.GetValue(kKey));
+    EXPECT_EQ("a", group_db.GetValue(kKey)->content);
+    EXPECT_EQ("ma", group_db.GetMetadata(kGroupName)->content);
+    // The same name and type in another group is a distinct value.
+    const Key kSameNameKey(kOtherGroupName, kKey.name, kKey.type);
+    EXPECT_FALSE(group_db.GetValue(kSameNameKey));
+
+    group_db.Commit(kGroupName, [](Metadata& metadata) { metadata.content += "c"; });
+    EXPECT_EQ("mac", group_db.GetMetadata(kGroupName)->content);
+    // A throwing functor leaves both the metadata and value unchanged.
+    EXPECT_THROW(group_db.Commit(kKey, [](Metadata& metadata, boost::optional<Value>& value) {
+                   metadata.content = "x";
+                   value.reset();
+                   ThrowError(CommonErrors::invalid_parameter);
+                 }), std::exception);
+    EXPECT_EQ("mac", group_db.GetMetadata(kGroupName)->content);
+    EXPECT_EQ("a", group_db.GetValue(kKey)->content);
+  }
+
+  GroupDb<TestPersona> group_db(kDbPath);
+  EXPECT_EQ("mac", group_db.GetMetadata(kGroupName)->content);
+  EXPECT_EQ("a", group_db.GetValue(kKey)->content);
+  EXPECT_EQ("b", group_db.GetValue(kOtherKey)->content);
+  Update(group_db, kKey, "");
+  EXPECT_FALSE(group_db.GetValue(kKey));
+  EXPECT_EQ("mac", group_db.GetMetadata(kGroupName)->content);
+
+  // A deleted group's values don't reappear when its GroupId is reused.
+  Update(group_db, kKey, "d");
+  group_db.DeleteGroup(kGroupName);
+  EXPECT_FALSE(group_db.GetMetadata(kGroupName));
+  group_db.AddGroup(kGroupName, Metadata("p"));
+  EXPECT_EQ("p", group_db.GetMetadata(kGroupName)->content);
+  EXPECT_FALSE(group_db.GetValue(kKey));
+  EXPECT_EQ("b", group_db.GetValue(kOtherKey)->content);
+}
+
+TEST(GroupDbTest, BEH_WriteBackCache) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  const boost::filesystem::path kDbPath(*test_path / "group_db");
+  GroupDbPolicy policy;
+  policy.metadata_cache_size = 2;
+  policy.max_unflushed_commits = 1000;
+  policy.flush_interval = std::chrono::steady_clock::duration::zero();
+  std::vector<GroupName> group_names;
+  std::vector<Key> keys;
+  GroupDb<TestPersona> group_db(kDbPath, detail::Parameters::db_lock_stripe_count, policy);
+  for (int i(0); i != 3; ++i) {
+    group_names.push_back(RandomGroupName());
+    keys.push_back(RandomKey(group_names.back()));
+    group_db.AddGroup(group_names.back(), Metadata());
+  }
+  // Adding the third group evicted the first, which had to be flushed first.
+  EXPECT_EQ(1U, group_db.stats().flushes);
+  EXPECT_EQ(1U, group_db.stats().evicted);
+
+  // Hot metadata is served from the cache, and updates are held until the next flush.
+  for (int i(0); i != 10; ++i)
+    Update(group_db, keys[2], "a");
+  EXPECT_EQ(1U, group_db.stats().flushes);
+  EXPECT_EQ(10U, group_db.stats().metadata_hits);
+  EXPECT_EQ(std::string(10, 'a'), group_db.GetMetadata(group_names[2])->content);
+  EXPECT_EQ("a", group_db.GetValue(keys[2])->content);
+  group_db.Flush();
+  Update(group_db, keys[1], "b");
+  Update(group_db, keys[2], "");
+
+  // Copying the db's files mimics a crash: only the flushed updates are recovered.
+  const boost::filesystem::path kCopyPath(*test_path / "copy");
+  boost::filesystem::create_directory(kCopyPath);
+  for (boost::filesystem::directory_iterator itr(kDbPath);
+       itr != boost::filesystem::directory_iterator(); ++itr) {
+    boost::filesystem::copy_file(itr->path(), kCopyPath / itr->path().filename());
+  }
+  {
+    GroupDb<TestPersona> recovered(kCopyPath, detail::Parameters::db_lock_stripe_count, policy);
+    EXPECT_EQ(std::string(10, 'a'), recovered.GetMetadata(group_names[2])->content);
+    EXPECT_EQ("a", recovered.GetValue(keys[2])->content);
+    EXPECT_EQ("", recovered.GetMetadata(group_names[1])->content);
+    EXPECT_FALSE(recovered.GetValue(keys[1]));
+  }
+
+  // A deleted group's unflushed updates aren't written later.
+  group_db.DeleteGroup(group_names[1]);
+  group_db.Flush();
+  group_db.AddGroup(group_names[1], Metadata("c"));
+  EXPECT_FALSE(group_db.GetValue(keys[1]));
+  EXPECT_EQ("c", group_db.GetMetadata(group_names[1])->content);
+  EXPECT_FALSE(group_db.GetValue(keys[2]));
+}
+
+TEST(GroupDbTest, FUNC_ManyCommits) {
+  const int kGroupCount(100), kKeysPerGroup(100), kCommitCount(100000);
+  GroupDb<TestPersona> group_db;
+  std::vector<GroupName> group_names;
+  std::vector<Key> keys;
+  for (int i(0); i != kGroupCount; ++i) {
+    group_names.push_back(RandomGroupName());
+    group_db.AddGroup(group_names.back(), Metadata(RandomString(100)));
+    for (int j(0); j != kKeysPerGroup; ++j)
+      keys.push_back(RandomKey(group_names.back()));
+  }
+  const std::string kContent(RandomString(100));
+  for (int i(0); i != kCommitCount; ++i) {
+    group_db.Commit(keys[i % keys.size()],
+                    [&](Metadata& metadata, boost::optional<Value>& value) {
+                      metadata.content[0] = static_cast<char>(i);
+                      value = Value(kContent);
+                    });
+  }
+  for (const auto& key : keys)
+    EXPECT_EQ(kContent, group_db.GetValue(key)->content);
+  // Each group's metadata holds the index of the last commit to one of its keys.
+  const int kLastRound(kCommitCount - kGroupCount * kKeysPerGroup);
+  for (int i(0); i != kGroupCount; ++i) {
+    EXPECT_EQ(static_cast<char>(kLastRound + (i + 1) * kKeysPerGroup - 1),
+              group_db.GetMetadata(group_names[i])->content[0]);
+  }
+}
+
+TEST(GroupDbTest, FUNC_AddGroupUpToLimit) {
+  // One GroupId is reserved for the group directory.
+  const int kGroupsLimit(65535);
+  GroupDb<TestPersona> group_db;
+  std::vector<GroupName> group_names;
+  group_names.reserve(kGroupsLimit);
+  for (int i(0); i != kGroupsLimit; ++i) {
+    group_names.push_back(RandomGroupName());
+    group_db.AddGroup(group_names.back(), TestPersona::Metadata());
+  }
+
+  EXPECT_THROW(group_db.AddGroup(RandomGroupName(), TestPersona::Metadata()), std::exception);
+  group_db.DeleteGroup(group_names[kGroupsLimit / 2]);
+  EXPECT_NO_THROW(group_db.AddGroup(RandomGroupName(), TestPersona::Metadata()));
+  EXPECT_THROW(group_db.AddGroup(RandomGroupName(), TestPersona::Metadata()), std::exception);
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
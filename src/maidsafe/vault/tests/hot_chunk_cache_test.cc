@@ -0,0 +1,160 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/hot_chunk_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/data_types/immutable_data.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+DataNameVariant RandomName() {
+  return DataNameVariant(ImmutableData::Name(Identity(RandomString(64))));
+}
+
+}  // unnamed namespace
+
+TEST(HotChunkCacheTest, BEH_PutGetErase) {
+  HotChunkCache cache(1024 * 1024, 4);
+  auto name(RandomName());
+  NonEmptyString content(RandomString(1024));
+  EXPECT_TRUE(cache.Get(name) == nullptr);
+  EXPECT_TRUE(cache.Put(name, content));
+  auto cached(cache.Get(name));
+  ASSERT_TRUE(cached != nullptr);
+  EXPECT_EQ(content, *cached);
+
+  NonEmptyString new_content(RandomString(2048));
+  EXPECT_TRUE(cache.Put(name, new_content));
+  EXPECT_EQ(new_content, *cache.Get(name));
+  // The old content is still valid for a reader holding it.
+  EXPECT_EQ(content, *cached);
+  EXPECT_EQ(2048U, cache.stats().bytes);
+  // Content too large for a shard is refused without dropping the entry it would have replaced.
+  EXPECT_FALSE(cache.Put(name, NonEmptyString(RandomString(512 * 1024))));
+  EXPECT_EQ(new_content, *cache.Get(name));
+  EXPECT_EQ(2048U, cache.stats().bytes);
+
+  cache.Erase(name);
+  EXPECT_TRUE(cache.Get(name) == nullptr);
+  EXPECT_EQ(0U, cache.stats().bytes);
+  EXPECT_EQ(0U, cache.stats().count);
+  EXPECT_THROW(cache.Put(name, HotChunkCache::Value()), std::exception);
+}
+
+TEST(HotChunkCacheTest, BEH_ByteCapacityAndAdmission) {
+  const size_t kChunkSize(1024);
+  HotChunkCache cache(4 * kChunkSize, 1);
+  std::vector<DataNameVariant> hot_names;
+  for (int i(0); i != 4; ++i) {
+    hot_names.push_back(RandomName());
+    EXPECT_TRUE(cache.Put(hot_names.back(), NonEmptyString(RandomString(kChunkSize))));
+  }
+  for (int i(0); i != 3; ++i) {
+    for (const auto& name : hot_names)
+      EXPECT_TRUE(cache.Get(name) != nullptr);
+  }
+  EXPECT_FALSE(cache.Put(RandomName(), NonEmptyString(RandomString(kChunkSize + 1))));
+  EXPECT_EQ(4 * kChunkSize, cache.stats().bytes);
+
+  // A never-requested chunk doesn't displace the hot ones...
+  EXPECT_FALSE(cache.Put(RandomName(), NonEmptyString(RandomString(kChunkSize))));
+  for (const auto& name : hot_names)
+    EXPECT_TRUE(cache.Get(name) != nullptr);
+
+  // ...but one requested more often than them does, evicting exactly one of them.
+  auto popular_name(RandomName());
+  for (int i(0); i != 10; ++i)
+    EXPECT_TRUE(cache.Get(popular_name) == nullptr);
+  EXPECT_TRUE(cache.Put(popular_name, NonEmptyString(RandomString(kChunkSize))));
+  EXPECT_TRUE(cache.Get(popular_name) != nullptr);
+  auto stats(cache.stats());
+  EXPECT_EQ(4U, stats.count);
+  EXPECT_EQ(4 * kChunkSize, stats.bytes);
+  EXPECT_EQ(1U, stats.evicted);
+  EXPECT_EQ(2U, stats.rejected);
+  EXPECT_EQ(5U, stats.admitted);
+
+  // An oversized chunk is rejected outright.
+  EXPECT_FALSE(cache.Put(popular_name, NonEmptyString(RandomString(4 * kChunkSize + 1))));
+}
+
+TEST(HotChunkCacheTest, FUNC_ZipfWorkload) {
+  // Read-through GETs of 4 KiB chunks with Zipf(0.99) popularity, against a cache holding 10% of
+  // them.  The ideal hit ratio is the share of requests for the most popular 10%.
+  const size_t kNameCount(10000), kChunkSize(4096), kRequestsPerThread(100000);
+  const double kSkew(0.99);
+  std::vector<DataNameVariant> names;
+  std::vector<double> cumulative;
+  double total(0);
+  for (size_t i(0); i != kNameCount; ++i) {
+    names.push_back(RandomName());
+    total += 1.0 / std::pow(static_cast<double>(i + 1), kSkew);
+    cumulative.push_back(total);
+  }
+  for (auto& probability : cumulative)
+    probability /= total;
+  const double kIdealHitRatio(cumulative[kNameCount / 10 - 1]);
+  auto content(std::make_shared<const NonEmptyString>(RandomString(kChunkSize)));
+
+  for (size_t thread_count(1); thread_count <= 16; thread_count *= 4) {
+    HotChunkCache cache(kNameCount * kChunkSize / 10);
+    std::vector<std::thread> threads;
+    for (size_t i(0); i != thread_count; ++i) {
+      threads.push_back(std::thread([&, i] {
+        std::mt19937 generator(static_cast<std::mt19937::result_type>(i));
+        std::uniform_real_distribution<double> distribution(0.0, 1.0);
+        for (size_t request(0); request != kRequestsPerThread; ++request) {
+          auto rank(std::min(static_cast<size_t>(
+                        std::upper_bound(std::begin(cumulative), std::end(cumulative),
+                                         distribution(generator)) - std::begin(cumulative)),
+                             kNameCount - 1));
+          if (!cache.Get(names[rank]))
+            cache.Put(names[rank], content);
+        }
+      }));
+    }
+    for (auto& thread : threads)
+      thread.join();
+    auto stats(cache.stats());
+    ASSERT_EQ(thread_count * kRequestsPerThread, stats.hits + stats.misses);
+    double hit_ratio(static_cast<double>(stats.hits) / (stats.hits + stats.misses));
+    EXPECT_LE(stats.bytes, cache.capacity_bytes());
+    EXPECT_GT(hit_ratio, kIdealHitRatio * 0.8);
+  }
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
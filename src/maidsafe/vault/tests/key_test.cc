@@ -0,0 +1,92 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/key.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault/tests/allocation_counter.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+TEST(KeyTest, BEH_FixedWidthEncoding) {
+  for (uint32_t number : std::vector<uint32_t>{ 0, 1, 255, 256, 65534, 65535 }) {
+    char encoded[2];
+    detail::EncodeFixedWidth<2>(number, encoded);
+    EXPECT_EQ(number, detail::DecodeFixedWidth<2>(encoded));
+    EXPECT_EQ(std::string(encoded, 2), detail::ToFixedWidthString<2>(number));
+    EXPECT_EQ(number, detail::FromFixedWidthString<2>(std::string(encoded, 2)));
+  }
+
+  const Key kKey(Identity(RandomString(NodeId::kSize)), DataTagValue::kImmutableDataValue);
+  auto buffer(kKey.ToFixedWidthBuffer());
+  EXPECT_EQ(kKey.name.string() +
+                detail::ToFixedWidthString<detail::PaddedWidth::value>(
+                    static_cast<uint32_t>(kKey.type)),
+            buffer.string());
+  EXPECT_EQ(buffer.string(), kKey.ToFixedWidthString().string());
+  EXPECT_EQ(kKey, Key(Key::FixedWidthView(buffer.slice())));
+  EXPECT_EQ(kKey, Key(kKey.ToFixedWidthString()));
+
+  // Encoded keys sort in the same order as the keys themselves.
+  const Key kOther(Identity(RandomString(NodeId::kSize)), DataTagValue::kPmidValue);
+  EXPECT_EQ(kKey < kOther,
+            kKey.ToFixedWidthBuffer().slice().compare(kOther.ToFixedWidthBuffer().slice()) < 0);
+  const Key kSameName(kKey.name, DataTagValue::kPmidValue);
+  EXPECT_EQ(kKey < kSameName,
+            kKey.ToFixedWidthBuffer().slice().compare(kSameName.ToFixedWidthBuffer().slice()) < 0);
+}
+
+TEST(KeyTest, FUNC_EncodeAllocations) {
+  const size_t kKeyCount(100000);
+  std::vector<Key> keys;
+  keys.reserve(kKeyCount);
+  for (size_t i(0); i != kKeyCount; ++i)
+    keys.push_back(Key(Identity(RandomString(NodeId::kSize)), DataTagValue::kImmutableDataValue));
+
+  auto encode([&](bool use_buffer, uint64_t& checksum)->uint64_t {
+    AllocationCounter counter;
+    for (const auto& key : keys) {
+      if (use_buffer)
+        checksum += static_cast<unsigned char>(key.ToFixedWidthBuffer().slice()[0]);
+      else
+        checksum += static_cast<unsigned char>(key.ToFixedWidthString().string()[0]);
+    }
+    return counter.allocations();
+  });
+  uint64_t string_checksum(0), buffer_checksum(0);
+  EXPECT_LE(kKeyCount, encode(false, string_checksum));
+  EXPECT_EQ(0U, encode(true, buffer_checksum));
+  EXPECT_EQ(string_checksum, buffer_checksum);
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
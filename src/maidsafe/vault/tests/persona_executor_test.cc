@@ -0,0 +1,238 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/persona_executor.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+TEST(PersonaExecutorTest, BEH_SheddingPolicies) {
+  for (auto shedding_policy : { SheddingPolicy::kRejectNewest, SheddingPolicy::kDropOldest }) {
+    WorkStealingPool pool(1);
+    PersonaExecutor executor("Test", pool, PersonaExecutorPolicy(3, shedding_policy));
+    std::promise<void> unblock;
+    std::shared_future<void> unblocked(unblock.get_future().share());
+    std::promise<void> blocking;
+    EXPECT_TRUE(executor.Post(Lane::kPut, 0, [&] { blocking.set_value(); unblocked.wait(); }));
+    blocking.get_future().wait();
+
+    std::mutex mutex;
+    std::vector<int> ran;
+    for (int i(0); i != 5; ++i) {
+      bool posted(executor.Post(Lane::kPut, 0, [&, i] {
+                                  std::lock_guard<std::mutex> lock(mutex);
+                                  ran.push_back(i);
+                                }));
+      EXPECT_EQ(i < 3 || shedding_policy == SheddingPolicy::kDropOldest, posted);
+    }
+    auto stats(executor.stats());
+    EXPECT_EQ(3U, stats.queue_depth);
+    EXPECT_EQ(3U, stats.max_queue_depth);
+    EXPECT_EQ(2U, stats.shed);
+
+    unblock.set_value();
+    while (executor.stats().executed != 4U)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::lock_guard<std::mutex> lock(mutex);
+    if (shedding_policy == SheddingPolicy::kRejectNewest)
+      EXPECT_EQ(std::vector<int>({ 0, 1, 2 }), ran);
+    else
+      EXPECT_EQ(std::vector<int>({ 2, 3, 4 }), ran);
+  }
+}
+
+TEST(PersonaExecutorTest, BEH_StalledPersonaDoesntBlockOthers) {
+  WorkStealingPool pool(2);
+  const PersonaExecutorPolicy kPolicy(10, SheddingPolicy::kRejectNewest);
+  PersonaExecutor stalled("Stalled", pool, kPolicy);
+  PersonaExecutor other("Other", pool, kPolicy);
+  std::promise<void> unblock;
+  std::shared_future<void> unblocked(unblock.get_future().share());
+  // Two handed to the pool (one running, one behind it on the same strand) and ten queued fill it.
+  for (int i(0); i != 12; ++i)
+    stalled.Post(Lane::kPut, 0, [unblocked] { unblocked.wait(); });
+
+  std::atomic<int> other_count(0);
+  for (int i(1); i != 11; ++i)
+    EXPECT_TRUE(other.Post(Lane::kPut, i, [&] { ++other_count; }));
+  for (int i(0); i != 1000 && other_count != 10; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(10, other_count.load());
+  EXPECT_FALSE(stalled.Post(Lane::kPut, 0, [] {}));
+
+  unblock.set_value();
+  other.Stop();
+  EXPECT_FALSE(other.Post(Lane::kPut, [] {}));
+}
+
+TEST(PersonaExecutorTest, BEH_StalledPersonaLeavesPoolThreads) {
+  // Four threads and sixteen strands, so affinities below 16 each get their own strand.
+  WorkStealingPool pool(4, 4);
+  PersonaExecutor stalled("Stalled", pool, PersonaExecutorPolicy(), 2);
+  PersonaExecutor other("Other", pool, PersonaExecutorPolicy(), 2);
+  std::promise<void> unblock;
+  std::shared_future<void> unblocked(unblock.get_future().share());
+  // Each blocking task is on its own strand, so without a share limit they'd occupy every thread.
+  std::atomic<int> blocked_count(0);
+  for (uint64_t affinity(0); affinity != 10; ++affinity) {
+    EXPECT_TRUE(stalled.Post(Lane::kPut, affinity, [&blocked_count, unblocked] {
+                                                     ++blocked_count;
+                                                     unblocked.wait();
+                                                   }));
+  }
+  for (int i(0); i != 1000 && blocked_count != 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  std::atomic<int> other_count(0);
+  for (uint64_t affinity(10); affinity != 16; ++affinity)
+    EXPECT_TRUE(other.Post(Lane::kPut, affinity, [&] { ++other_count; }));
+  for (int i(0); i != 1000 && other_count != 6; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(6, other_count.load());
+  // Only the stalled executor's share of the threads was handed its tasks.
+  EXPECT_EQ(2, blocked_count.load());
+  EXPECT_EQ(8U, stalled.stats().queue_depth);
+
+  unblock.set_value();
+  for (int i(0); i != 1000 && stalled.stats().executed != 10U; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(10, blocked_count.load());
+}
+
+TEST(PersonaExecutorTest, BEH_FailingTaskIsCounted) {
+  WorkStealingPool pool(2);
+  PersonaExecutor executor("Test", pool);
+  executor.Post(Lane::kPut, [] { throw std::runtime_error("Failed"); });
+  executor.Post(Lane::kPut, [] {});
+  while (executor.stats().executed != 2U)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(1U, executor.stats().failed);
+}
+
+TEST(PersonaExecutorTest, BEH_SameAffinityRunsInOrder) {
+  // Tasks are handed to the pool both by Post and by finishing tasks on the pool's threads; those
+  // hand-offs mustn't reorder a strand's tasks.
+  const int kTaskCount(20000);
+  WorkStealingPool pool(4);
+  PersonaExecutor executor("Test", pool, PersonaExecutorPolicy(kTaskCount * 2,
+                                                                SheddingPolicy::kRejectNewest));
+  std::vector<int> ran;
+  std::atomic<int> other_count(0);
+  for (int i(0); i != kTaskCount; ++i) {
+    // Only tasks with affinity 0 touch 'ran', and they never run concurrently.
+    EXPECT_TRUE(executor.Post(Lane::kPut, 0, [&ran, i] { ran.push_back(i); }));
+    EXPECT_TRUE(executor.Post(Lane::kPut, i % 7 + 1, [&] { ++other_count; }));
+  }
+  while (executor.stats().executed != kTaskCount * 2U)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  ASSERT_EQ(static_cast<size_t>(kTaskCount), ran.size());
+  for (int i(0); i != kTaskCount; ++i)
+    ASSERT_EQ(i, ran[i]);
+}
+
+TEST(PersonaExecutorTest, BEH_PriorityLanes) {
+  WorkStealingPool pool(1);
+  PersonaExecutor executor("Test", pool);
+  std::promise<void> unblock;
+  std::shared_future<void> unblocked(unblock.get_future().share());
+  std::promise<void> blocking;
+  executor.Post(Lane::kPut, [&] { blocking.set_value(); unblocked.wait(); });
+  blocking.get_future().wait();
+
+  std::mutex mutex;
+  std::vector<Lane> ran;
+  auto record([&](Lane lane) {
+                return [&, lane] {
+                  std::lock_guard<std::mutex> lock(mutex);
+                  ran.push_back(lane);
+                };
+              });
+  for (auto lane : { Lane::kPut, Lane::kGet, Lane::kSync, Lane::kControl, Lane::kPut })
+    EXPECT_TRUE(executor.Post(lane, record(lane)));
+  EXPECT_EQ(2U, executor.stats().lanes[static_cast<size_t>(Lane::kPut)].queue_depth);
+
+  unblock.set_value();
+  while (executor.stats().executed != 6U)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(std::vector<Lane>({ Lane::kControl, Lane::kSync, Lane::kGet, Lane::kPut, Lane::kPut }),
+            ran);
+  auto stats(executor.stats());
+  EXPECT_EQ(1U, stats.lanes[static_cast<size_t>(Lane::kControl)].wait_latency.count());
+  EXPECT_EQ(3U, stats.lanes[static_cast<size_t>(Lane::kPut)].wait_latency.count());
+}
+
+TEST(PersonaExecutorTest, BEH_StarvationProtectionAndShedding) {
+  WorkStealingPool pool(1);
+  PersonaExecutorPolicy policy(4, SheddingPolicy::kRejectNewest);
+  policy.max_lane_wait = std::chrono::milliseconds(50);
+  PersonaExecutor executor("Test", pool, policy);
+  std::promise<void> unblock;
+  std::shared_future<void> unblocked(unblock.get_future().share());
+  std::promise<void> blocking;
+  executor.Post(Lane::kControl, [&] { blocking.set_value(); unblocked.wait(); });
+  blocking.get_future().wait();
+
+  std::mutex mutex;
+  std::vector<Lane> ran;
+  auto record([&](Lane lane) {
+                return [&, lane] {
+                  std::lock_guard<std::mutex> lock(mutex);
+                  ran.push_back(lane);
+                };
+              });
+  EXPECT_TRUE(executor.Post(Lane::kPut, record(Lane::kPut)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  EXPECT_TRUE(executor.Post(Lane::kPut, record(Lane::kPut)));
+  EXPECT_TRUE(executor.Post(Lane::kControl, record(Lane::kControl)));
+  EXPECT_TRUE(executor.Post(Lane::kControl, record(Lane::kControl)));
+  // The queue is full: a further PUT is rejected, while a sync task displaces the newest PUT.
+  EXPECT_FALSE(executor.Post(Lane::kPut, record(Lane::kPut)));
+  EXPECT_TRUE(executor.Post(Lane::kSync, record(Lane::kSync)));
+  auto stats(executor.stats());
+  EXPECT_EQ(2U, stats.lanes[static_cast<size_t>(Lane::kPut)].shed);
+  EXPECT_EQ(1U, stats.lanes[static_cast<size_t>(Lane::kPut)].queue_depth);
+  EXPECT_EQ(4U, stats.queue_depth);
+
+  unblock.set_value();
+  while (executor.stats().executed != 5U)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  // The first PUT has waited too long, so runs ahead of the control and sync tasks.
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(std::vector<Lane>({ Lane::kPut, Lane::kControl, Lane::kControl, Lane::kSync }), ran);
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
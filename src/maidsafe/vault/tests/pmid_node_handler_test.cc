@@ -0,0 +1,51 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/pmid_node/handler.h"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/data_types/immutable_data.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+TEST(PmidNodeHandlerTest, BEH_Cache) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  PmidNodeHandler handler(*test_path);
+
+  ImmutableData data(NonEmptyString(RandomString(1024)));
+  DataNameVariant data_name(data.name());
+  static_assert(is_cacheable<ImmutableData>::value, "ImmutableData should be cacheable.");
+  EXPECT_THROW(handler.GetFromCache(data_name), std::exception);
+  handler.StoreInCache(data_name, data.data());
+  EXPECT_EQ(data.data(), handler.GetFromCache(data_name));
+  // Re-caching the same data is harmless.
+  EXPECT_NO_THROW(handler.StoreInCache(data_name, data.data()));
+  EXPECT_EQ(data.data(), handler.GetFromCache(data_name));
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -0,0 +1,244 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/pmid_node/segment_store.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/data_store/permanent_store.h"
+#include "maidsafe/data_types/immutable_data.h"
+
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+const DiskUsage kMaxDiskUsage(std::numeric_limits<uint64_t>::max());
+
+uint64_t FileCount(const fs::path& directory) {
+  uint64_t count(0);
+  for (fs::recursive_directory_iterator itr(directory);
+       itr != fs::recursive_directory_iterator(); ++itr) {
+    if (fs::is_regular_file(itr->status()))
+      ++count;
+  }
+  return count;
+}
+
+}  // unnamed namespace
+
+TEST(SegmentStoreTest, BEH_PutGetDeleteAndRecover) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  std::map<std::string, NonEmptyString> expected;
+  {
+    SegmentStore store(*test_path, kMaxDiskUsage);
+    for (int i(0); i != 20; ++i) {
+      std::string key(RandomString(65));
+      expected.insert(std::make_pair(key, NonEmptyString(RandomString(1 + i * 100))));
+      store.Put(key, expected[key]);
+    }
+    auto overwritten(std::begin(expected)->first);
+    expected[overwritten] = NonEmptyString(RandomString(500));
+    store.Put(overwritten, expected[overwritten]);
+    auto deleted(std::next(std::begin(expected))->first);
+    store.Delete(deleted);
+    expected.erase(deleted);
+    EXPECT_THROW(store.Get(deleted), std::exception);
+    EXPECT_THROW(store.Delete(deleted), std::exception);
+    for (const auto& key_and_content : expected)
+      EXPECT_EQ(key_and_content.second, store.Get(key_and_content.first));
+    EXPECT_EQ(expected.size(), store.stats().live_count);
+    store.Sync();
+  }
+
+  // Simulate a write torn by a crash.
+  auto segment(*fs::directory_iterator(*test_path));
+  {
+    std::FILE* file(std::fopen(segment.path().string().c_str(), "ab"));
+    ASSERT_TRUE(file != nullptr);
+    std::string torn(RandomString(10));
+    std::fwrite(torn.data(), 1, torn.size(), file);
+    std::fclose(file);
+  }
+
+  SegmentStore store(*test_path, kMaxDiskUsage);
+  EXPECT_EQ(expected.size(), store.stats().live_count);
+  for (const auto& key_and_content : expected)
+    EXPECT_EQ(key_and_content.second, store.Get(key_and_content.first));
+  std::string key(RandomString(65));
+  NonEmptyString content(RandomString(100));
+  store.Put(key, content);
+  EXPECT_EQ(content, store.Get(key));
+}
+
+TEST(SegmentStoreTest, BEH_Compaction) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  const size_t kChunkSize(512);
+  std::vector<std::string> keys;
+  {
+    // Each segment holds a handful of chunks.  The compaction threshold can't be reached until the
+    // test deletes chunks, and the background thread may race the explicit Compact below.
+    SegmentStore store(*test_path, kMaxDiskUsage, 4 * 1024, 0.5);
+    for (int i(0); i != 40; ++i) {
+      keys.push_back(RandomString(64));
+      store.Put(keys.back(), NonEmptyString(RandomString(kChunkSize)));
+    }
+    auto segment_count(store.stats().segments);
+    EXPECT_LT(5U, segment_count);
+    // Delete three-quarters of the chunks.
+    for (size_t i(0); i != keys.size(); ++i) {
+      if (i % 4 != 0)
+        store.Delete(keys[i]);
+    }
+    store.Compact();
+    auto stats(store.stats());
+    EXPECT_LT(0U, stats.compactions);
+    EXPECT_GT(segment_count, stats.segments);
+    EXPECT_EQ(10U, stats.live_count);
+    EXPECT_EQ(10 * kChunkSize, stats.live_bytes);
+    EXPECT_EQ(stats.segments, FileCount(*test_path));
+    for (size_t i(0); i != keys.size(); ++i) {
+      if (i % 4 == 0)
+        EXPECT_NO_THROW(store.Get(keys[i]));
+      else
+        EXPECT_THROW(store.Get(keys[i]), std::exception);
+    }
+  }
+
+  // Deletes survive compaction of the segments holding their tombstones.
+  SegmentStore store(*test_path, kMaxDiskUsage, 4 * 1024, 0.5);
+  EXPECT_EQ(10U, store.stats().live_count);
+  for (size_t i(0); i != keys.size(); ++i) {
+    if (i % 4 == 0)
+      EXPECT_NO_THROW(store.Get(keys[i]));
+    else
+      EXPECT_THROW(store.Get(keys[i]), std::exception);
+  }
+
+  // A tombstone isn't carried forward over a later put of its key.  Each record fills a segment,
+  // so segment 0 holds 'kept_key', 1 the first put of 'key', 2 its tombstone and 3 its second put.
+  maidsafe::test::TestPath reput_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  const uint64_t kRecordSize(SegmentStore::RecordSize(64, kChunkSize));
+  const std::string kept_key(RandomString(64)), key(RandomString(64));
+  const NonEmptyString content(RandomString(kChunkSize));
+  {
+    SegmentStore reput_store(*reput_path, kMaxDiskUsage, kRecordSize, 0.5);
+    reput_store.Put(kept_key, NonEmptyString(RandomString(kChunkSize)));
+    reput_store.Put(key, NonEmptyString(RandomString(kChunkSize)));
+    reput_store.Delete(key);
+    reput_store.Put(key, content);
+    reput_store.Compact();
+    EXPECT_EQ(content, reput_store.Get(key));
+  }
+  SegmentStore reput_store(*reput_path, kMaxDiskUsage, kRecordSize, 0.5);
+  EXPECT_EQ(2U, reput_store.stats().live_count);
+  EXPECT_NO_THROW(reput_store.Get(kept_key));
+  EXPECT_EQ(content, reput_store.Get(key));
+}
+
+TEST(SegmentStoreTest, BEH_DiskUsageAndReservations) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+  const uint64_t kRecordSize(SegmentStore::RecordSize(64, 1000));
+  std::vector<std::string> keys;
+  {
+    SegmentStore store(*test_path, DiskUsage(3 * kRecordSize), kRecordSize, 0.5);
+    EXPECT_TRUE(store.Reserve(2 * kRecordSize));
+    EXPECT_FALSE(store.Reserve(2 * kRecordSize));
+    for (int i(0); i != 2; ++i) {
+      keys.push_back(RandomString(64));
+      store.Put(keys.back(), NonEmptyString(RandomString(1000)), kRecordSize);
+      // The reservation moves to disk usage, so the chunk isn't counted twice.
+      EXPECT_EQ((i + 1) * kRecordSize, store.stats().disk_usage);
+      EXPECT_EQ((1 - i) * kRecordSize, store.stats().reserved);
+    }
+    EXPECT_TRUE(store.Reserve(kRecordSize));
+    EXPECT_FALSE(store.Reserve(1));
+    store.Release(kRecordSize);
+    EXPECT_EQ(0U, store.stats().reserved);
+
+    // Deleting only frees space once the deleted chunk's segment is compacted away.
+    // Each record fills a segment, so the tombstone starts a third one.
+    store.Delete(keys.front());
+    store.Compact();
+    EXPECT_EQ(kRecordSize + SegmentStore::RecordSize(64, 0), store.stats().disk_usage);
+    keys.erase(std::begin(keys));
+  }
+
+  // Usage is recovered from the segments' sizes.
+  uint64_t file_bytes(0);
+  for (fs::directory_iterator itr(*test_path); itr != fs::directory_iterator(); ++itr)
+    file_bytes += fs::file_size(itr->path());
+  SegmentStore store(*test_path, DiskUsage(3 * kRecordSize), kRecordSize, 0.5);
+  EXPECT_EQ(file_bytes, store.stats().disk_usage);
+  EXPECT_NO_THROW(store.Get(keys.front()));
+}
+
+TEST(SegmentStoreTest, FUNC_FilesPerChunkVersusSegmentLog) {
+  // Scaled down from the target of 10M chunks, which needs 640 GB of disk.
+  const size_t kChunkSize(64 * 1024), kChunkCount(2000);
+  std::vector<ImmutableData::Name> names;
+  for (size_t i(0); i != kChunkCount; ++i)
+    names.push_back(ImmutableData::Name(Identity(RandomString(64))));
+  const NonEmptyString kContent(RandomString(kChunkSize));
+
+  {
+    maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+    data_store::PermanentStore store(*test_path / "permanent",
+                                     DiskUsage(2 * kChunkCount * kChunkSize));
+    for (const auto& name : names)
+      store.Put(name, kContent);
+    for (const auto& name : names)
+      ASSERT_EQ(kContent, store.Get(name));
+    EXPECT_LE(kChunkCount, FileCount(*test_path));
+  }
+  {
+    maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_Test_Vault"));
+    SegmentStore store(*test_path / "permanent", kMaxDiskUsage);
+    for (const auto& name : names)
+      store.Put(name.value.string(), kContent);
+    store.Sync();
+    for (const auto& name : names)
+      ASSERT_EQ(kContent, store.Get(name.value.string()));
+    // Every chunk fits in the first segment.
+    EXPECT_EQ(1U, store.stats().segments);
+    EXPECT_EQ(1U, FileCount(*test_path));
+  }
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
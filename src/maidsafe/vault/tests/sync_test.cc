@@ -0,0 +1,309 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/sync.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/data_types/data_type_values.h"
+#include "maidsafe/routing/parameters.h"
+
+#include "maidsafe/vault/key.h"
+#include "maidsafe/vault/sync_coalescer.h"
+#include "maidsafe/vault/sync_scheduler.h"
+#include "maidsafe/vault/unresolved_action.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+namespace {
+
+struct TestAction {};
+
+typedef UnresolvedAction<Key, TestAction> TestUnresolvedAction;
+
+Key GenerateKey() {
+  return Key(Identity(RandomString(NodeId::kSize)), DataTagValue::kImmutableDataValue);
+}
+
+TestUnresolvedAction MakePeerAction(const Key& key, const NodeId& peer, int32_t entry_id) {
+  TestUnresolvedAction unresolved_action(key, TestAction(), NodeId(), 0);
+  unresolved_action.peer_and_entry_ids.push_back(std::make_pair(peer, entry_id));
+  return unresolved_action;
+}
+
+}  // unnamed namespace
+
+TEST(SyncTest, BEH_AddAndResolve) {
+  Sync<TestUnresolvedAction> sync;
+  const NodeId kThisNodeId(NodeId::kRandomId);
+  const Key kKey(GenerateKey());
+  sync.AddLocalAction(TestUnresolvedAction(kKey, TestAction(), kThisNodeId, 1));
+  // A repeated local action is ignored.
+  sync.AddLocalAction(TestUnresolvedAction(kKey, TestAction(), kThisNodeId, 1));
+  EXPECT_EQ(1U, sync.size());
+
+  auto unresolved_actions(sync.GetUnresolvedActions());
+  ASSERT_EQ(1U, unresolved_actions.size());
+  EXPECT_TRUE(unresolved_actions.front().sent_to_peers);
+  EXPECT_EQ(kThisNodeId, unresolved_actions.front().this_node_and_entry_id.first);
+
+  // The action is reported as resolved exactly once, when a majority of the group holds it.
+  int resolved_count(0);
+  for (uint16_t i(0); i != routing::Parameters::node_group_size - 1; ++i) {
+    auto peer_action(MakePeerAction(kKey, NodeId(NodeId::kRandomId), i));
+    if (sync.AddUnresolvedAction(peer_action))
+      ++resolved_count;
+    // Repeated peer messages are ignored.
+    if (i == 0) {
+      EXPECT_FALSE(sync.AddUnresolvedAction(peer_action));
+      EXPECT_EQ(1U, sync.size());
+    }
+  }
+  EXPECT_EQ(1, resolved_count);
+  // Once every peer holds it, the action is dropped.
+  EXPECT_EQ(0U, sync.size());
+
+  // A second peer message for the same key from the same peer but with a new entry ID starts a
+  // separate action.
+  const NodeId kPeer(NodeId::kRandomId);
+  EXPECT_FALSE(sync.AddUnresolvedAction(MakePeerAction(kKey, kPeer, 1)));
+  EXPECT_FALSE(sync.AddUnresolvedAction(MakePeerAction(kKey, kPeer, 2)));
+  EXPECT_EQ(2U, sync.size());
+  EXPECT_TRUE(sync.GetUnresolvedActions().empty());
+}
+
+TEST(SyncTest, BEH_IncrementSyncAttempts) {
+  Sync<TestUnresolvedAction> sync;
+  const NodeId kThisNodeId(NodeId::kRandomId);
+  const int kSyncCounterMax(10);
+  sync.AddLocalAction(TestUnresolvedAction(GenerateKey(), TestAction(), kThisNodeId, 1));
+  for (int i(0); i != kSyncCounterMax; ++i)
+    sync.IncrementSyncAttempts();
+  sync.AddLocalAction(TestUnresolvedAction(GenerateKey(), TestAction(), kThisNodeId, 2));
+
+  auto unresolved_actions(sync.GetUnresolvedActions());
+  ASSERT_EQ(2U, unresolved_actions.size());
+  EXPECT_EQ(kSyncCounterMax, unresolved_actions.front().sync_counter);
+  EXPECT_EQ(0, unresolved_actions.back().sync_counter);
+
+  sync.IncrementSyncAttempts();
+  unresolved_actions = sync.GetUnresolvedActions();
+  ASSERT_EQ(1U, unresolved_actions.size());
+  EXPECT_EQ(2, unresolved_actions.front().this_node_and_entry_id.second);
+  EXPECT_EQ(1, unresolved_actions.front().sync_counter);
+}
+
+TEST(SyncTest, FUNC_AddUnresolvedActionsToLargeSync) {
+  const int kOutstandingCount(100000), kSampleCount(10000);
+  Sync<TestUnresolvedAction> sync;
+  const NodeId kThisNodeId(NodeId::kRandomId);
+  std::vector<Key> keys;
+  for (int i(0); i != kOutstandingCount; ++i) {
+    keys.push_back(GenerateKey());
+    sync.AddLocalAction(TestUnresolvedAction(keys.back(), TestAction(), kThisNodeId, i));
+  }
+
+  for (int i(0); i != kSampleCount; ++i) {
+    sync.AddUnresolvedAction(MakePeerAction(keys[RandomUint32() % keys.size()],
+                                            NodeId(NodeId::kRandomId), i));
+  }
+  EXPECT_GE(sync.size(), static_cast<size_t>(kOutstandingCount));
+}
+
+TEST(SyncCoalescerTest, BEH_CoalescePerGroup) {
+  const int kGroupCount(10), kActionsPerGroup(100);
+  std::map<NodeId, std::vector<std::string>> received;
+  int message_count(0);
+  SyncCoalescer coalescer(
+      [&](const NodeId& group_id, const std::string& serialised_batch) {
+        ++message_count;
+        for (const auto& proto_sync : SyncCoalescer::Unpack(serialised_batch)) {
+          EXPECT_EQ(7, proto_sync.action_type());
+          received[group_id].push_back(proto_sync.serialised_unresolved_action());
+        }
+      },
+      1024 * 1024, std::chrono::hours(1));
+
+  std::vector<NodeId> groups;
+  for (int i(0); i != kGroupCount; ++i)
+    groups.push_back(NodeId(NodeId::kRandomId));
+  std::map<NodeId, std::vector<std::string>> sent;
+  for (int i(0); i != kActionsPerGroup; ++i) {
+    for (const auto& group_id : groups) {
+      sent[group_id].push_back(RandomString(100));
+      coalescer.Add(group_id, 7, sent[group_id].back());
+    }
+  }
+  EXPECT_EQ(0, message_count);
+  coalescer.FlushAll();
+  EXPECT_EQ(kGroupCount, message_count);
+  EXPECT_EQ(sent, received);
+  EXPECT_EQ(static_cast<uint64_t>(kGroupCount * kActionsPerGroup),
+            coalescer.stats().actions_added);
+  EXPECT_EQ(static_cast<uint64_t>(kGroupCount), coalescer.stats().batches_sent);
+
+  EXPECT_THROW(SyncCoalescer::Unpack(std::string(1, static_cast<char>(0xff))), std::exception);
+}
+
+TEST(SyncCoalescerTest, BEH_FlushOnSizeAndTime) {
+  std::vector<size_t> batch_sizes;
+  SyncCoalescer coalescer(
+      [&](const NodeId&, const std::string& serialised_batch) {
+        batch_sizes.push_back(SyncCoalescer::Unpack(serialised_batch).size());
+      },
+      1000, std::chrono::milliseconds(100));
+  const NodeId kGroupId(NodeId::kRandomId);
+  // Ten 100-byte actions fill a batch.
+  for (int i(0); i != 25; ++i)
+    coalescer.Add(kGroupId, 1, std::string(100, 'a'));
+  EXPECT_EQ(std::vector<size_t>(2, 10), batch_sizes);
+
+  coalescer.FlushDue();
+  EXPECT_EQ(2U, batch_sizes.size());
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  coalescer.FlushDue();
+  ASSERT_EQ(3U, batch_sizes.size());
+  EXPECT_EQ(5U, batch_sizes.back());
+}
+
+TEST(SyncSchedulerTest, BEH_RoundsAndBackpressure) {
+  std::atomic<int> round_count(0);
+  std::atomic<size_t> queue_depth(0);
+  SyncScheduler scheduler([&] { ++round_count; }, [&] { return queue_depth.load(); }, [] {},
+                          std::chrono::milliseconds(20), std::chrono::milliseconds(80), 10);
+  EXPECT_EQ(std::chrono::steady_clock::duration::zero(), scheduler.current_lag());
+  scheduler.Notify();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_GT(scheduler.current_lag(), std::chrono::steady_clock::duration::zero());
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_GT(round_count.load(), 0);
+  EXPECT_EQ(std::chrono::steady_clock::duration::zero(), scheduler.current_lag());
+  auto stats(scheduler.stats());
+  EXPECT_GT(stats.last_lag, std::chrono::steady_clock::duration::zero());
+  EXPECT_LE(stats.last_lag, stats.max_lag);
+  EXPECT_EQ(0U, stats.deferred_rounds);
+
+  // A deep outbound queue holds rounds back.
+  queue_depth = 11;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  int held_round_count(round_count.load());
+  scheduler.Notify();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_EQ(held_round_count, round_count.load());
+  EXPECT_GT(scheduler.stats().deferred_rounds, 0U);
+  EXPECT_GE(scheduler.current_lag(), std::chrono::milliseconds(300));
+
+  queue_depth = 0;
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_GT(round_count.load(), held_round_count);
+  EXPECT_GE(scheduler.stats().max_lag, std::chrono::milliseconds(300));
+
+  // Stopping runs a final round.
+  int stopping_round_count(round_count.load());
+  scheduler.Stop();
+  EXPECT_EQ(stopping_round_count + 1, round_count.load());
+}
+
+TEST(SyncSchedulerTest, BEH_RecoverFromBacklog) {
+  std::atomic<int> round_count(0);
+  std::atomic<size_t> sent_count(0);
+  SyncCoalescer coalescer(
+      [&](const NodeId&, const std::string& serialised_batch) {
+        sent_count += SyncCoalescer::Unpack(serialised_batch).size();
+      },
+      1024 * 1024, std::chrono::milliseconds(10));
+  const NodeId kGroupId(NodeId::kRandomId);
+  // Leave more actions queued than the scheduler tolerates, so that its first round is deferred.
+  for (int i(0); i != 11; ++i)
+    coalescer.Add(kGroupId, 1, RandomString(100));
+
+  SyncScheduler scheduler([&] {
+                            ++round_count;
+                            coalescer.Add(kGroupId, 1, RandomString(100));
+                            coalescer.FlushAll();
+                          },
+                          [&] { return coalescer.queued_actions(); },
+                          [&] { coalescer.FlushDue(); },
+                          std::chrono::milliseconds(20), std::chrono::milliseconds(80), 10);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  // The deferred round drained the backlog, so later rounds ran again.
+  EXPECT_GT(scheduler.stats().deferred_rounds, 0U);
+  EXPECT_GT(round_count.load(), 0);
+  EXPECT_GE(sent_count.load(), 11U);
+  scheduler.Stop();
+}
+
+TEST(SyncSchedulerTest, BEH_RoundSendsWithinMaxBatchDelay) {
+  // As in the personas' DoSync, each round adds its actions and then flushes the coalescer.
+  const std::chrono::milliseconds kMaxBatchDelay(100);
+  const int kActionsPerRound(5);
+  std::chrono::steady_clock::time_point round_started;
+  std::vector<std::chrono::steady_clock::duration> send_delays;
+  int round_count(0), sent_count(0);
+  SyncCoalescer coalescer(
+      [&](const NodeId&, const std::string& serialised_batch) {
+        send_delays.push_back(std::chrono::steady_clock::now() - round_started);
+        sent_count += static_cast<int>(SyncCoalescer::Unpack(serialised_batch).size());
+      },
+      1024 * 1024, kMaxBatchDelay);
+  const NodeId kGroupId(NodeId::kRandomId);
+  // Rounds and sends all run on the scheduler's thread.
+  SyncScheduler scheduler([&] {
+                            round_started = std::chrono::steady_clock::now();
+                            ++round_count;
+                            for (int i(0); i != kActionsPerRound; ++i)
+                              coalescer.Add(kGroupId, 1, RandomString(100));
+                            coalescer.FlushAll();
+                          },
+                          [&] { return coalescer.queued_actions(); },
+                          [&] { coalescer.FlushDue(); },
+                          std::chrono::milliseconds(500), std::chrono::seconds(2), 1000);
+  scheduler.Notify();
+  std::this_thread::sleep_for(std::chrono::milliseconds(700));
+  scheduler.Stop();
+
+  // Every round's actions go out in one batch by the end of that round, and none is held over
+  // into the next round's batch.
+  ASSERT_LT(0, round_count);
+  EXPECT_EQ(static_cast<size_t>(round_count), send_delays.size());
+  EXPECT_EQ(round_count * kActionsPerRound, sent_count);
+  EXPECT_EQ(0U, coalescer.queued_actions());
+  for (const auto& send_delay : send_delays)
+    EXPECT_LE(send_delay, kMaxBatchDelay);
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
@@ -26,6 +26,7 @@
 #include "maidsafe/common/utils.h"
 #include "maidsafe/passport/types.h"
 
+#include "maidsafe/vault/key_utils.h"
 #include "maidsafe/vault/utils.h"
 #include "maidsafe/vault/vault.h"
 
@@ -74,6 +75,44 @@ TEST(UtilsTest, BEH_FixedWidthStringSize4) {
   CheckToAndFromFixedWidthString<4>();
 }
 
+TEST(UtilsTest, BEH_GetNameRangesWithinRadius) {
+  // Radius with its highest set bit at position 12, so names within range share 12 leading bits.
+  std::string radius_string(NodeId::kSize, 0);
+  radius_string[1] = 0x08;
+  NodeId radius(radius_string);
+
+  EXPECT_TRUE(detail::GetNameRangesWithinRadius(std::vector<NodeId>(), radius).empty());
+
+  NodeId node(NodeId::kRandomId);
+  auto ranges(detail::GetNameRangesWithinRadius(std::vector<NodeId>(1, node), radius));
+  ASSERT_EQ(1U, ranges.size());
+  EXPECT_FALSE(node < ranges.front().first);
+  EXPECT_FALSE(ranges.front().second < node);
+  EXPECT_EQ(ranges.front().first.string().substr(0, 1), node.string().substr(0, 1));
+  EXPECT_EQ(ranges.front().second.string().substr(0, 1), node.string().substr(0, 1));
+  EXPECT_EQ(std::string(NodeId::kSize - 2, 0), ranges.front().first.string().substr(2));
+  EXPECT_EQ(std::string(NodeId::kSize - 2, static_cast<char>(0xff)),
+            ranges.front().second.string().substr(2));
+
+  // Duplicate and nearby nodes collapse into a single range.
+  std::string nearby_string(node.string());
+  nearby_string[NodeId::kSize - 1] ^= 0x01;
+  std::vector<NodeId> nodes(1, node);
+  nodes.push_back(node);
+  nodes.push_back(NodeId(nearby_string));
+  EXPECT_EQ(ranges, detail::GetNameRangesWithinRadius(nodes, radius));
+
+  // Ranges are returned sorted and disjoint.
+  nodes.clear();
+  for (int i(0); i != 100; ++i)
+    nodes.push_back(NodeId(NodeId::kRandomId));
+  ranges = detail::GetNameRangesWithinRadius(nodes, radius);
+  for (size_t i(1); i < ranges.size(); ++i)
+    EXPECT_TRUE(ranges[i - 1].second < ranges[i].first);
+  for (const auto& range : ranges)
+    EXPECT_FALSE(range.second < range.first);
+}
+
 }  // namespace test
 
 }  // namespace vault
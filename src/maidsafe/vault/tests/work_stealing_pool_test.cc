@@ -0,0 +1,125 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/work_stealing_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+namespace test {
+
+TEST(WorkStealingPoolTest, BEH_OrderedPerAffinity) {
+  const uint64_t kAffinityCount(50);
+  const int kTasksPerAffinity(200);
+  std::mutex mutex;
+  std::map<uint64_t, std::vector<int>> ran;
+  {
+    WorkStealingPool pool(4, 4);
+    for (int i(0); i != kTasksPerAffinity; ++i) {
+      for (uint64_t affinity(0); affinity != kAffinityCount; ++affinity) {
+        pool.Post(affinity, [&, affinity, i] {
+                              std::lock_guard<std::mutex> lock(mutex);
+                              ran[affinity].push_back(i);
+                            });
+      }
+    }
+    while (pool.stats().executed != kAffinityCount * kTasksPerAffinity)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(kAffinityCount, ran.size());
+  for (const auto& affinity_and_order : ran) {
+    EXPECT_EQ(static_cast<size_t>(kTasksPerAffinity), affinity_and_order.second.size());
+    EXPECT_TRUE(std::is_sorted(std::begin(affinity_and_order.second),
+                               std::end(affinity_and_order.second)));
+  }
+}
+
+TEST(WorkStealingPoolTest, BEH_BlockedThreadDoesntStallOthers) {
+  WorkStealingPool pool(2, 2);
+  std::atomic<bool> release(false);
+  std::atomic<int> done(0);
+  // Strands 0 and 2 are both homed on thread 0.  Whichever thread picks up strand 0 is blocked,
+  // so strand 2 runs either on thread 0 directly or by thread 1 stealing it.
+  pool.Post(0, [&] {
+                 while (!release)
+                   std::this_thread::sleep_for(std::chrono::milliseconds(1));
+               });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  pool.Post(2, [&] { ++done; });
+  for (int i(0); i != 1000 && done == 0; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(1, done.load());
+  release = true;
+}
+
+TEST(WorkStealingPoolTest, FUNC_Scaling) {
+  // Synthetic client PUT traffic for a MaidManager: each task hashes a chunk for one of many
+  // accounts, with each account's PUTs required to be handled in order.
+  const int kAccountCount(1000), kPutCount(20000);
+  std::vector<uint64_t> accounts;
+  for (int i(0); i != kAccountCount; ++i)
+    accounts.push_back(static_cast<uint64_t>(RandomUint32()) << 32 | RandomUint32());
+  const std::string kChunk(RandomString(4096));
+  const uint64_t kExpectedChecksum(
+      kPutCount * static_cast<uint64_t>(static_cast<unsigned char>(
+                      crypto::Hash<crypto::SHA512>(kChunk).string()[0])));
+
+  for (size_t thread_count(1); thread_count <= 64; thread_count *= 2) {
+    std::atomic<uint64_t> checksum(0);
+    std::atomic<int> out_of_order(0);
+    std::vector<int> last_put(kAccountCount, -1);
+    {
+      WorkStealingPool pool(thread_count);
+      for (int i(0); i != kPutCount; ++i) {
+        pool.Post(accounts[i % kAccountCount], [&, i] {
+                    checksum += static_cast<unsigned char>(
+                        crypto::Hash<crypto::SHA512>(kChunk).string()[0]);
+                    int& last(last_put[i % kAccountCount]);
+                    if (last > i)
+                      ++out_of_order;
+                    last = i;
+                  });
+      }
+      while (pool.stats().executed != static_cast<uint64_t>(kPutCount))
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(kExpectedChecksum, checksum.load()) << thread_count << " threads";
+    EXPECT_EQ(0, out_of_order.load()) << thread_count << " threads";
+  }
+}
+
+}  // namespace test
+
+}  // namespace vault
+
+}  // namespace maidsafe
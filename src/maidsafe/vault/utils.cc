@@ -226,6 +226,20 @@ std::unique_ptr<leveldb::DB> InitialiseLevelDb(const boost::filesystem::path& db
   return std::move(std::unique_ptr<leveldb::DB>(db));
 }
 
+std::unique_ptr<leveldb::DB> OpenLevelDb(const boost::filesystem::path& db_path) {
+  // leveldb only creates the db's own directory.
+  if (db_path.has_parent_path())
+    boost::filesystem::create_directories(db_path.parent_path());
+  leveldb::DB* db(nullptr);
+  leveldb::Options options;
+  options.create_if_missing = true;
+  leveldb::Status status(leveldb::DB::Open(options, db_path.string(), &db));
+  if (!status.ok())
+    ThrowError(CommonErrors::filesystem_io_error);
+  assert(db);
+  return std::move(std::unique_ptr<leveldb::DB>(db));
+}
+
 // To be moved to Routing
 bool operator ==(const routing::GroupSource& lhs,  const routing::GroupSource& rhs) {
   return lhs.group_id == rhs.group_id &&
@@ -588,6 +588,8 @@ typename Persona::DbKey GetKeyFromMessage(const nfs::Message& message) {
 }
 */
 std::unique_ptr<leveldb::DB> InitialiseLevelDb(const boost::filesystem::path& db_path);
+// Unlike InitialiseLevelDb, keeps any existing db at 'db_path', and creates its parent directories.
+std::unique_ptr<leveldb::DB> OpenLevelDb(const boost::filesystem::path& db_path);
 
 }  // namespace vault
 
@@ -31,7 +31,9 @@ Vault::Vault(const passport::Pmid& pmid,
              const boost::filesystem::path& vault_root_dir,
              std::function<void(boost::asio::ip::udp::endpoint)> on_new_bootstrap_endpoint,
              const std::vector<passport::PublicPmid>& pmids_from_file,
-             const std::vector<boost::asio::ip::udp::endpoint>& peer_endpoints)
+             const std::vector<boost::asio::ip::udp::endpoint>& peer_endpoints,
+             const AccumulatorPolicies& accumulator_policies,
+             const PersonaExecutorPolicies& executor_policies)
     : network_health_mutex_(),
       network_health_condition_variable_(),
       network_health_(-1),
@@ -39,20 +41,27 @@ Vault::Vault(const passport::Pmid& pmid,
       routing_(new routing::Routing(pmid)),
       data_getter_(asio_service_, *routing_, pmids_from_file),
       maid_manager_service_(std::move(std::unique_ptr<MaidManagerService>(
-                                new MaidManagerService(pmid, *routing_)))),
+                                new MaidManagerService(pmid, *routing_, vault_root_dir,
+                                                       accumulator_policies.maid_manager)))),
       version_manager_service_(std::move(std::unique_ptr<VersionManagerService>(
-                                   new VersionManagerService(pmid, *routing_)))),
+                                   new VersionManagerService(
+                                       pmid, *routing_, accumulator_policies.version_manager)))),
       data_manager_service_(std::move(std::unique_ptr<DataManagerService>(
-                                   new DataManagerService(pmid, *routing_, data_getter_)))),
+                                   new DataManagerService(pmid, *routing_, data_getter_,
+                                                          accumulator_policies.data_manager)))),
       pmid_manager_service_(std::move(std::unique_ptr<PmidManagerService>(
-                                   new PmidManagerService(pmid, *routing_)))),
+                                   new PmidManagerService(pmid, *routing_,
+                                                          accumulator_policies.pmid_manager)))),
+      // FIXME need to specialise
       pmid_node_service_(std::move(std::unique_ptr<PmidNodeService>(
-                                   new PmidNodeService(pmid, *routing_, vault_root_dir)))), // FIXME need to specialise
+                                   new PmidNodeService(pmid, *routing_, vault_root_dir,
+                                                       accumulator_policies.pmid_node)))),
       demux_(maid_manager_service_,
              version_manager_service_,
              data_manager_service_,
              pmid_manager_service_,
-             pmid_node_service_),
+             pmid_node_service_,
+             executor_policies),
       asio_service_(2) {
   // TODO(Fraser#5#): 2013-03-29 - Prune all empty dirs.
   asio_service_.Start();
@@ -184,16 +193,16 @@ void Vault::OnCloseNodeReplaced(const std::vector<routing::NodeInfo>& /*new_clos
 }
 
 void Vault::OnMatrixChanged(std::shared_ptr<routing::MatrixChange> matrix_change) {
-  asio_service_.service().post([=] {
+  demux_.Post(nfs::Persona::kMaidManager, Lane::kControl, [=] {
       maid_manager_service_.HandleChurnEvent(matrix_change);
   });
-  asio_service_.service().post([=] {
+  demux_.Post(nfs::Persona::kVersionManager, Lane::kControl, [=] {
       version_manager_service_.HandleChurnEvent(matrix_change);
   });
-  asio_service_.service().post([=] {
+  demux_.Post(nfs::Persona::kDataManager, Lane::kControl, [=] {
       data_manager_service_.HandleChurnEvent(matrix_change);
   });
-  asio_service_.service().post([=] {
+  demux_.Post(nfs::Persona::kPmidManager, Lane::kControl, [=] {
       pmid_manager_service_.HandleChurnEvent(matrix_change);
   });
 }
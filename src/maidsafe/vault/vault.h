@@ -32,6 +32,7 @@
 #include "maidsafe/nfs/client/data_getter.h"
 #include "maidsafe/nfs/service.h"
 
+#include "maidsafe/vault/accumulator.h"
 #include "maidsafe/vault/pmid_node/service.h"
 #include "maidsafe/vault/maid_manager/service.h"
 #include "maidsafe/vault/data_manager/service.h"
@@ -39,6 +40,7 @@
 #include "maidsafe/vault/version_manager/service.h"
 #include "maidsafe/vault/db.h"
 #include "maidsafe/vault/demultiplexer.h"
+#include "maidsafe/vault/persona_executor.h"
 
 namespace maidsafe {
 
@@ -53,7 +55,9 @@ class Vault {
         const std::vector<passport::PublicPmid>& pmids_from_file =
             std::vector<passport::PublicPmid>(),
         const std::vector<boost::asio::ip::udp::endpoint>& peer_endpoints =
-            std::vector<boost::asio::ip::udp::endpoint>());
+            std::vector<boost::asio::ip::udp::endpoint>(),
+        const AccumulatorPolicies& accumulator_policies = AccumulatorPolicies(),
+        const PersonaExecutorPolicies& executor_policies = PersonaExecutorPolicies());
   ~Vault();  // must issue StopSending() to all identity objects (MM etc.)
              // Then ensure routing is destroyed next then all others in any order at this time
  private:
@@ -90,7 +94,9 @@ class Vault {
 
 template<typename T>
 void Vault::OnMessageReceived(const T& message) {
-  asio_service_.service().post([=] { demux_.HandleMessage(message); });
+  // Routing only lends us 'message', so it's copied once here; the persona's queued task then
+  // carries a pointer, so the contents are never copied again.
+  demux_.HandleMessage(std::make_shared<const T>(message));
 }
 
 template<typename T>
@@ -100,8 +106,8 @@ bool Vault::OnGetFromCache(const T& message) {  // Need to be on routing's threa
 
 
 template<typename T>
-void Vault::OnStoreInCache(const T& /*message*/) {
-//  asio_service_.service().post([=] { demux_.StoreInCache(message) });
+void Vault::OnStoreInCache(const T& message) {
+  demux_.StoreInCache(message);
 }
 
 }  // namespace vault
@@ -18,6 +18,7 @@
 
 #include "maidsafe/vault/version_manager/key.h"
 
+#include <cstring>
 #include <tuple>
 
 #include "maidsafe/common/error.h"
@@ -48,6 +49,13 @@ VersionManagerKey::VersionManagerKey(const FixedWidthString& fixed_width_string)
                    fixed_width_string.string().substr(NodeId::kSize, detail::PaddedWidth::value)))),
       originator(fixed_width_string.string().substr(NodeId::kSize + detail::PaddedWidth::value)) {}
 
+VersionManagerKey::VersionManagerKey(const FixedWidthView& fixed_width_view)
+    : name(std::string(fixed_width_view.data, NodeId::kSize)),
+      type(static_cast<DataTagValue>(detail::DecodeFixedWidth<detail::PaddedWidth::value>(
+               fixed_width_view.data + NodeId::kSize))),
+      originator(std::string(fixed_width_view.data + NodeId::kSize + detail::PaddedWidth::value,
+                             NodeId::kSize)) {}
+
 VersionManagerKey::VersionManagerKey(const VersionManagerKey& other)
     : name(other.name),
       type(other.type),
@@ -72,10 +80,22 @@ std::string VersionManagerKey::Serialise() const {
 }
 
 VersionManagerKey::FixedWidthString VersionManagerKey::ToFixedWidthString() const {
-  return FixedWidthString(
-      name.string() +
-      detail::ToFixedWidthString<detail::PaddedWidth::value>(static_cast<uint32_t>(type)) +
-      originator.string());
+  return FixedWidthString(ToFixedWidthBuffer().string());
+}
+
+VersionManagerKey::FixedWidthBuffer VersionManagerKey::ToFixedWidthBuffer() const {
+  FixedWidthBuffer buffer;
+  EncodeFixedWidth(buffer.data());
+  return buffer;
+}
+
+void VersionManagerKey::EncodeFixedWidth(char* out) const {
+  assert(name.string().size() == NodeId::kSize && originator.string().size() == NodeId::kSize);
+  std::memcpy(out, name.string().data(), NodeId::kSize);
+  out += NodeId::kSize;
+  detail::EncodeFixedWidth<detail::PaddedWidth::value>(static_cast<uint32_t>(type), out);
+  out += detail::PaddedWidth::value;
+  std::memcpy(out, originator.string().data(), NodeId::kSize);
 }
 
 void swap(VersionManagerKey& lhs, VersionManagerKey& rhs) MAIDSAFE_NOEXCEPT {
@@ -33,6 +33,9 @@ namespace maidsafe {
 
 namespace vault {
 
+template<typename KeyType, typename ValueType>
+class Db;
+
 struct VersionManagerKey {
   template<typename Data>
   VersionManagerKey(const typename Data::Name& name_in, const Identity& originator_in)
@@ -49,13 +52,21 @@ struct VersionManagerKey {
   DataTagValue type;
   Identity originator;
 
+  template<typename KeyType, typename ValueType>
+  friend class Db;
+
  private:
-  typedef maidsafe::detail::BoundedString<
-      NodeId::kSize * 2 + detail::PaddedWidth::value,
-      NodeId::kSize * 2 + detail::PaddedWidth::value> FixedWidthString;
+  static const size_t kFixedWidthSize = NodeId::kSize * 2 + detail::PaddedWidth::value;
+  typedef maidsafe::detail::BoundedString<kFixedWidthSize, kFixedWidthSize> FixedWidthString;
+  typedef detail::FixedWidthBuffer<kFixedWidthSize> FixedWidthBuffer;
+  typedef detail::FixedWidthView<kFixedWidthSize> FixedWidthView;
 
   explicit VersionManagerKey(const FixedWidthString& fixed_width_string);
+  explicit VersionManagerKey(const FixedWidthView& fixed_width_view);
   FixedWidthString ToFixedWidthString() const;
+  // Neither of these allocates.
+  FixedWidthBuffer ToFixedWidthBuffer() const;
+  void EncodeFixedWidth(char* out) const;
 };
 
 void swap(VersionManagerKey& lhs, VersionManagerKey& rhs) MAIDSAFE_NOEXCEPT;
@@ -75,11 +75,12 @@ namespace detail {
 
 
 VersionManagerService::VersionManagerService(const passport::Pmid& /*pmid*/,
-                                             routing::Routing& routing)
+                                             routing::Routing& routing,
+                                             const AccumulatorPolicy& accumulator_policy)
     : routing_(routing),
       accumulator_mutex_(),
       sync_mutex_(),
-      accumulator_(),
+      accumulator_(accumulator_policy),
       version_manager_db_(),
       kThisNodeId_(routing_.kNodeId()) {}
 
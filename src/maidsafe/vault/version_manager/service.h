@@ -49,7 +49,8 @@ class VersionManagerService {
   typedef nfs::VersionManagerServiceMessages VaultMessages; // FIXME (Check with Fraser)
 
   typedef Identity VersionManagerAccountName;
-  VersionManagerService(const passport::Pmid& pmid, routing::Routing& routing);
+  VersionManagerService(const passport::Pmid& pmid, routing::Routing& routing,
+                        const AccumulatorPolicy& accumulator_policy = AccumulatorPolicy());
 //  template<typename Data>
 //  void HandleMessage(const nfs::Message& message, const routing::ReplyFunctor& reply_functor);
   template<typename T>
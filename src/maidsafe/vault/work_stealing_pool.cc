@@ -0,0 +1,169 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault/work_stealing_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "maidsafe/common/log.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+const size_t WorkStealingPool::kMaxStrandBatch_(16);
+
+WorkStealingPool::WorkStealingPool(size_t thread_count, size_t strands_per_thread)
+    : workers_(),
+      strands_(),
+      idle_mutex_(),
+      idle_condition_(),
+      ready_count_(0),
+      stopped_(false),
+      executed_(0),
+      stolen_(0) {
+  if (thread_count == 0)
+    thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+  for (size_t i(0); i != thread_count; ++i)
+    workers_.push_back(std::unique_ptr<Worker>(new Worker));
+  for (size_t i(0); i != thread_count * std::max(strands_per_thread, static_cast<size_t>(1)); ++i)
+    strands_.push_back(std::unique_ptr<Strand>(new Strand));
+  for (size_t i(0); i != thread_count; ++i)
+    workers_[i]->thread = std::thread([this, i] { Run(i); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  Stop();
+}
+
+void WorkStealingPool::Post(uint64_t affinity, Task task) {
+  auto strand_index(static_cast<size_t>(affinity % strands_.size()));
+  auto& strand(*strands_[strand_index]);
+  {
+    std::lock_guard<std::mutex> lock(strand.mutex);
+    strand.tasks.push_back(task);
+    if (strand.scheduled)
+      return;
+    strand.scheduled = true;
+  }
+  Schedule(strand_index, strand_index % workers_.size());
+}
+
+void WorkStealingPool::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    if (stopped_)
+      return;
+    stopped_ = true;
+  }
+  idle_condition_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable() && worker->thread.get_id() != std::this_thread::get_id())
+      worker->thread.join();
+  }
+}
+
+WorkStealingPool::Stats WorkStealingPool::stats() const {
+  Stats stats;
+  stats.executed = executed_;
+  stats.stolen = stolen_;
+  return stats;
+}
+
+void WorkStealingPool::Schedule(size_t strand_index, size_t worker_index) {
+  {
+    std::lock_guard<std::mutex> lock(workers_[worker_index]->mutex);
+    workers_[worker_index]->ready_strands.push_back(strand_index);
+  }
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    ++ready_count_;
+  }
+  idle_condition_.notify_one();
+}
+
+size_t WorkStealingPool::TakeReadyStrand(size_t worker_index) {
+  // The caller has claimed one of 'ready_count_', so a ready strand is queued somewhere, though
+  // other threads may be moving strands between queues concurrently.
+  for (;;) {
+    for (size_t i(0); i != workers_.size(); ++i) {
+      auto& worker(*workers_[(worker_index + i) % workers_.size()]);
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      if (worker.ready_strands.empty())
+        continue;
+      size_t strand_index;
+      if (i == 0) {
+        strand_index = worker.ready_strands.front();
+        worker.ready_strands.pop_front();
+      } else {
+        strand_index = worker.ready_strands.back();
+        worker.ready_strands.pop_back();
+        ++stolen_;
+      }
+      return strand_index;
+    }
+    std::this_thread::yield();
+  }
+}
+
+void WorkStealingPool::RunStrand(size_t strand_index, size_t worker_index) {
+  auto& strand(*strands_[strand_index]);
+  for (size_t run_count(0); ; ++run_count) {
+    Task task;
+    {
+      std::lock_guard<std::mutex> lock(strand.mutex);
+      if (strand.tasks.empty()) {
+        strand.scheduled = false;
+        return;
+      }
+      if (run_count == kMaxStrandBatch_)
+        break;
+      task = std::move(strand.tasks.front());
+      strand.tasks.pop_front();
+    }
+    try {
+      task();
+    }
+    catch(const std::exception& e) {
+      LOG(kError) << "Task failed: " << e.what();
+    }
+    ++executed_;
+  }
+  // Tasks remain; let other ready strands have a turn first.  The strand stays on this thread,
+  // where its data is likely still cached.
+  Schedule(strand_index, worker_index);
+}
+
+void WorkStealingPool::Run(size_t worker_index) {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(idle_mutex_);
+      idle_condition_.wait(lock, [this] { return stopped_ || ready_count_ != 0; });
+      if (stopped_)
+        return;
+      --ready_count_;
+    }
+    RunStrand(TakeReadyStrand(worker_index), worker_index);
+  }
+}
+
+}  // namespace vault
+
+}  // namespace maidsafe
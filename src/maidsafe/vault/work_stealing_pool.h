@@ -0,0 +1,104 @@
+/*  Copyright 2013 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_WORK_STEALING_POOL_H_
+#define MAIDSAFE_VAULT_WORK_STEALING_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/vault/parameters.h"
+
+
+namespace maidsafe {
+
+namespace vault {
+
+// Runs tasks across a fixed set of threads.  Tasks are posted with an affinity (e.g. a hash of the
+// account or data name they act on) which maps them to a strand; a strand's tasks run one at a
+// time in the order posted, while different strands run in parallel.  Each ready strand is queued
+// on its home thread, and idle threads steal ready strands from the others.
+class WorkStealingPool {
+ public:
+  typedef std::function<void()> Task;
+
+  struct Stats {
+    Stats() : executed(0), stolen(0) {}
+    uint64_t executed, stolen;
+  };
+
+  // A 'thread_count' of 0 uses the hardware concurrency.
+  explicit WorkStealingPool(
+      size_t thread_count = detail::Parameters::work_stealing_pool_thread_count,
+      size_t strands_per_thread = detail::Parameters::work_stealing_pool_strands_per_thread);
+  // Discards queued tasks and waits for running ones to finish.
+  ~WorkStealingPool();
+
+  void Post(uint64_t affinity, Task task);
+  void Stop();
+  size_t thread_count() const { return workers_.size(); }
+  Stats stats() const;
+
+ private:
+  struct Strand {
+    Strand() : mutex(), tasks(), scheduled(false) {}
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    bool scheduled;
+  };
+
+  struct Worker {
+    Worker() : mutex(), ready_strands(), thread() {}
+    std::mutex mutex;
+    std::deque<size_t> ready_strands;
+    std::thread thread;
+  };
+
+  WorkStealingPool(const WorkStealingPool&);
+  WorkStealingPool& operator=(const WorkStealingPool&);
+  WorkStealingPool(WorkStealingPool&&);
+  WorkStealingPool& operator=(WorkStealingPool&&);
+
+  void Schedule(size_t strand_index, size_t worker_index);
+  size_t TakeReadyStrand(size_t worker_index);
+  void RunStrand(size_t strand_index, size_t worker_index);
+  void Run(size_t worker_index);
+
+  // Number of tasks a thread runs from one strand before requeuing it behind other ready strands.
+  static const size_t kMaxStrandBatch_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::unique_ptr<Strand>> strands_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_condition_;
+  size_t ready_count_;
+  bool stopped_;
+  std::atomic<uint64_t> executed_, stolen_;
+};
+
+}  // namespace vault
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_WORK_STEALING_POOL_H_